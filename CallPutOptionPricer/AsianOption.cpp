@@ -0,0 +1,113 @@
+/* Asian options implementation */
+/*****************************************************
+Name: AsianOption.cpp
+version: 0.1
+Description:
+Implementation of the functions in AsianOption.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "AsianOption.hpp"
+#include "Instrumentation.hpp"
+#include "PricingKernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/*Constructors and destructor implementation*/
+AsianOption::AsianOption() : rf(0.08), sig(0.30), K(65), T(0.25), b(0.08), fixings(63), call(true) {
+
+}
+
+AsianOption::AsianOption(double p_rf, double p_sig, double p_K, double p_T, double p_b, int p_fixings, bool p_call)
+	: rf(p_rf), sig(p_sig), K(p_K), T(p_T), b(p_b), fixings(std::max(p_fixings, 1)), call(p_call) {
+
+}
+
+AsianOption::AsianOption(OptionData& data, int p_fixings, bool p_call)
+	: rf(data.rf), sig(data.sig), K(data.K), T(data.T), b(data.b), fixings(std::max(p_fixings, 1)), call(p_call) {
+
+}
+
+AsianOption::~AsianOption() {
+
+}
+
+/*Member functions to retrieve and set the data implementation*/
+int AsianOption::FixingCount() const {
+	return fixings;
+}
+
+void AsianOption::FixingCount(int new_fixings) {
+	if (new_fixings < 1) {
+		cout << "Invalid input. An Asian option needs at least one fixing" << endl;
+		return;
+	}
+	fixings = new_fixings;
+}
+
+bool AsianOption::IsCall() const {
+	return call;
+}
+
+/*Pricers implementation*/
+double AsianOption::GeometricPrice(double S) const {
+	PRICER_PROBE("AsianOption::GeometricPrice");
+	double n = fixings;
+	double m = log(S) + (b - 0.5 * sig * sig) * T * (n + 1.0) / (2.0 * n);
+	double v = sig * sig * T * (n + 1.0) * (2.0 * n + 1.0) / (6.0 * n * n);
+	double sd = sqrt(v);
+	double d1 = (m - log(K) + v) / sd;
+	double d2 = d1 - sd;
+	double forward = exp(m + 0.5 * v); //E[G]
+	if (call) {
+		return exp(-rf * T) * (forward * NormCdf(d1) - K * NormCdf(d2));
+	}
+	return exp(-rf * T) * (K * NormCdf(-d2) - forward * NormCdf(-d1));
+}
+
+MonteCarloResult AsianOption::ArithmeticPrice(double S, const MonteCarloSettings& settings) const {
+	PRICER_PROBE("AsianOption::ArithmeticPrice");
+	PathModel model = { S, T, sig, rf, b, fixings };
+	const double df = exp(-rf * T);
+	const double sign = call ? 1.0 : -1.0;
+	const double strike = K;
+	return SimulateGBM(model, GeometricPrice(S), settings, [=](const double* path, int n, double& y, double& x) {
+		double sum = 0.0, log_sum = 0.0;
+		for (int i = 1; i <= n; i++) {
+			sum += path[i];
+			log_sum += log(path[i]);
+		}
+		y = df * std::max(sign * (sum / n - strike), 0.0);
+		x = df * std::max(sign * (exp(log_sum / n) - strike), 0.0);
+	});
+}
+
+MonteCarloResult AsianOption::GeometricPriceMC(double S, const MonteCarloSettings& settings) const {
+	PRICER_PROBE("AsianOption::GeometricPriceMC");
+	PathModel model = { S, T, sig, rf, b, fixings };
+	const double df = exp(-rf * T);
+	const double sign = call ? 1.0 : -1.0;
+	const double strike = K;
+	MonteCarloSettings plain = settings;
+	plain.control_variate = false;
+	return SimulateGBM(model, 0.0, plain, [=](const double* path, int n, double& y, double& x) {
+		double log_sum = 0.0;
+		for (int i = 1; i <= n; i++) {
+			log_sum += log(path[i]);
+		}
+		y = df * std::max(sign * (exp(log_sum / n) - strike), 0.0);
+		x = 0.0;
+	});
+}
+
+/*Printing functions implementation*/
+std::string AsianOption::ToString() const {
+	std::stringstream ss;
+	ss << "********** ASIAN " << (call ? "CALL" : "PUT") << " OPTION PARAMETERS **********\n" << "T: " << T << "\nK: " << K << "\nrf: " << rf
+		<< "\nsig: " << sig << "\nb: " << b << "\nFixings: " << fixings << endl;
+	return ss.str();
+}
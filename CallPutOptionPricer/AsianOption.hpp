@@ -0,0 +1,64 @@
+/* Asian options */
+/*****************************************************
+Name: AsianOption.hpp
+version: 0.1
+Description:
+European options on the average of the underlying over n equally spaced fixings t_i = i*T/n (i = 1..n), in the
+generalized Black-Scholes setting of EuOptCall / EuOptPut (risk-free rate rf, cost of carry b).
+	call: max(A - K, 0), put: max(K - A, 0)
+
+Geometric average G = (S(t_1) * ... * S(t_n))^(1/n): ln G is normal, with
+	mean m = ln S + (b - sig^2/2) T (n + 1) / (2n), variance v = sig^2 T (n + 1)(2n + 1) / (6n^2)
+so that C = e^(-rT) (e^(m + v/2) N(d1) - K N(d2)), d1 = (m - ln K + v) / sqrt(v), d2 = d1 - sqrt(v)
+and P = e^(-rT) (K N(-d2) - e^(m + v/2) N(-d1)). GeometricPrice is this closed form.
+
+Arithmetic average A = (S(t_1) + ... + S(t_n)) / n: no closed form. ArithmeticPrice simulates the paths
+(MonteCarlo.hpp) and uses the geometric option on the same fixings as control variate: both payoffs are evaluated
+on every path and the known geometric price corrects the arithmetic estimate. The two averages are almost perfectly
+correlated, which cuts the variance by one to two orders of magnitude for the same number of paths.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef ASIANOPTION_HPP
+#define ASIANOPTION_HPP
+
+#include <string>
+#include <sstream>
+#include "OptionData.hpp"
+#include "MonteCarlo.hpp"
+
+class AsianOption {
+private:
+	double rf; //risk-free interest rate
+	double sig; //volatility
+	double K; //strike price
+	double T; //expiry time/maturity expressed in years
+	double b; //cost of carry
+	int fixings; //number of averaging dates
+	bool call;
+
+public:
+	/*Constructors and destructor*/
+	AsianOption();
+	AsianOption(double p_rf, double p_sig, double p_K, double p_T, double p_b, int p_fixings, bool p_call = true);
+	AsianOption(OptionData& data, int p_fixings, bool p_call = true);
+	virtual ~AsianOption();
+
+	/*Member functions to retrieve and set the data*/
+	int FixingCount() const;
+	void FixingCount(int new_fixings);
+	bool IsCall() const;
+
+	/*Pricers*/
+	double GeometricPrice(double S) const; //closed form price of the geometric average option
+	MonteCarloResult ArithmeticPrice(double S, const MonteCarloSettings& settings = MonteCarloSettings()) const; //geometric control variate
+	MonteCarloResult GeometricPriceMC(double S, const MonteCarloSettings& settings = MonteCarloSettings()) const; //simulated geometric price, to check the closed form
+
+	/*Printing functions*/
+	virtual std::string ToString() const;
+};
+
+#endif
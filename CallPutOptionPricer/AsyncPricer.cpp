@@ -0,0 +1,267 @@
+/* Asynchronous pricing with micro-batching implementation */
+/*****************************************************
+Name: AsyncPricer.cpp
+version: 0.1
+Description:
+Implementation of the functions in AsyncPricer.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "AsyncPricer.hpp"
+#include "OptionPricerCAPI.h"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+static const double ASYNC_NAN = std::numeric_limits<double>::quiet_NaN();
+
+/*Configuration and statistics*/
+AsyncConfig::AsyncConfig() : queue_capacity(1 << 14), max_batch(1024), max_delay_us(50), threads(1) {
+
+}
+
+std::string AsyncStats::ToString() const {
+	std::stringstream ss;
+	ss << "Requests: " << requests << "\nBatches: " << batches << " (mean " << (batches ? (double)requests / batches : 0.0)
+		<< ", largest " << largest_batch << ")\nKernel calls: " << groups << "\nRejected: " << rejected << "\nBlocked submits: " << waited << endl;
+	return ss.str();
+}
+
+/*Constructor and destructor*/
+AsyncPricer::AsyncPricer(const AsyncConfig& p_config) : config(p_config), head(0), count(0), stopping(false) {
+	config.queue_capacity = std::max(config.queue_capacity, (size_t)1);
+	config.max_batch = std::max(std::min(config.max_batch, config.queue_capacity), (size_t)1);
+	stats = AsyncStats();
+	//every table is sized once, queuing and pricing allocate nothing but the shared state of the futures
+	queue.resize(config.queue_capacity);
+	batch.resize(config.max_batch);
+	results.resize(config.max_batch);
+	order.resize(config.max_batch);
+	type.resize(config.max_batch);
+	S.resize(config.max_batch);
+	K.resize(config.max_batch);
+	T.resize(config.max_batch);
+	sig.resize(config.max_batch);
+	rf.resize(config.max_batch);
+	b.resize(config.max_batch);
+	price.resize(config.max_batch);
+	out.resize(config.max_batch);
+	scheduler = std::thread(&AsyncPricer::Run, this);
+}
+
+AsyncPricer::~AsyncPricer() {
+	Stop();
+}
+
+/*Submission*/
+bool AsyncPricer::Enqueue(const AsyncRequest& request, std::promise<AsyncResult>* promise, const AsyncCallback* callback, bool wait) {
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	if (count == queue.size() && !stopping) {
+		if (!wait) {
+			stats.rejected++;
+			return false;
+		}
+		stats.waited++;
+		space_cv.wait(lock, [&]() { return count < queue.size() || stopping; });
+	}
+	if (stopping) {
+		return false;
+	}
+	Pending& slot = queue[(head + count) % queue.size()];
+	slot.request = request;
+	if (promise) {
+		slot.promise = std::move(*promise);
+		slot.callback = AsyncCallback();
+	}
+	else {
+		slot.callback = *callback;
+	}
+	count++;
+	//the scheduler only needs waking for the first request of a batch and when a batch is full
+	if (count == 1 || count == config.max_batch) {
+		work_cv.notify_one();
+	}
+	return true;
+}
+
+std::future<AsyncResult> AsyncPricer::Submit(const AsyncRequest& request) {
+	std::promise<AsyncResult> promise;
+	std::future<AsyncResult> result = promise.get_future();
+	if (!Enqueue(request, &promise, 0, true)) {
+		AsyncResult stopped = AsyncResult();
+		stopped.status = ASYNC_STOPPED;
+		stopped.value = ASYNC_NAN;
+		promise.set_value(stopped);
+	}
+	return result;
+}
+
+bool AsyncPricer::TrySubmit(const AsyncRequest& request, std::future<AsyncResult>& result) {
+	std::promise<AsyncResult> promise;
+	std::future<AsyncResult> future = promise.get_future();
+	if (!Enqueue(request, &promise, 0, false)) {
+		return false;
+	}
+	result = std::move(future);
+	return true;
+}
+
+bool AsyncPricer::TrySubmit(const AsyncRequest& request, const AsyncCallback& done) {
+	return Enqueue(request, 0, &done, false);
+}
+
+/*Control*/
+void AsyncPricer::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		stopping = true;
+	}
+	work_cv.notify_all();
+	space_cv.notify_all();
+	if (scheduler.joinable()) {
+		scheduler.join();
+	}
+}
+
+AsyncStats AsyncPricer::Stats() const {
+	return stats;
+}
+
+/*Scheduler*/
+void AsyncPricer::Run() {
+	while (true) {
+		size_t n = 0;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			work_cv.wait(lock, [&]() { return count > 0 || stopping; });
+			if (count == 0) { //stopping with nothing queued
+				return;
+			}
+			//batching window: the first request waits a little for others
+			if (count < config.max_batch && !stopping) {
+				work_cv.wait_for(lock, std::chrono::microseconds(config.max_delay_us), [&]() { return count >= config.max_batch || stopping; });
+			}
+			n = std::min(count, config.max_batch);
+			for (size_t i = 0; i < n; i++) {
+				Pending& slot = queue[(head + i) % queue.size()];
+				batch[i].request = slot.request;
+				batch[i].promise = std::move(slot.promise);
+				batch[i].callback.swap(slot.callback);
+				slot.callback = AsyncCallback();
+			}
+			head = (head + n) % queue.size();
+			count -= n;
+			stats.requests += n;
+			stats.batches++;
+			stats.largest_batch = std::max(stats.largest_batch, (unsigned long long)n);
+		}
+		space_cv.notify_all();
+		Process(n);
+		for (size_t i = 0; i < n; i++) {
+			if (batch[i].callback) {
+				batch[i].callback(results[i]);
+				batch[i].callback = AsyncCallback();
+			}
+			else {
+				batch[i].promise.set_value(results[i]);
+			}
+		}
+	}
+}
+
+void AsyncPricer::Process(size_t n) {
+	PRICER_PROBE("AsyncPricer::Process");
+	//groups of the same kind and mask, each priced by one kernel call
+	for (size_t i = 0; i < n; i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.begin() + n, [&](size_t x, size_t y) {
+		const AsyncRequest& rx = batch[x].request;
+		const AsyncRequest& ry = batch[y].request;
+		return rx.kind < ry.kind || (rx.kind == ry.kind && rx.kind == ASYNC_GREEKS && rx.mask < ry.mask);
+	});
+	size_t start = 0;
+	while (start < n) {
+		const AsyncRequest& first = batch[order[start]].request;
+		size_t end = start + 1;
+		while (end < n && batch[order[end]].request.kind == first.kind && (first.kind != ASYNC_GREEKS || batch[order[end]].request.mask == first.mask)) {
+			end++;
+		}
+		ProcessGroup(&order[start], end - start);
+		stats.groups++;
+		start = end;
+	}
+}
+
+void AsyncPricer::ProcessGroup(const size_t* index, size_t n) {
+	const AsyncRequest& first = batch[index[0]].request;
+	//structure of arrays columns of the group
+	for (size_t i = 0; i < n; i++) {
+		const AsyncRequest& r = batch[index[i]].request;
+		type[i] = r.type;
+		S[i] = r.S;
+		K[i] = r.K;
+		T[i] = r.T;
+		sig[i] = r.sig;
+		rf[i] = r.rf;
+		b[i] = r.b;
+		price[i] = r.price;
+		AsyncResult& result = results[index[i]];
+		result = AsyncResult();
+		result.status = (r.type >= EU_CALL && r.type <= US_PUT) ? ASYNC_OK : ASYNC_BAD_TYPE;
+		result.value = ASYNC_NAN;
+	}
+	if (first.kind == ASYNC_PRICE) {
+		op_price(n, &type[0], &S[0], &K[0], &T[0], &sig[0], &rf[0], &b[0], &out[0], config.threads);
+		for (size_t i = 0; i < n; i++) {
+			results[index[i]].value = out[i];
+		}
+	}
+	else if (first.kind == ASYNC_IMPLIED_VOL) {
+		op_implied_vol(n, &type[0], &price[0], &S[0], &K[0], &T[0], &rf[0], &b[0], &out[0], 0, config.threads);
+		for (size_t i = 0; i < n; i++) {
+			AsyncResult& result = results[index[i]];
+			result.value = out[i];
+			if (result.status == ASYNC_OK && out[i] != out[i]) {
+				result.status = ASYNC_NO_SOLUTION;
+			}
+		}
+	}
+	else if (first.kind == ASYNC_GREEKS) {
+		unsigned int mask = first.mask ? first.mask : (unsigned int)OUT_PRICE;
+		DispatchOutputMask(mask, [&](auto tag) {
+			constexpr unsigned int Mask = decltype(tag)::value;
+			for (size_t i = 0; i < n; i++) {
+				AsyncResult& result = results[index[i]];
+				if (result.status == ASYNC_OK) {
+					GreeksKernel<Mask>(type[i], S[i], K[i], T[i], sig[i], rf[i], b[i], mask, result.outputs);
+				}
+			}
+		});
+	}
+	else {
+		for (size_t i = 0; i < n; i++) {
+			results[index[i]].status = ASYNC_BAD_TYPE;
+		}
+	}
+}
+
+/*Requests*/
+AsyncRequest AsyncPricer::PriceRequest(int type, double S, double K, double T, double sig, double rf, double b) {
+	AsyncRequest r = { ASYNC_PRICE, OUT_PRICE, type, S, K, T, sig, rf, b, 0.0 };
+	return r;
+}
+
+AsyncRequest AsyncPricer::GreeksRequest(int type, double S, double K, double T, double sig, double rf, double b, unsigned int mask) {
+	AsyncRequest r = { ASYNC_GREEKS, mask, type, S, K, T, sig, rf, b, 0.0 };
+	return r;
+}
+
+AsyncRequest AsyncPricer::ImpliedVolRequest(int type, double price, double S, double K, double T, double rf, double b) {
+	AsyncRequest r = { ASYNC_IMPLIED_VOL, OUT_PRICE, type, S, K, T, 0.0, rf, b, price };
+	return r;
+}
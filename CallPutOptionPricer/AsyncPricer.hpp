@@ -0,0 +1,145 @@
+/* Asynchronous pricing with micro-batching */
+/*****************************************************
+Name: AsyncPricer.hpp
+version: 0.1
+Description:
+Asynchronous front end of the pricing kernels for callers that issue many small concurrent requests (a gateway
+quoting one contract per client message). Callers submit price, Greeks or implied volatility requests from any
+thread and get a std::future of the result, or a callback run when the result is ready, so an I/O thread never
+waits for the pricing.
+
+One scheduler thread gathers the requests into batches: once a request is queued it waits at most max_delay_us
+for more to arrive (or until max_batch are queued), takes them all, groups them by kind and output mask and prices
+every group in one pass over structure of arrays columns (op_price / op_implied_vol of OptionPricerCAPI.h and
+GreeksKernel of PricingKernels.hpp), then fulfils the futures and runs the callbacks. Lone requests therefore pay
+at most max_delay_us of extra latency while bursts are priced at batch throughput.
+
+The queue is bounded (queue_capacity requests) for back-pressure: Submit blocks while the queue is full, TrySubmit
+returns false instead so that the caller can shed load or retry. Stop() prices what is queued and joins the
+scheduler; requests submitted afterwards complete at once with ASYNC_STOPPED.
+Callbacks run on the scheduler thread and must be short.
+
+This is the future based form of an awaitable API: the project builds as C++14, where coroutines are not available.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef ASYNCPRICER_HPP
+#define ASYNCPRICER_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "PricingKernels.hpp"
+using namespace std;
+
+enum AsyncKind {
+	ASYNC_PRICE = 0,
+	ASYNC_GREEKS = 1,
+	ASYNC_IMPLIED_VOL = 2
+};
+
+enum AsyncStatus {
+	ASYNC_OK = 0,
+	ASYNC_BAD_TYPE = -2, //unknown option type or request kind
+	ASYNC_NO_SOLUTION = -3, //implied volatility: the price is outside the no-arbitrage bounds
+	ASYNC_STOPPED = -4 //submitted after Stop
+};
+
+struct AsyncRequest {
+	int kind; //AsyncKind
+	unsigned int mask; //outputs of an ASYNC_GREEKS request (OutputFlag)
+	int type; //OptionType
+	double S, K, T, sig, rf, b; //sig is ignored by ASYNC_IMPLIED_VOL
+	double price; //market price of an ASYNC_IMPLIED_VOL request
+};
+
+struct AsyncResult {
+	int status; //AsyncStatus
+	double value; //price (ASYNC_PRICE) or implied volatility (ASYNC_IMPLIED_VOL)
+	OptionOutputs<double> outputs; //outputs of the mask (ASYNC_GREEKS)
+};
+
+typedef std::function<void(const AsyncResult&)> AsyncCallback;
+
+struct AsyncConfig {
+	size_t queue_capacity; //requests queued before Submit blocks and TrySubmit fails
+	size_t max_batch; //requests priced in one batch
+	unsigned int max_delay_us; //time the first request of a batch waits for others
+	int threads; //threads of the batch kernels, 1 prices on the scheduler thread
+
+	AsyncConfig();
+};
+
+struct AsyncStats {
+	unsigned long long requests; //requests priced
+	unsigned long long batches;
+	unsigned long long largest_batch;
+	unsigned long long groups; //kernel calls (one per kind and mask in a batch)
+	unsigned long long rejected; //TrySubmit refused because the queue was full
+	unsigned long long waited; //Submit blocked because the queue was full
+
+	std::string ToString() const;
+};
+
+class AsyncPricer {
+private:
+	struct Pending {
+		AsyncRequest request;
+		std::promise<AsyncResult> promise;
+		AsyncCallback callback; //empty when the result goes to the promise
+	};
+
+	AsyncConfig config;
+	std::vector<Pending> queue; //ring of queue_capacity requests
+	size_t head, count;
+	std::mutex queue_mutex;
+	std::condition_variable work_cv; //scheduler: requests queued or stopping
+	std::condition_variable space_cv; //producers: room in the queue
+	bool stopping;
+	std::thread scheduler;
+	AsyncStats stats;
+
+	/*Scheduler only*/
+	std::vector<Pending> batch;
+	std::vector<AsyncResult> results;
+	std::vector<size_t> order;
+	std::vector<int> type;
+	std::vector<double> S, K, T, sig, rf, b, price, out;
+
+	AsyncPricer(const AsyncPricer& source);
+	AsyncPricer& operator = (const AsyncPricer& source);
+
+	bool Enqueue(const AsyncRequest& request, std::promise<AsyncResult>* promise, const AsyncCallback* callback, bool wait);
+	void Run();
+	void Process(size_t n);
+	void ProcessGroup(const size_t* index, size_t n);
+
+public:
+	/*Constructor and destructor. The scheduler starts with the pricer*/
+	AsyncPricer(const AsyncConfig& p_config = AsyncConfig());
+	virtual ~AsyncPricer();
+
+	/*Submission from any thread*/
+	std::future<AsyncResult> Submit(const AsyncRequest& request); //blocks while the queue is full
+	bool TrySubmit(const AsyncRequest& request, std::future<AsyncResult>& result); //false if the queue is full or stopped
+	bool TrySubmit(const AsyncRequest& request, const AsyncCallback& done); //done runs on the scheduler thread
+
+	/*Control*/
+	void Stop(); //prices what is queued and joins the scheduler
+	AsyncStats Stats() const; //only consistent once stopped
+
+	/*Requests*/
+	static AsyncRequest PriceRequest(int type, double S, double K, double T, double sig, double rf, double b);
+	static AsyncRequest GreeksRequest(int type, double S, double K, double T, double sig, double rf, double b, unsigned int mask);
+	static AsyncRequest ImpliedVolRequest(int type, double price, double S, double K, double T, double rf, double b);
+};
+
+#endif
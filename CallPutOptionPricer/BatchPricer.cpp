@@ -0,0 +1,336 @@
+/* Batch pricing over an option book implementation */
+/*****************************************************
+Name: BatchPricer.cpp
+version: 0.7
+Description:
+Implementation of the functions in BatchPricer.hpp
+
+Change history:
+0.1 Initial version
+0.2 Grouped evaluation (GroupedPricer)
+0.3 Deduplication of identical contracts (PriceBookDedup)
+0.4 Pricing with rate and carry term structures
+0.5 Greeks selected by an output mask (PriceBookGreeks)
+0.6 Digital, gap and barrier options (PriceExotics)
+0.7 Intrinsic value of the perpetual contracts in their exercise region in GroupedPricer
+
+******************************************************/
+
+#include "BatchPricer.hpp"
+#include "PricingKernels.hpp"
+#include "ExoticKernels.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+void PriceBook(const OptionBook& book, std::vector<double>& prices) {
+	PRICER_PROBE("PriceBook");
+	prices.resize(book.size()); //allocates space
+	size_t offset = 0;
+	for (size_t blk = 0; blk < book.BlockCount(); blk++) {
+		const OptionContract* c = book.Block(blk);
+		size_t len = book.BlockLength(blk);
+		double* out = &prices[offset];
+		for (size_t i = 0; i < len; i++) {
+			out[i] = PriceKernel<double>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, c[i].rf, c[i].b);
+		}
+		offset += len;
+	}
+}
+
+void PriceBookGreeks(const OptionBook& book, unsigned int mask, GreekColumns& columns) {
+	PRICER_PROBE("PriceBookGreeks");
+	columns.Resize(mask, book.size());
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		OptionOutputs<double> out = OptionOutputs<double>();
+		size_t offset = 0;
+		for (size_t blk = 0; blk < book.BlockCount(); blk++) {
+			const OptionContract* c = book.Block(blk);
+			size_t len = book.BlockLength(blk);
+			for (size_t i = 0; i < len; i++) {
+				GreeksKernel<Mask>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, c[i].rf, c[i].b, mask, out);
+				columns.Store<Mask>(offset + i, out);
+			}
+			offset += len;
+		}
+	});
+}
+
+void PriceExotics(const std::vector<ExoticContract>& contracts, unsigned int mask, GreekColumns& columns) {
+	PRICER_PROBE("PriceExotics");
+	columns.Resize(mask, contracts.size());
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		OptionOutputs<double> out = OptionOutputs<double>();
+		for (size_t i = 0; i < contracts.size(); i++) {
+			const ExoticContract& c = contracts[i];
+			ExoticGreeksKernel<Mask>(c.type, c.S, c.K, c.T, c.sig, c.rf, c.b, c.H, c.cash, mask, out);
+			columns.Store<Mask>(i, out);
+		}
+	});
+}
+
+double BookValue(const OptionBook& book) {
+	PRICER_PROBE("BookValue");
+	double value = 0.0;
+	for (size_t blk = 0; blk < book.BlockCount(); blk++) {
+		const OptionContract* c = book.Block(blk);
+		size_t len = book.BlockLength(blk);
+		for (size_t i = 0; i < len; i++) {
+			value += c[i].qty * PriceKernel<double>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, c[i].rf, c[i].b);
+		}
+	}
+	return value;
+}
+
+/*Pricing with term curves implementation*/
+std::vector<double> BookExpiries(const OptionBook& book) {
+	std::vector<double> expiries;
+	for (size_t i = 0; i < book.size(); i++) {
+		if (book[i].type == EU_CALL || book[i].type == EU_PUT) {
+			expiries.push_back(book[i].T);
+		}
+	}
+	std::sort(expiries.begin(), expiries.end());
+	expiries.erase(std::unique(expiries.begin(), expiries.end()), expiries.end());
+	return expiries;
+}
+
+void PriceBook(const OptionBook& book, const TermCurve& rates, const TermCurve& carry, std::vector<double>& prices) {
+	PRICER_PROBE("PriceBook(curves)");
+	prices.resize(book.size()); //allocates space
+	const double long_rf = rates.LongRate();
+	const double long_b = carry.LongRate();
+	size_t offset = 0;
+	for (size_t blk = 0; blk < book.BlockCount(); blk++) {
+		const OptionContract* c = book.Block(blk);
+		size_t len = book.BlockLength(blk);
+		double* out = &prices[offset];
+		for (size_t i = 0; i < len; i++) {
+			if (c[i].type == US_CALL || c[i].type == US_PUT) {
+				out[i] = PriceKernel<double>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, long_rf, long_b);
+				continue;
+			}
+			double T = c[i].T;
+			double df = rates.DiscountFactor(T);
+			double fwd = c[i].S * carry.Growth(T); //forward of the underlying
+			double sd = c[i].sig * sqrt(T);
+			double d1 = log(fwd / c[i].K) / sd + 0.5 * sd;
+			double d2 = d1 - sd;
+			out[i] = (c[i].type == EU_CALL) ? df * (fwd * NormCdf<double>(d1) - c[i].K * NormCdf<double>(d2))
+				: df * (c[i].K * NormCdf<double>(-d2) - fwd * NormCdf<double>(-d1));
+		}
+		offset += len;
+	}
+}
+
+/*Deduplicated pricing implementation*/
+double DedupStats::ratio() const {
+	return (contracts > 0) ? 1.0 - (double)unique / (double)contracts : 0.0;
+}
+
+std::string DedupStats::ToString() const {
+	std::stringstream ss;
+	ss << "Contracts: " << contracts << "\nUnique contracts priced: " << unique << "\nDedup ratio: " << ratio() << endl;
+	return ss.str();
+}
+
+/*Pricing inputs of a contract. T is zeroed for perpetual contracts since it does not enter their price*/
+struct ContractKey {
+	double v[6]; //S, K, T, sig, rf, b
+	int type;
+
+	ContractKey(const OptionContract& c) {
+		bool perpetual = (c.type == US_CALL || c.type == US_PUT);
+		v[0] = c.S + 0.0; //adding 0.0 turns -0.0 into 0.0 so that equal values have equal bits
+		v[1] = c.K + 0.0;
+		v[2] = perpetual ? 0.0 : c.T + 0.0;
+		v[3] = c.sig + 0.0;
+		v[4] = c.rf + 0.0;
+		v[5] = c.b + 0.0;
+		type = c.type;
+	}
+
+	bool operator == (const ContractKey& other) const {
+		return type == other.type && memcmp(v, other.v, sizeof(v)) == 0;
+	}
+};
+
+struct ContractKeyHash {
+	size_t operator () (const ContractKey& key) const {
+		//FNV-1a style mixing of the bit patterns
+		unsigned long long h = 1469598103934665603ULL ^ (unsigned long long)key.type;
+		for (int i = 0; i < 6; i++) {
+			unsigned long long bits;
+			memcpy(&bits, &key.v[i], sizeof(bits));
+			h = (h ^ bits) * 1099511628211ULL;
+			h ^= h >> 29;
+		}
+		return (size_t)h;
+	}
+};
+
+void PriceBookDedup(const OptionBook& book, std::vector<double>& prices, DedupStats* stats) {
+	PRICER_PROBE("PriceBookDedup");
+	prices.resize(book.size()); //allocates space
+	std::unordered_map<ContractKey, size_t, ContractKeyHash> index; //tuple -> position in unique
+	index.reserve(book.size());
+	std::vector<size_t> unique; //book index of the first contract with each tuple
+	std::vector<size_t> slot(book.size()); //position in unique of every contract
+	for (size_t i = 0; i < book.size(); i++) {
+		std::pair<std::unordered_map<ContractKey, size_t, ContractKeyHash>::iterator, bool> inserted = index.insert(std::make_pair(ContractKey(book[i]), unique.size()));
+		if (inserted.second) {
+			unique.push_back(i);
+		}
+		slot[i] = inserted.first->second;
+	}
+	//price every distinct tuple once, then fan the prices out
+	std::vector<double> values(unique.size());
+	for (size_t u = 0; u < unique.size(); u++) {
+		const OptionContract& c = book[unique[u]];
+		values[u] = PriceKernel<double>(c.type, c.S, c.K, c.T, c.sig, c.rf, c.b);
+	}
+	for (size_t i = 0; i < book.size(); i++) {
+		prices[i] = values[slot[i]];
+	}
+	if (stats != 0) {
+		stats->contracts = book.size();
+		stats->unique = unique.size();
+	}
+}
+
+/*GroupedPricer implementation*/
+GroupedPricer::GroupedPricer() {
+
+}
+
+GroupedPricer::GroupedPricer(const OptionBook& book) {
+	Build(book);
+}
+
+GroupedPricer::~GroupedPricer() {
+
+}
+
+/*Orders contracts by (style, T, rf, b, sig); T is ignored for perpetual contracts*/
+struct GroupKeyLess {
+	const OptionBook& book;
+	GroupKeyLess(const OptionBook& p_book) : book(p_book) {}
+
+	static bool Perpetual(const OptionContract& c) {
+		return c.type == US_CALL || c.type == US_PUT;
+	}
+
+	bool operator () (size_t i, size_t j) const {
+		const OptionContract& a = book[i];
+		const OptionContract& c = book[j];
+		bool pa = Perpetual(a), pc = Perpetual(c);
+		if (pa != pc) return pa < pc;
+		if (!pa && a.T != c.T) return a.T < c.T;
+		if (a.rf != c.rf) return a.rf < c.rf;
+		if (a.b != c.b) return a.b < c.b;
+		if (a.sig != c.sig) return a.sig < c.sig;
+		return i < j;
+	}
+
+	bool SameGroup(size_t i, size_t j) const {
+		const OptionContract& a = book[i];
+		const OptionContract& c = book[j];
+		return Perpetual(a) == Perpetual(c) && (Perpetual(a) || a.T == c.T) && a.rf == c.rf && a.b == c.b && a.sig == c.sig;
+	}
+};
+
+void GroupedPricer::Build(const OptionBook& book) {
+	PRICER_PROBE("GroupedPricer::Build");
+	order.resize(book.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	GroupKeyLess less(book);
+	std::sort(order.begin(), order.end(), less);
+
+	groups.clear();
+	size_t begin = 0;
+	while (begin < order.size()) {
+		size_t end = begin + 1;
+		while (end < order.size() && less.SameGroup(order[begin], order[end])) {
+			end++;
+		}
+		const OptionContract& c = book[order[begin]];
+		Group g;
+		g.begin = begin;
+		g.end = end;
+		g.perpetual = GroupKeyLess::Perpetual(c);
+		g.df = g.carry = g.den = g.drift = g.y1 = g.y2 = g.call_boundary = g.put_boundary = 0.0;
+		if (g.perpetual) {
+			double sig2 = c.sig * c.sig;
+			double root = sqrt((c.b / sig2 - 0.5)*(c.b / sig2 - 0.5) + 2.0*c.rf / sig2);
+			g.y1 = 0.5 - c.b / sig2 + root;
+			g.y2 = 0.5 - c.b / sig2 - root;
+			g.call_boundary = (g.y1 > 1.0) ? g.y1 / (g.y1 - 1.0) : 0.0;
+			g.put_boundary = g.y2 / (g.y2 - 1.0);
+		}
+		else {
+			g.df = exp(-c.rf * c.T);
+			g.carry = exp((c.b - c.rf) * c.T);
+			g.den = c.sig * sqrt(c.T);
+			g.drift = (c.b + (c.sig*c.sig)*0.5) * c.T;
+		}
+		groups.push_back(g);
+		begin = end;
+	}
+}
+
+void GroupedPricer::Price(const OptionBook& book, std::vector<double>& prices) const {
+	PRICER_PROBE("GroupedPricer::Price");
+	prices.resize(book.size()); //allocates space
+	for (size_t g = 0; g < groups.size(); g++) {
+		const Group& grp = groups[g];
+		for (size_t k = grp.begin; k < grp.end; k++) {
+			size_t i = order[k];
+			const OptionContract& c = book[i];
+			double value;
+			if (grp.perpetual) {
+				if (c.type == US_CALL) {
+					if (grp.y1 <= 1.0) { //never exercised
+						value = c.S;
+					}
+					else if (c.S >= c.K * grp.call_boundary) { //exercise region S >= S*
+						value = c.S - c.K;
+					}
+					else {
+						value = (c.K / (grp.y1 - 1.0)) * pow(((grp.y1 - 1.0) / grp.y1 * c.S / c.K), grp.y1);
+					}
+				}
+				else if (c.S <= c.K * grp.put_boundary) { //exercise region S <= S*
+					value = c.K - c.S;
+				}
+				else {
+					value = (c.K / (1.0 - grp.y2)) * pow(((grp.y2 - 1.0) / grp.y2 * c.S / c.K), grp.y2);
+				}
+			}
+			else {
+				double d1 = (log(c.S / c.K) + grp.drift) / grp.den;
+				double d2 = d1 - grp.den;
+				if (c.type == EU_CALL) {
+					value = c.S * grp.carry * NormCdf(d1) - c.K * grp.df * NormCdf(d2);
+				}
+				else {
+					value = c.K * grp.df * NormCdf(-d2) - c.S * grp.carry * NormCdf(-d1);
+				}
+			}
+			prices[i] = value; //scatter back to book order
+		}
+	}
+}
+
+size_t GroupedPricer::size() const {
+	return order.size();
+}
+
+size_t GroupedPricer::GroupCount() const {
+	return groups.size();
+}
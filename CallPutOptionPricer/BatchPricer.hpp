@@ -0,0 +1,108 @@
+/* Batch pricing over an option book */
+/*****************************************************
+Name: BatchPricer.hpp
+version: 0.7
+Description:
+Batch pricers that stream through the blocks of an OptionBook and evaluate the kernels of PricingKernels.hpp.
+Results are written in book order.
+
+GroupedPricer sorts the contracts by their shared parameters: (T, rf, b, sig) for European contracts and (sig, rf, b)
+for perpetual ones. sqrt(T), e^(-rT), e^((b-r)T), sig*sqrt(T) and the drift of d1 (or the perpetual exponents y1 and y2)
+are computed once per group and only the strike and spot dependent part is evaluated per contract.
+The grouping only depends on T, sig, rf and b, so it can be reused while the spots move.
+
+PriceBookDedup hashes the (S, K, T, sig, rf, b, type) tuple of every contract, prices each distinct tuple once
+and copies the price to every position holding it. Quantities and underlying names are not part of the tuple.
+
+PriceBook(book, rates, carry, prices) ignores the rf and b of the contracts and reads them from term curves instead.
+Caching the expiries of the book in the curves first (BookExpiries) replaces the two exp calls per European
+contract by table lookups. Perpetual contracts use the long end of the curves.
+
+PriceBookGreeks(book, mask, columns) computes the outputs selected by a mask of OutputFlag (PricingKernels.hpp) in
+one pass over the book. Only the requested columns are allocated and computed: OUT_HEDGE costs about one pricing,
+OUT_ALL every Greek with the shared factors evaluated once per contract.
+
+PriceExotics(contracts, mask, columns) does the same for a vector of ExoticContract (digital, gap and single barrier
+options, ExoticKernels.hpp).
+
+Change history:
+0.1 Initial version
+0.2 Grouped evaluation (GroupedPricer)
+0.3 Deduplication of identical contracts (PriceBookDedup)
+0.4 Pricing with rate and carry term structures
+0.5 Greeks selected by an output mask (PriceBookGreeks)
+0.6 Digital, gap and barrier options (PriceExotics)
+0.7 Intrinsic value of the perpetual contracts in their exercise region in GroupedPricer
+
+******************************************************/
+
+#ifndef BATCHPRICER_HPP
+#define BATCHPRICER_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "OptionBook.hpp"
+#include "TermCurve.hpp"
+#include "PricingKernels.hpp"
+#include "ExoticKernels.hpp"
+
+/*Prices every contract of the book (per unit, without the quantity)*/
+void PriceBook(const OptionBook& book, std::vector<double>& prices);
+/*Market value of the book: sum of qty * price*/
+double BookValue(const OptionBook& book);
+
+/*Pricing with rate and carry curves in place of the flat rf and b of the contracts*/
+std::vector<double> BookExpiries(const OptionBook& book); //distinct expiries of the European contracts, to cache in the curves
+void PriceBook(const OptionBook& book, const TermCurve& rates, const TermCurve& carry, std::vector<double>& prices);
+
+/*Price and Greeks selected by mask (OutputFlag), in one pass*/
+void PriceBookGreeks(const OptionBook& book, unsigned int mask, GreekColumns& columns);
+/*Price and Greeks selected by mask of digital, gap and barrier options*/
+void PriceExotics(const std::vector<ExoticContract>& contracts, unsigned int mask, GreekColumns& columns);
+
+/*Deduplicated pricing*/
+struct DedupStats {
+	size_t contracts; //contracts in the request
+	size_t unique; //distinct contract tuples priced
+
+	double ratio() const; //fraction of the pricing work removed: 1 - unique/contracts
+	std::string ToString() const;
+};
+void PriceBookDedup(const OptionBook& book, std::vector<double>& prices, DedupStats* stats = 0);
+
+/*Pricer that shares the expiry and volatility dependent factors between contracts*/
+class GroupedPricer {
+private:
+	/*Contracts sharing T, rf, b and sig, with the factors computed once for all of them*/
+	struct Group {
+		size_t begin, end; //range in order
+		bool perpetual;
+		double df; //e^(-rf*T)
+		double carry; //e^((b-rf)*T)
+		double den; //sig*sqrt(T)
+		double drift; //(b + sig^2/2)*T
+		double y1, y2; //perpetual exponents
+		double call_boundary, put_boundary; //exercise levels per unit of strike, S*/K = y/(y-1)
+	};
+	std::vector<size_t> order; //book indices sorted by group
+	std::vector<Group> groups;
+
+public:
+	/*Constructor and destructor*/
+	GroupedPricer();
+	GroupedPricer(const OptionBook& book);
+	virtual ~GroupedPricer();
+
+	/*Groups the contracts of the book. Must be called again if contracts are added or T, sig, rf or b change*/
+	void Build(const OptionBook& book);
+
+	/*Prices every contract of the book, results in book order*/
+	void Price(const OptionBook& book, std::vector<double>& prices) const;
+
+	/*Grouping information*/
+	size_t size() const; //number of contracts grouped
+	size_t GroupCount() const;
+};
+
+#endif
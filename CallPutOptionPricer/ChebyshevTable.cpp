@@ -0,0 +1,618 @@
+/* Chebyshev interpolation tables implementation */
+/*****************************************************
+Name: ChebyshevTable.cpp
+version: 0.1
+Description:
+Implementation of the functions in ChebyshevTable.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "ChebyshevTable.hpp"
+#include "PricingKernels.hpp"
+#include "Instrumentation.hpp"
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const int DEGREE = 8; //max coefficients per active axis
+static const double PI = 3.14159265358979323846;
+
+/*File header, padded to 128 bytes so that the coefficients that follow are aligned*/
+struct ChebyshevFileHeader {
+	char magic[8];
+	int version;
+	int type;
+	int cells[3];
+	int degree[3];
+	double rf;
+	double b;
+	double lo[3];
+	double hi[3];
+	double max_error;
+	unsigned long long count; //number of coefficients
+	char reserved[8];
+};
+static_assert(sizeof(ChebyshevFileHeader) == 128, "the table file header must stay 128 bytes");
+static const char MAGIC[8] = { 'O', 'P', 'C', 'H', 'E', 'B', '0', '1' };
+
+/*Chebyshev polynomials T_j(t) and their first and second derivatives, j < n*/
+static void Basis(double t, int n, int order, double* out) {
+	double T[DEGREE], dT[DEGREE], d2T[DEGREE];
+	T[0] = 1.0; dT[0] = 0.0; d2T[0] = 0.0;
+	if (n > 1) {
+		T[1] = t; dT[1] = 1.0; d2T[1] = 0.0;
+	}
+	for (int j = 2; j < n; j++) {
+		T[j] = 2.0 * t * T[j - 1] - T[j - 2];
+		dT[j] = 2.0 * T[j - 1] + 2.0 * t * dT[j - 1] - dT[j - 2];
+		d2T[j] = 4.0 * dT[j - 1] + 2.0 * t * d2T[j - 1] - d2T[j - 2];
+	}
+	const double* src = (order == 0) ? T : (order == 1) ? dT : d2T;
+	for (int j = 0; j < n; j++) {
+		out[j] = src[j];
+	}
+}
+
+/*Constructor and destructor implementation*/
+ChebyshevTable::ChebyshevTable() : m_type(EU_CALL), rf(0.0), b(0.0), max_error(0.0), coeffs(0), map_base(0), map_length(0) {
+#ifdef _WIN32
+	map_file = 0;
+	map_handle = 0;
+#endif
+	for (int d = 0; d < 3; d++) {
+		cells[d] = 0;
+		degree[d] = 0;
+		lo[d] = hi[d] = width[d] = inv_width[d] = 0.0;
+	}
+}
+
+ChebyshevTable::~ChebyshevTable() {
+	Unmap();
+}
+
+void ChebyshevTable::Unmap() {
+	if (map_base != 0) {
+#ifdef _WIN32
+		UnmapViewOfFile(map_base);
+		CloseHandle((HANDLE)map_handle);
+		CloseHandle((HANDLE)map_file);
+		map_handle = 0;
+		map_file = 0;
+#else
+		munmap(map_base, map_length);
+#endif
+		map_base = 0;
+		map_length = 0;
+		coeffs = 0;
+	}
+}
+
+/*Evaluation implementation*/
+bool ChebyshevTable::Inside(double u0, double u1, double u2) const {
+	return u0 >= lo[0] && u0 <= hi[0] && u2 >= lo[2] && u2 <= hi[2] && (degree[1] == 1 || (u1 >= lo[1] && u1 <= hi[1]));
+}
+
+double ChebyshevTable::Evaluate(double u0, double u1, double u2, int o0, int o1, int o2) const {
+	const double u[3] = { u0, u1, u2 };
+	const int order[3] = { o0, o1, o2 };
+	double B[3][DEGREE];
+	double scale = 1.0;
+	size_t cell = 0;
+	for (int d = 0; d < 3; d++) {
+		int idx = 0;
+		double t = 0.0;
+		if (degree[d] > 1) {
+			idx = (int)((u[d] - lo[d]) / width[d]);
+			if (idx < 0) {
+				idx = 0;
+			}
+			if (idx >= cells[d]) {
+				idx = cells[d] - 1;
+			}
+			t = 2.0 * (u[d] - (lo[d] + idx * width[d])) / width[d] - 1.0;
+			for (int o = 0; o < order[d]; o++) {
+				scale *= 2.0 / width[d];
+			}
+		}
+		else if (order[d] > 0) {
+			return 0.0; //the value does not depend on an inactive axis
+		}
+		cell = cell * cells[d] + idx;
+		Basis(t, degree[d], order[d], B[d]);
+	}
+	const double* c = coeffs + cell * (size_t)(degree[0] * degree[1] * degree[2]);
+	double sum = 0.0;
+	for (int j0 = 0; j0 < degree[0]; j0++) {
+		for (int j1 = 0; j1 < degree[1]; j1++) {
+			double w = B[0][j0] * B[1][j1];
+			for (int j2 = 0; j2 < degree[2]; j2++) {
+				sum += w * B[2][j2] * c[j2];
+			}
+			c += degree[2];
+		}
+	}
+	return scale * sum;
+}
+
+/*Value of one cell: T_j(t) by recurrence, then the tensor sum contracted axis by axis. The degrees are template
+parameters for the default layouts so that every loop is unrolled*/
+template <int P0, int P1, int P2>
+static inline double CellValue(const double* c, const double* t, const int* degree) {
+	const int p0 = P0 ? P0 : degree[0], p1 = P1 ? P1 : degree[1], p2 = P2 ? P2 : degree[2];
+	double B[3][DEGREE];
+	const int p[3] = { p0, p1, p2 };
+	for (int d = 0; d < 3; d++) {
+		B[d][0] = 1.0;
+		B[d][1] = t[d];
+		for (int j = 2; j < p[d]; j++) {
+			B[d][j] = 2.0 * t[d] * B[d][j - 1] - B[d][j - 2];
+		}
+	}
+	//contract axis 0 into p1*p2 independent accumulators (vectorizes), then the two small remaining axes
+	const int p12 = p1 * p2;
+	double acc[DEGREE * DEGREE];
+	for (int k = 0; k < p12; k++) {
+		acc[k] = B[0][0] * c[k];
+	}
+	for (int j0 = 1; j0 < p0; j0++) {
+		const double w = B[0][j0];
+		const double* cj = c + j0 * p12;
+		for (int k = 0; k < p12; k++) {
+			acc[k] += w * cj[k];
+		}
+	}
+	double sum = 0.0;
+	for (int j1 = 0; j1 < p1; j1++) {
+		double s2 = 0.0;
+		for (int j2 = 0; j2 < p2; j2++) {
+			s2 += B[2][j2] * acc[j1 * p2 + j2];
+		}
+		sum += B[1][j1] * s2;
+	}
+	return sum;
+}
+
+double ChebyshevTable::EvaluateValue(double u0, double u1, double u2) const {
+	const double u[3] = { u0, u1, u2 };
+	double t[3];
+	size_t cell = 0;
+	for (int d = 0; d < 3; d++) {
+		int idx = 0;
+		t[d] = 0.0;
+		if (degree[d] > 1) {
+			double x = (u[d] - lo[d]) * inv_width[d]; //position in cell widths
+			idx = (int)x;
+			idx = (idx < 0) ? 0 : (idx >= cells[d]) ? cells[d] - 1 : idx;
+			t[d] = 2.0 * (x - idx) - 1.0;
+		}
+		cell = cell * cells[d] + idx;
+	}
+	const double* c = coeffs + cell * (size_t)(degree[0] * degree[1] * degree[2]);
+	if (degree[0] == 4 && degree[2] == 4) {
+		return (degree[1] == 4) ? CellValue<4, 4, 4>(c, t, degree) : (degree[1] == 1) ? CellValue<4, 1, 4>(c, t, degree) : CellValue<0, 0, 0>(c, t, degree);
+	}
+	return CellValue<0, 0, 0>(c, t, degree);
+}
+
+double ChebyshevTable::Exact(double S, double K, double T, double sig) const {
+	return PriceKernel<double>(m_type, S, K, T, sig, rf, b);
+}
+
+/*Building implementation*/
+void ChebyshevTable::Fit(std::vector<double>& out) const {
+	int p0 = degree[0], p1 = degree[1], p2 = degree[2];
+	int per_cell = p0 * p1 * p2;
+	//transform matrices M[d][j][k] = (2 - delta_j0)/p * cos(pi*j*(k + 1/2)/p) and nodes t_k = cos(pi*(k + 1/2)/p)
+	double M[3][DEGREE][DEGREE];
+	double nodes[3][DEGREE];
+	for (int d = 0; d < 3; d++) {
+		for (int k = 0; k < degree[d]; k++) {
+			nodes[d][k] = (degree[d] > 1) ? cos(PI * (k + 0.5) / degree[d]) : 0.0;
+			for (int j = 0; j < degree[d]; j++) {
+				M[d][j][k] = ((j == 0) ? 1.0 : 2.0) / degree[d] * cos(PI * j * (k + 0.5) / degree[d]);
+			}
+		}
+	}
+	out.assign((size_t)cells[0] * cells[1] * cells[2] * per_cell, 0.0);
+	std::vector<double> f(per_cell), tmp1(per_cell), tmp2(per_cell);
+	size_t cell = 0;
+	for (int c0 = 0; c0 < cells[0]; c0++) {
+		for (int c1 = 0; c1 < cells[1]; c1++) {
+			for (int c2 = 0; c2 < cells[2]; c2++, cell++) {
+				//samples at the Chebyshev nodes of the cell, with K = 1
+				for (int k0 = 0; k0 < p0; k0++) {
+					double x = exp(lo[0] + (c0 + 0.5 * (nodes[0][k0] + 1.0)) * width[0]);
+					for (int k1 = 0; k1 < p1; k1++) {
+						double T = lo[1] + (c1 + 0.5 * (nodes[1][k1] + 1.0)) * width[1];
+						for (int k2 = 0; k2 < p2; k2++) {
+							double sig = lo[2] + (c2 + 0.5 * (nodes[2][k2] + 1.0)) * width[2];
+							f[(k0 * p1 + k1) * p2 + k2] = Exact(x, 1.0, T, sig);
+						}
+					}
+				}
+				//separable discrete Chebyshev transform, one axis at a time
+				for (int k0 = 0; k0 < p0; k0++)
+					for (int k1 = 0; k1 < p1; k1++)
+						for (int j2 = 0; j2 < p2; j2++) {
+							double s = 0.0;
+							for (int k2 = 0; k2 < p2; k2++) s += M[2][j2][k2] * f[(k0 * p1 + k1) * p2 + k2];
+							tmp1[(k0 * p1 + k1) * p2 + j2] = s;
+						}
+				for (int k0 = 0; k0 < p0; k0++)
+					for (int j1 = 0; j1 < p1; j1++)
+						for (int j2 = 0; j2 < p2; j2++) {
+							double s = 0.0;
+							for (int k1 = 0; k1 < p1; k1++) s += M[1][j1][k1] * tmp1[(k0 * p1 + k1) * p2 + j2];
+							tmp2[(k0 * p1 + j1) * p2 + j2] = s;
+						}
+				double* c = &out[cell * per_cell];
+				for (int j0 = 0; j0 < p0; j0++)
+					for (int j1 = 0; j1 < p1; j1++)
+						for (int j2 = 0; j2 < p2; j2++) {
+							double s = 0.0;
+							for (int k0 = 0; k0 < p0; k0++) s += M[0][j0][k0] * tmp2[(k0 * p1 + j1) * p2 + j2];
+							c[(j0 * p1 + j1) * p2 + j2] = s;
+						}
+			}
+		}
+	}
+}
+
+double ChebyshevTable::Validate() const {
+	//cell edges and points away from the interpolation nodes
+	const double t[7] = { -1.0, -0.71, -0.37, 0.05, 0.42, 0.77, 1.0 };
+	double err = 0.0;
+	for (int c0 = 0; c0 < cells[0]; c0++)
+		for (int c1 = 0; c1 < cells[1]; c1++)
+			for (int c2 = 0; c2 < cells[2]; c2++)
+				for (int k0 = 0; k0 < 7; k0++)
+					for (int k1 = 0; k1 < (degree[1] > 1 ? 7 : 1); k1++)
+						for (int k2 = 0; k2 < 7; k2++) {
+							double u0 = lo[0] + (c0 + 0.5 * (t[k0] + 1.0)) * width[0];
+							double u1 = lo[1] + (c1 + 0.5 * (t[k1] + 1.0)) * width[1];
+							double u2 = lo[2] + (c2 + 0.5 * (t[k2] + 1.0)) * width[2];
+							double e = fabs(Evaluate(u0, u1, u2, 0, 0, 0) - Exact(exp(u0), 1.0, u1, u2));
+							if (!(e <= err)) {
+								err = e; //also propagates NaN
+							}
+						}
+	return err;
+}
+
+bool ChebyshevTable::Build(int type, double p_rf, double p_b, const ChebyshevBox& box, double tolerance, int p_degree, size_t max_cells) {
+	PRICER_PROBE("ChebyshevTable::Build");
+	if (box.x_lo <= 0.0 || box.x_hi <= box.x_lo || box.sig_lo <= 0.0 || box.sig_hi <= box.sig_lo || tolerance <= 0.0
+		|| ((type == EU_CALL || type == EU_PUT) && (box.T_lo <= 0.0 || box.T_hi <= box.T_lo)) || type < EU_CALL || type > US_PUT
+		|| p_degree < 2 || p_degree > DEGREE) {
+		cout << "Invalid input. The box must have positive, increasing bounds, the tolerance must be positive and the degree between 2 and " << DEGREE << endl;
+		return false;
+	}
+	Unmap();
+	m_type = type;
+	rf = p_rf;
+	b = p_b;
+	bool perpetual = (type == US_CALL || type == US_PUT);
+	lo[0] = log(box.x_lo);
+	hi[0] = log(box.x_hi);
+	lo[1] = perpetual ? 0.0 : box.T_lo;
+	hi[1] = perpetual ? 0.0 : box.T_hi;
+	lo[2] = box.sig_lo;
+	hi[2] = box.sig_hi;
+	degree[0] = p_degree;
+	degree[1] = perpetual ? 1 : p_degree;
+	degree[2] = p_degree;
+	cells[0] = 4;
+	cells[1] = perpetual ? 1 : 2;
+	cells[2] = 2;
+
+	for (;;) {
+		for (int d = 0; d < 3; d++) {
+			width[d] = (degree[d] > 1) ? (hi[d] - lo[d]) / cells[d] : 1.0;
+			inv_width[d] = 1.0 / width[d];
+		}
+		Fit(owned);
+		coeffs = &owned[0];
+		max_error = Validate();
+		if (max_error <= tolerance) {
+			return true;
+		}
+		//error indicator per axis: largest sum of |c| over the highest order coefficients of that axis
+		double tail[3] = { 0.0, 0.0, 0.0 };
+		int per_cell = degree[0] * degree[1] * degree[2];
+		for (size_t cell = 0; cell < owned.size() / per_cell; cell++) {
+			double s[3] = { 0.0, 0.0, 0.0 };
+			for (int j0 = 0; j0 < degree[0]; j0++)
+				for (int j1 = 0; j1 < degree[1]; j1++)
+					for (int j2 = 0; j2 < degree[2]; j2++) {
+						double a = fabs(owned[cell * per_cell + (j0 * degree[1] + j1) * degree[2] + j2]);
+						if (j0 == degree[0] - 1) s[0] += a;
+						if (degree[1] > 1 && j1 == degree[1] - 1) s[1] += a;
+						if (j2 == degree[2] - 1) s[2] += a;
+					}
+			for (int d = 0; d < 3; d++) {
+				if (s[d] > tail[d]) {
+					tail[d] = s[d];
+				}
+			}
+		}
+		double worst = tail[0] > tail[1] ? (tail[0] > tail[2] ? tail[0] : tail[2]) : (tail[1] > tail[2] ? tail[1] : tail[2]);
+		size_t total = (size_t)cells[0] * cells[1] * cells[2];
+		for (int d = 0; d < 3; d++) {
+			if (degree[d] > 1 && tail[d] >= 0.5 * worst) {
+				total = total / cells[d] * (2 * cells[d]);
+			}
+		}
+		if (total > max_cells) {
+			cout << "Chebyshev table: tolerance " << tolerance << " not reached within " << max_cells << " cells (max error " << max_error << ")" << endl;
+			return false;
+		}
+		for (int d = 0; d < 3; d++) {
+			if (degree[d] > 1 && tail[d] >= 0.5 * worst) {
+				cells[d] *= 2;
+			}
+		}
+	}
+}
+
+/*Lookups implementation*/
+double ChebyshevTable::Price(double S, double K, double T, double sig) const {
+	double u0 = log(S / K);
+	if (!Inside(u0, T, sig)) {
+		return Exact(S, K, T, sig);
+	}
+	return K * EvaluateValue(u0, T, sig);
+}
+
+double ChebyshevTable::Delta(double S, double K, double T, double sig) const {
+	//V = K*v(x) with x = ln(S/K): dV/dS = K*v'(x)/S
+	double u0 = log(S / K);
+	if (!Inside(u0, T, sig)) {
+		double h = 1e-4 * S;
+		return (Exact(S + h, K, T, sig) - Exact(S - h, K, T, sig)) / (2.0 * h);
+	}
+	return K * Evaluate(u0, T, sig, 1, 0, 0) / S;
+}
+
+double ChebyshevTable::Gamma(double S, double K, double T, double sig) const {
+	//d2V/dS2 = K*(v''(x) - v'(x))/S^2
+	double u0 = log(S / K);
+	if (!Inside(u0, T, sig)) {
+		double h = 1e-3 * S;
+		return (Exact(S + h, K, T, sig) - 2.0 * Exact(S, K, T, sig) + Exact(S - h, K, T, sig)) / (h * h);
+	}
+	return K * (Evaluate(u0, T, sig, 2, 0, 0) - Evaluate(u0, T, sig, 1, 0, 0)) / (S * S);
+}
+
+double ChebyshevTable::Vega(double S, double K, double T, double sig) const {
+	double u0 = log(S / K);
+	if (!Inside(u0, T, sig)) {
+		double h = 1e-4;
+		return (Exact(S, K, T, sig + h) - Exact(S, K, T, sig - h)) / (2.0 * h);
+	}
+	return K * Evaluate(u0, T, sig, 0, 0, 1);
+}
+
+double ChebyshevTable::Theta(double S, double K, double T, double sig) const {
+	if (degree[1] == 1) {
+		return 0.0;
+	}
+	double u0 = log(S / K);
+	if (!Inside(u0, T, sig)) {
+		double h = 1e-4 * T;
+		return -(Exact(S, K, T + h, sig) - Exact(S, K, T - h, sig)) / (2.0 * h);
+	}
+	return -K * Evaluate(u0, T, sig, 0, 1, 0);
+}
+
+void ChebyshevTable::PriceBatch(size_t n, const double* S, const double* K, const double* T, const double* sig, double* out) const {
+	PRICER_PROBE("ChebyshevTable::PriceBatch");
+	for (size_t i = 0; i < n; i++) {
+		out[i] = Price(S[i], K[i], T[i], sig[i]);
+	}
+}
+
+/*Table information implementation*/
+bool ChebyshevTable::IsValid() const {
+	return coeffs != 0;
+}
+
+int ChebyshevTable::type() const {
+	return m_type;
+}
+
+double ChebyshevTable::rate() const {
+	return rf;
+}
+
+double ChebyshevTable::CostOfCarry() const {
+	return b;
+}
+
+double ChebyshevTable::MaxError() const {
+	return max_error;
+}
+
+size_t ChebyshevTable::CellCount() const {
+	return (size_t)cells[0] * cells[1] * cells[2];
+}
+
+size_t ChebyshevTable::MemoryUsage() const {
+	return CellCount() * degree[0] * degree[1] * degree[2] * sizeof(double);
+}
+
+/*Serialization implementation*/
+bool ChebyshevTable::Save(const std::string& path) const {
+	if (!IsValid()) {
+		return false;
+	}
+	ChebyshevFileHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, MAGIC, sizeof(MAGIC));
+	h.version = 1;
+	h.type = m_type;
+	for (int d = 0; d < 3; d++) {
+		h.cells[d] = cells[d];
+		h.degree[d] = degree[d];
+		h.lo[d] = lo[d];
+		h.hi[d] = hi[d];
+	}
+	h.rf = rf;
+	h.b = b;
+	h.max_error = max_error;
+	h.count = CellCount() * degree[0] * degree[1] * degree[2];
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == 0) {
+		return false;
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, file) == 1 && fwrite(coeffs, sizeof(double), (size_t)h.count, file) == h.count;
+	return fclose(file) == 0 && ok;
+}
+
+static bool ReadHeader(const ChebyshevFileHeader& h, size_t file_size) {
+	if (file_size < sizeof(h) || memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != 1) {
+		cout << "Not a Chebyshev table file" << endl;
+		return false;
+	}
+	//layout: every axis within the evaluation buffers, the count matching the cells and degrees
+	bool ok = (h.type >= EU_CALL && h.type <= US_PUT);
+	unsigned long long available = (file_size - sizeof(h)) / sizeof(double);
+	unsigned long long expected = 1;
+	for (int d = 0; d < 3 && ok; d++) {
+		bool active = (h.degree[d] > 1);
+		ok = h.degree[d] >= 1 && h.degree[d] <= DEGREE && h.cells[d] >= 1 && (active || h.cells[d] == 1)
+			&& (!active || h.hi[d] > h.lo[d]) && (d == 1 || active);
+		if (ok) {
+			expected *= (unsigned long long)h.cells[d] * (unsigned long long)h.degree[d];
+			ok = (expected <= available); //also bounds the product against overflow
+		}
+	}
+	if (!ok || h.count != expected) {
+		cout << "Corrupt Chebyshev table file" << endl;
+		return false;
+	}
+	if (file_size != sizeof(h) + h.count * sizeof(double)) {
+		cout << "Truncated Chebyshev table file" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool ChebyshevTable::Load(const std::string& path) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == 0) {
+		return false;
+	}
+	ChebyshevFileHeader h;
+	bool ok = fread(&h, sizeof(h), 1, file) == 1;
+	if (ok) {
+		fseek(file, 0, SEEK_END);
+		ok = ReadHeader(h, (size_t)ftell(file));
+		fseek(file, sizeof(h), SEEK_SET);
+	}
+	std::vector<double> data;
+	if (ok) {
+		data.resize((size_t)h.count);
+		ok = fread(&data[0], sizeof(double), data.size(), file) == data.size();
+	}
+	fclose(file);
+	if (!ok) {
+		return false;
+	}
+	Unmap();
+	owned.swap(data);
+	coeffs = &owned[0];
+	m_type = h.type;
+	rf = h.rf;
+	b = h.b;
+	max_error = h.max_error;
+	for (int d = 0; d < 3; d++) {
+		cells[d] = h.cells[d];
+		degree[d] = h.degree[d];
+		lo[d] = h.lo[d];
+		hi[d] = h.hi[d];
+		width[d] = (degree[d] > 1) ? (hi[d] - lo[d]) / cells[d] : 1.0;
+		inv_width[d] = 1.0 / width[d];
+	}
+	return true;
+}
+
+bool ChebyshevTable::Map(const std::string& path) {
+	Unmap();
+	void* base = 0;
+	size_t length = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size_t)size.QuadPart < sizeof(ChebyshevFileHeader)) {
+		CloseHandle(file);
+		return false;
+	}
+	length = (size_t)size.QuadPart;
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping != 0) {
+		base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (base == 0) {
+		if (mapping != 0) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	map_file = file;
+	map_handle = mapping;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ChebyshevFileHeader)) {
+		close(fd);
+		return false;
+	}
+	length = (size_t)st.st_size;
+	base = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); //the mapping stays valid after the descriptor is closed
+	if (base == MAP_FAILED) {
+		return false;
+	}
+#endif
+	map_base = base;
+	map_length = length;
+	const ChebyshevFileHeader& h = *static_cast<const ChebyshevFileHeader*>(base);
+	if (!ReadHeader(h, length)) {
+		Unmap();
+		return false;
+	}
+	owned.clear();
+	coeffs = reinterpret_cast<const double*>(static_cast<const char*>(base) + sizeof(ChebyshevFileHeader));
+	m_type = h.type;
+	rf = h.rf;
+	b = h.b;
+	max_error = h.max_error;
+	for (int d = 0; d < 3; d++) {
+		cells[d] = h.cells[d];
+		degree[d] = h.degree[d];
+		lo[d] = h.lo[d];
+		hi[d] = h.hi[d];
+		width[d] = (degree[d] > 1) ? (hi[d] - lo[d]) / cells[d] : 1.0;
+		inv_width[d] = 1.0 / width[d];
+	}
+	return true;
+}
@@ -0,0 +1,114 @@
+/* Chebyshev interpolation tables */
+/*****************************************************
+Name: ChebyshevTable.hpp
+version: 0.1
+Description:
+Precomputed piecewise Chebyshev approximations of the option value for very fast price and Greek lookups.
+
+Prices are homogeneous in (S, K): V(S, K, T, sig) = K * v(ln(S/K), T, sig) for fixed rf and b,
+so a table built for one (rf, b, type) serves every strike. The box
+	S/K in [x_lo, x_hi], T in [T_lo, T_hi], sig in [sig_lo, sig_hi]
+is cut in cells and each cell holds a tensor product Chebyshev polynomial with p_degree coefficients per axis
+(4 by default, i.e. 64 coefficients per cell), so a lookup is a cell index computation plus a fixed size sum whatever
+the accuracy of the table. Higher degrees need fewer cells (smaller tables) but cost more per lookup.
+Perpetual American tables (US_CALL, US_PUT) have no T axis and p_degree^2 coefficients per cell.
+
+Build() refines the cells axis by axis, using the size of the highest order Chebyshev coefficients as the error
+indicator of each axis, until the error measured on a validation grid (cell edges and points between the nodes)
+is below the tolerance. The tolerance and MaxError() are expressed per unit of strike. MaxError() is the largest error
+measured on the validation grid, not a bound: between the grid points the price error is about K * MaxError() but can
+exceed it.
+Points outside the box are priced with the exact kernels.
+
+Tables can be saved to disk and memory-mapped at startup with Map() instead of being rebuilt.
+The file layout is a 128 byte header followed by the coefficients in native byte order. Load() and Map() reject
+headers whose degrees, cell counts or coefficient count do not describe the file.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef CHEBYSHEVTABLE_HPP
+#define CHEBYSHEVTABLE_HPP
+
+#include <string>
+#include <vector>
+#include "OptionData.hpp"
+using namespace std;
+
+/*Domain of a table*/
+struct ChebyshevBox {
+	double x_lo, x_hi; //moneyness S/K
+	double T_lo, T_hi; //expiry (ignored by perpetual tables)
+	double sig_lo, sig_hi; //volatility
+};
+
+class ChebyshevTable {
+private:
+	/*Model parameters the table was built for*/
+	int m_type; //OptionType
+	double rf;
+	double b;
+
+	/*Layout: axis 0 = ln(S/K), axis 1 = T, axis 2 = sig*/
+	int cells[3]; //number of cells per axis
+	int degree[3]; //number of Chebyshev coefficients per axis in every cell
+	double lo[3], hi[3]; //box in axis units
+	double width[3]; //cell width per axis
+	double inv_width[3]; //1 / width, the lookups multiply instead of dividing
+	double max_error; //max error per unit of strike measured on the validation grid
+
+	/*Coefficients: either owned (built or loaded) or pointing into a mapped file*/
+	std::vector<double> owned;
+	const double* coeffs;
+	void* map_base;
+	size_t map_length;
+#ifdef _WIN32
+	void* map_file;
+	void* map_handle;
+#endif
+
+	ChebyshevTable(const ChebyshevTable& source);
+	ChebyshevTable& operator = (const ChebyshevTable& source);
+
+	void Unmap();
+	bool Inside(double u0, double u1, double u2) const;
+	double Evaluate(double u0, double u1, double u2, int o0, int o1, int o2) const; //partial derivative of order (o0, o1, o2) of v
+	double EvaluateValue(double u0, double u1, double u2) const; //fast path for v itself
+	double Exact(double S, double K, double T, double sig) const;
+	void Fit(std::vector<double>& out) const; //fits every cell of the current layout
+	double Validate() const;
+
+public:
+	/*Constructor and destructor*/
+	ChebyshevTable();
+	virtual ~ChebyshevTable();
+
+	/*Building*/
+	bool Build(int type, double p_rf, double p_b, const ChebyshevBox& box, double tolerance, int p_degree = 4, size_t max_cells = 1 << 16);
+
+	/*Lookups*/
+	double Price(double S, double K, double T, double sig) const;
+	double Delta(double S, double K, double T, double sig) const;
+	double Gamma(double S, double K, double T, double sig) const;
+	double Vega(double S, double K, double T, double sig) const;
+	double Theta(double S, double K, double T, double sig) const; //zero for perpetual tables
+	void PriceBatch(size_t n, const double* S, const double* K, const double* T, const double* sig, double* out) const;
+
+	/*Table information*/
+	bool IsValid() const;
+	int type() const;
+	double rate() const;
+	double CostOfCarry() const;
+	double MaxError() const; //measured on the validation grid
+	size_t CellCount() const;
+	size_t MemoryUsage() const; //bytes of coefficients
+
+	/*Serialization*/
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path); //reads the coefficients into memory
+	bool Map(const std::string& path); //maps the file read-only, the coefficients are paged in on demand
+};
+
+#endif
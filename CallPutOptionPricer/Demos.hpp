@@ -0,0 +1,1055 @@
+//Demos.hpp
+//Demonstrations of the batch and performance features selectable from the main menu after the four test batches
+
+#ifndef DEMOS_HPP
+#define DEMOS_HPP
+
+#include "EUOptionCall.hpp"
+#include "EUOptionPut.hpp"
+#include "MixedPrecision.hpp"
+#include "BatchPricer.hpp"
+#include "Instrumentation.hpp"
+#include "ScenarioEngine.hpp"
+#include "ChebyshevTable.hpp"
+#include "FourierPricer.hpp"
+#include "VolSurface.hpp"
+#include "TermCurve.hpp"
+#include "SmileCalibrator.hpp"
+#include "PricingService.hpp"
+#include "MarketDataFeed.hpp"
+#include "PortfolioAggregator.hpp"
+#include "AsyncPricer.hpp"
+#include "NumaPricer.hpp"
+#include "AsianOption.hpp"
+#include "LookbackOption.hpp"
+#include "MultilevelMC.hpp"
+#include "HedgingSimulator.hpp"
+#include "ExoticKernels.hpp"
+#include "PricingKernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#define NL cout << endl;
+
+void PrecisionDemo() {
+	cout << "************ FLOAT AND MIXED PRECISION ************" << endl;
+	//a small book of calls and puts across strikes, from deep in the money to deep out of the money
+	std::vector<OptionData> data;
+	std::vector<double> S;
+	std::vector<int> types;
+	for (int i = 0; i < 200; i++) {
+		OptionData d{ 0.08, 0.30, 40.0 + i, 0.25 + 0.01 * (i % 50), 0.08 }; //rf, sig, K, T, b
+		data.push_back(d);
+		S.push_back(100.0);
+		types.push_back(i % 2 == 0 ? EU_CALL : EU_PUT);
+	}
+	std::vector<double> reference = PriceBatch(data, S, types);
+	std::vector<float> S_float(S.begin(), S.end());
+	std::vector<float> single = PriceBatchFloat(ToFloat(data), S_float, types);
+	cout << "Float path against the double path:" << endl;
+	cout << CompareToDouble(reference, single).ToString();
+	NL;
+	PrecisionReport mixed_report;
+	std::vector<double> mixed = PriceBatchMixed(data, S, types, 1e-4, mixed_report);
+	PrecisionReport report = CompareToDouble(reference, mixed);
+	report.repriced = mixed_report.repriced;
+	cout << "Mixed path (relative tolerance 1e-4) against the double path:" << endl;
+	cout << report.ToString();
+}
+
+void BookDemo() {
+	cout << "***************** OPTION BOOK ******************" << endl;
+	OptionBook book;
+	EuOptCall call; //Batch 1 parameters
+	call.Underlying("XYZ");
+	EuOptPut put(call.rate(), call.sigma(), call.strike(), call.maturity(), call.CostOfCarry());
+	put.Underlying("XYZ");
+	book.Add(call, 60, 10); //S = 60, long 10 calls
+	book.Add(put, 60, -5); //short 5 puts
+	cout << "Value of 10 calls - 5 puts of Batch 1: " << BookValue(book) << " (10 * 2.13293 - 5 * 5.84584)" << endl;
+	NL;
+	int n = 1000000;
+	std::vector<OptionContract> contracts(n);
+	unsigned int abc = book.UnderlyingIndex("ABC");
+	for (int i = 0; i < n; i++) {
+		OptionContract c = { 100.0, 50.0 + (i % 100), 0.25 + 0.25 * (i % 8), 0.2 + 0.01 * (i % 30), 0.05, 0.05, 1.0, abc, i % 4 };
+		contracts[i] = c;
+	}
+	book.Clear();
+	if (!book.Load(&contracts[0], contracts.size())) {
+		return;
+	}
+	cout << "Contracts loaded: " << book.size() << " in " << book.BlockCount() << " blocks (" << book.MemoryUsage() / (1024 * 1024) << " MB)" << endl;
+	cout << "Book value: " << BookValue(book) << endl;
+	book.Clear();
+	cout << "Contracts after Clear(): " << book.size() << endl;
+}
+
+void InstrumentationDemo() {
+	cout << "************** INSTRUMENTATION ***************" << endl;
+	if (!PRICER_INSTRUMENTATION) {
+		cout << "Instrumentation is compiled out. Rebuild with PRICER_INSTRUMENTATION=1 to record latencies." << endl;
+		return;
+	}
+	ResetInstrumentation();
+	EuOptCall call;
+	EuOptPut put;
+	double sum = 0.0;
+	for (int i = 0; i < 100000; i++) {
+		double S = 50.0 + (i % 40);
+		sum += call.Price(S) + put.Price(S) + call.Delta(S) + put.Gamma(S);
+	}
+	OptionBook book;
+	for (int i = 0; i < 1000; i++) {
+		book.Add(call, 50.0 + (i % 40));
+	}
+	for (int i = 0; i < 100; i++) {
+		sum += BookValue(book);
+	}
+	cout << "Checksum: " << sum << endl;
+	DumpInstrumentationJSON(cout);
+}
+
+void ScenarioDemo() {
+	cout << "*************** SCENARIO VaR ****************" << endl;
+	OptionBook book;
+	for (int i = 0; i < 20000; i++) {
+		OptionContract c = { 100.0, 70.0 + (i % 60), 0.25 + 0.25 * (i % 4), 0.2 + 0.005 * (i % 20), 0.05, 0.05, (i % 3 == 0) ? -10.0 : 5.0, 0, i % 2 };
+		book.Add(c);
+	}
+	std::vector<MarketScenario> scenarios = ScenarioEngine::ParametricScenarios(1000, 0.02, 0.01, 0.001);
+	ScenarioEngine engine(book, 1);
+	std::vector<double> pnl_1 = engine.Run(scenarios);
+	engine.threads(0); //all cores
+	std::vector<double> pnl_n = engine.Run(scenarios);
+	cout << "Contracts: " << book.size() << ", scenarios: " << scenarios.size() << endl;
+	cout << "P&L identical with 1 thread and all threads: " << (pnl_1 == pnl_n ? "yes" : "no") << endl;
+	cout << ScenarioEngine::Risk(pnl_n, 0.99).ToString();
+}
+
+void ChebyshevDemo() {
+	cout << "************ CHEBYSHEV TABLES **************" << endl;
+	ChebyshevBox box = { 0.5, 2.0, 0.1, 2.0, 0.1, 0.6 }; //S/K, T, sig
+	ChebyshevTable table;
+	table.Build(EU_CALL, 0.05, 0.05, box, 1e-5);
+	cout << "Cells: " << table.CellCount() << " (" << table.MemoryUsage() / 1024 << " KB), max error per unit of strike on the validation grid: " << table.MaxError() << endl;
+	EuOptCall call(0.05, 0.25, 100, 1.0, 0.05); //rf, sig, K, T, b
+	cout << "Price table/exact: " << table.Price(105, 100, 1.0, 0.25) << " / " << call.Price(105) << endl;
+	cout << "Delta table/exact: " << table.Delta(105, 100, 1.0, 0.25) << " / " << call.Delta(105) << endl;
+	cout << "Gamma table/exact: " << table.Gamma(105, 100, 1.0, 0.25) << " / " << call.Gamma(105) << endl;
+	NL;
+	int n = 1000000;
+	std::vector<double> S(n), K(n, 100.0), T(n, 1.0), sig(n, 0.25), out(n);
+	for (int i = 0; i < n; i++) {
+		S[i] = 60.0 + (i % 1000) * 0.1;
+	}
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	table.PriceBatch(n, &S[0], &K[0], &T[0], &sig[0], &out[0]);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (int i = 0; i < n; i++) {
+		out[i] -= call.Price(S[i]);
+	}
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	cout << "Table lookup: " << std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)n << " ns per price, EuOptCall::Price: "
+		<< std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / (double)n << " ns per price" << endl;
+	if (table.Save("eu_call_table.bin")) {
+		ChebyshevTable mapped;
+		if (mapped.Map("eu_call_table.bin")) {
+			cout << "Price from the memory-mapped table: " << mapped.Price(105, 100, 1.0, 0.25) << endl;
+		}
+	}
+}
+
+void GroupedDemo() {
+	cout << "************* GROUPED PRICING **************" << endl;
+	//option chains: 12 expiries x 150 strikes on 100 underlyings, two vols per expiry, and a perpetual chain of 90
+	//strikes per underlying reaching into the exercise regions (call S* = 2.56 K, put S* = 0.52 K)
+	OptionBook book;
+	for (int u = 0; u < 100; u++) {
+		for (int e = 0; e < 12; e++) {
+			for (int k = 0; k < 150; k++) {
+				OptionContract c = { 100.0 + u, 50.0 + k, (e + 1) / 12.0, (k < 75) ? 0.25 : 0.22, 0.05, 0.03, 1.0, 0, (k % 2 == 0) ? EU_CALL : EU_PUT };
+				book.Add(c);
+			}
+		}
+		for (int k = 0; k < 90; k++) {
+			OptionContract c = { 100.0 + u, 20.0 + 2.0 * k, 0.0, 0.3, 0.08, 0.02, 1.0, 0, (k % 2 == 0) ? US_CALL : US_PUT };
+			book.Add(c);
+		}
+	}
+	std::vector<double> plain, grouped;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	PriceBook(book, plain);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	GroupedPricer pricer(book);
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	pricer.Price(book, grouped);
+	std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+	double max_diff = 0.0;
+	for (size_t i = 0; i < plain.size(); i++) {
+		max_diff = std::max(max_diff, fabs(plain[i] - grouped[i]));
+	}
+	cout << "Contracts: " << book.size() << " in " << pricer.GroupCount() << " groups" << endl;
+	cout << "PriceBook: " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us, grouping: "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us, grouped pricing: "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << " us" << endl;
+	cout << "Max difference: " << max_diff << endl;
+	NL;
+	//the same chains held by three desks
+	OptionBook consolidated;
+	for (int desk = 0; desk < 3; desk++) {
+		for (size_t i = 0; i < book.size(); i++) {
+			consolidated.Add(book[i]);
+		}
+	}
+	DedupStats stats;
+	std::vector<double> deduped;
+	PriceBookDedup(consolidated, deduped, &stats);
+	cout << "Consolidated book of three desks:" << endl;
+	cout << stats.ToString();
+}
+
+void FourierDemo() {
+	cout << "************* FOURIER CHAIN PRICING *************" << endl;
+	double S = 100.0, T = 0.5, rf = 0.05, b = 0.02, sig = 0.25;
+	std::vector<double> K;
+	for (int i = 0; i < 121; i++) {
+		K.push_back(60.0 + 0.5 * i);
+	}
+	std::vector<double> calls_fft, puts_fft, calls_cos, puts_cos;
+
+	//Black-Scholes against the closed form
+	BlackScholesCF bs(sig, b);
+	FourierPricer bs_pricer(bs, rf);
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	bs_pricer.PriceChainFFT(S, T, K, calls_fft, puts_fft);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	bs_pricer.PriceChainCOS(S, T, K, calls_cos, puts_cos);
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	double err_fft = 0.0, err_cos = 0.0;
+	for (size_t i = 0; i < K.size(); i++) {
+		EuOptCall call(rf, sig, K[i], T, b);
+		EuOptPut put(rf, sig, K[i], T, b);
+		err_fft = std::max(err_fft, std::max(fabs(calls_fft[i] - call.Price(S)), fabs(puts_fft[i] - put.Price(S))));
+		err_cos = std::max(err_cos, std::max(fabs(calls_cos[i] - call.Price(S)), fabs(puts_cos[i] - put.Price(S))));
+	}
+	cout << "Black-Scholes, " << K.size() << " strikes" << endl;
+	cout << "FFT: " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us, max error vs EuOptCall/EuOptPut: " << err_fft << endl;
+	cout << "COS: " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us, max error vs EuOptCall/EuOptPut: " << err_cos << endl;
+	NL;
+
+	//Merton against its series of Black-Scholes prices
+	double lambda = 0.5, muJ = -0.1, sigJ = 0.15;
+	MertonCF merton(sig, b, lambda, muJ, sigJ);
+	FourierPricer merton_pricer(merton, rf);
+	merton_pricer.PriceChainFFT(S, T, K, calls_fft, puts_fft);
+	merton_pricer.PriceChainCOS(S, T, K, calls_cos, puts_cos);
+	double k = exp(muJ + 0.5 * sigJ * sigJ) - 1.0;
+	err_fft = 0.0, err_cos = 0.0;
+	for (size_t i = 0; i < K.size(); i++) {
+		double series = 0.0, weight = exp(-lambda * T); //Poisson number of jumps, discounting stays at rf
+		for (int n = 0; n < 40; n++) {
+			if (n > 0) {
+				weight *= lambda * T / n;
+			}
+			EuOptCall call(rf, sqrt(sig * sig + n * sigJ * sigJ / T), K[i], T, b - lambda * k + n * log(1.0 + k) / T);
+			series += weight * call.Price(S);
+		}
+		err_fft = std::max(err_fft, fabs(calls_fft[i] - series));
+		err_cos = std::max(err_cos, fabs(calls_cos[i] - series));
+	}
+	cout << "Merton jump-diffusion (lambda = " << lambda << ", muJ = " << muJ << ", sigJ = " << sigJ << ")" << endl;
+	cout << "Max call error vs series, FFT: " << err_fft << ", COS: " << err_cos << endl;
+	NL;
+
+	//Heston: the two methods against each other
+	HestonCF heston(b, 0.04, 1.5, 0.06, 0.5, -0.7);
+	FourierPricer heston_pricer(heston, rf);
+	heston_pricer.PriceChainFFT(S, T, K, calls_fft, puts_fft);
+	heston_pricer.PriceChainCOS(S, T, K, calls_cos, puts_cos);
+	double diff = 0.0;
+	for (size_t i = 0; i < K.size(); i++) {
+		diff = std::max(diff, fabs(calls_fft[i] - calls_cos[i]));
+	}
+	cout << "Heston (v0 = 0.04, kappa = 1.5, theta = 0.06, xi = 0.5, rho = -0.7)" << endl;
+	cout << "Max FFT/COS difference: " << diff << endl;
+	for (size_t i = 0; i < K.size(); i += 20) {
+		cout << "K = " << K[i] << ": call " << calls_cos[i] << ", put " << puts_cos[i] << endl;
+	}
+}
+
+void VolSurfaceDemo() {
+	cout << "************* VOLATILITY SURFACE *************" << endl;
+	double S = 100.0, rf = 0.05, b = 0.02;
+	//SVI smiles with a skew flattening with the expiry
+	VolSurface svi;
+	double expiries[] = { 0.25, 0.5, 1.0, 2.0 };
+	for (int e = 0; e < 4; e++) {
+		double T = expiries[e];
+		SVIParams p = { 0.03 * T, 0.08 * sqrt(T), -0.6, 0.05, 0.2 };
+		svi.AddSVI(T, p);
+	}
+	//the same quotes as a spline smile: the spline goes through the node vols
+	VolSurface spline;
+	std::vector<double> k, vols;
+	for (int i = -6; i <= 6; i++) {
+		k.push_back(0.1 * i);
+		vols.push_back(svi.Vol(0.1 * i, 0.5));
+	}
+	spline.AddSpline(0.5, k, vols);
+	double node_err = 0.0;
+	for (size_t i = 0; i < k.size(); i++) {
+		node_err = std::max(node_err, fabs(spline.Vol(k[i], 0.5) - vols[i]));
+	}
+	cout << "Spline smile through " << k.size() << " SVI quotes, max node error: " << node_err
+		<< ", vol between nodes at k = 0.05: " << spline.Vol(0.05, 0.5) << " (SVI " << svi.Vol(0.05, 0.5) << ")" << endl;
+	NL;
+
+	//scalar against batch lookups of a 200 strike chain between two expiries
+	double T = 0.75, F = S * exp(b * T);
+	std::vector<double> K(200), scalar(200), batch(200);
+	for (int i = 0; i < 200; i++) {
+		K[i] = 50.0 + 0.5 * i;
+	}
+	const int reps = 2000;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < reps; r++) {
+		for (int i = 0; i < 200; i++) {
+			scalar[i] = svi.Vol(F, K[i], T);
+		}
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (int r = 0; r < reps; r++) {
+		svi.Vols(F, T, K.size(), &K[0], &batch[0]);
+	}
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	double diff = 0.0;
+	for (int i = 0; i < 200; i++) {
+		diff = std::max(diff, fabs(scalar[i] - batch[i]));
+	}
+	double lookups = 200.0 * reps;
+	cout << "Scalar lookup: " << std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / lookups << " ns, batch lookup: "
+		<< std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / lookups << " ns per strike, max difference " << diff << endl;
+	NL;
+
+	//pricers reading the surface directly
+	for (int i = 0; i < 200; i += 25) {
+		EuOptCall call(rf, 0.2, K[i], T, b); //sig is not used when pricing off the surface
+		EuOptPut put(rf, 0.2, K[i], T, b);
+		cout << "K = " << K[i] << ": vol " << batch[i] << ", call " << call.Price(S, svi) << ", put " << put.Price(S, svi) << endl;
+	}
+}
+
+void TermCurveDemo() {
+	cout << "************* RATE AND CARRY CURVES *************" << endl;
+	double pillars[] = { 0.25, 0.5, 1.0, 2.0, 5.0 };
+	double zeros[] = { 0.030, 0.034, 0.038, 0.042, 0.045 };
+	DiscountCurve rates(std::vector<double>(pillars, pillars + 5), std::vector<double>(zeros, zeros + 5), LOG_LINEAR_DF);
+	CarryCurve carry;
+	carry.Interpolation(LOG_LINEAR_DF);
+	for (int i = 0; i < 5; i++) {
+		carry.AddPillar(pillars[i], zeros[i] - 0.015); //b = r - q with a 1.5% dividend yield
+	}
+	for (double T = 0.25; T <= 3.0; T += 0.25) {
+		cout << "T = " << T << ": r = " << rates.Rate(T) << ", b = " << carry.Rate(T) << ", DF = " << rates.DiscountFactor(T) << endl;
+	}
+	NL;
+
+	//the flat curves reproduce the scalar pricers
+	EuOptCall call(0.05, 0.25, 100.0, 0.75, 0.03);
+	EuOptPut put(0.05, 0.25, 100.0, 0.75, 0.03);
+	cout << "Flat curves: call " << call.Price(105.0, TermCurve(0.05), TermCurve(0.03)) << " (scalar " << call.Price(105.0) << "), put "
+		<< put.Price(105.0, TermCurve(0.05), TermCurve(0.03)) << " (scalar " << put.Price(105.0) << ")" << endl;
+	cout << "Term structure: call " << call.Price(105.0, rates, carry) << ", put " << put.Price(105.0, rates, carry) << endl;
+	NL;
+
+	//batch pricing of a book with and without the per-expiry cache
+	OptionBook book;
+	for (int u = 0; u < 100; u++) {
+		for (int e = 0; e < 12; e++) {
+			for (int k = 0; k < 150; k++) {
+				OptionContract c = { 100.0 + u, 50.0 + k, (e + 1) / 6.0, 0.25, 0.05, 0.03, 1.0, 0, (k % 2 == 0) ? EU_CALL : EU_PUT };
+				book.Add(c);
+			}
+		}
+	}
+	std::vector<double> uncached, cached;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	PriceBook(book, rates, carry, uncached);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	std::vector<double> expiries = BookExpiries(book);
+	rates.CacheExpiries(expiries);
+	carry.CacheExpiries(expiries);
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	PriceBook(book, rates, carry, cached);
+	std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+	double diff = 0.0;
+	for (size_t i = 0; i < book.size(); i++) {
+		diff = std::max(diff, fabs(uncached[i] - cached[i]));
+	}
+	cout << "Contracts: " << book.size() << ", expiries cached: " << rates.CacheSize() << endl;
+	cout << "Uncached curves: " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us, caching: "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us, cached curves: "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << " us, max difference " << diff << endl;
+}
+
+/*Quotes generated from known SVI smiles, with a relative spot move and a level shift of the smiles*/
+static std::vector<SmileQuotes> CalibrationUniverse(int underlyings, double spot_move, double level_shift) {
+	std::vector<SmileQuotes> universe;
+	double expiries[] = { 1.0 / 12.0, 0.25, 0.5, 1.0, 1.5, 2.0 };
+	for (int u = 0; u < underlyings; u++) {
+		std::stringstream name;
+		name << "UND" << u;
+		VolSurface truth;
+		for (int e = 0; e < 6; e++) {
+			double T = expiries[e];
+			SVIParams p = { (0.02 + 0.0001 * (u % 50)) * T * (1.0 + level_shift), 0.1 * sqrt(T), -0.5 + 0.004 * (u % 50), 0.02, 0.15 };
+			truth.AddSVI(T, p);
+		}
+		for (int e = 0; e < 6; e++) {
+			SmileQuotes q;
+			q.underlying = name.str();
+			q.S = (50.0 + u) * (1.0 + spot_move);
+			q.T = expiries[e];
+			q.rf = 0.04;
+			q.b = 0.02;
+			for (int i = 0; i < 21; i++) {
+				double K = (50.0 + u) * (0.7 + 0.03 * i);
+				EuOptCall call(q.rf, 0.2, K, q.T, q.b);
+				EuOptPut put(q.rf, 0.2, K, q.T, q.b);
+				bool otm_put = K < q.S;
+				q.K.push_back(K);
+				q.types.push_back(otm_put ? EU_PUT : EU_CALL);
+				q.prices.push_back(otm_put ? put.Price(q.S, truth) : call.Price(q.S, truth));
+			}
+			universe.push_back(q);
+		}
+	}
+	return universe;
+}
+
+void CalibrationDemo() {
+	cout << "************* SMILE CALIBRATION *************" << endl;
+	SmileCalibrator calibrator;
+	for (int snap = 0; snap < 2; snap++) {
+		//the second snapshot moves the spots and the vol levels a little and warm starts from the first
+		std::vector<SmileQuotes> universe = CalibrationUniverse(200, 0.005 * snap, 0.02 * snap);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		std::vector<CalibrationResult> results = calibrator.Calibrate(universe);
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		int iterations = 0, max_iterations = 0, converged = 0;
+		double worst = 0.0;
+		for (size_t i = 0; i < results.size(); i++) {
+			iterations += results[i].iterations;
+			max_iterations = std::max(max_iterations, results[i].iterations);
+			converged += results[i].converged ? 1 : 0;
+			worst = std::max(worst, results[i].max_residual);
+		}
+		cout << (snap == 0 ? "Cold start: " : "Warm start: ") << results.size() << " smiles, " << universe.size() * 21 << " quotes in "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms" << endl;
+		cout << "Iterations: mean " << (double)iterations / results.size() << ", max " << max_iterations << ", converged " << converged
+			<< "/" << results.size() << ", max price residual " << worst << endl;
+		cout << results[0].ToString() << results[results.size() - 1].ToString();
+		NL;
+	}
+}
+
+void ServiceDemo() {
+	cout << "************* PRICING SERVICE *************" << endl;
+	ServiceConfig config;
+	config.socket_path = "/tmp/option_pricer.sock";
+	config.shm_name = "/option_pricer";
+	PricingService service(config);
+	if (!service.Start()) {
+		return;
+	}
+	cout << "Listening on " << config.socket_path << " and shared memory " << config.shm_name << endl;
+	//a request of 16 contracts
+	std::vector<PricingRequestItem> items(16);
+	std::vector<double> expected(16);
+	for (int i = 0; i < 16; i++) {
+		OptionData d = { 0.05, 0.2 + 0.01 * i, 90.0 + 2.0 * i, 0.5, 0.03 };
+		PricingRequestItem item = { d, 100.0, i % 4, 0 };
+		items[i] = item;
+		expected[i] = PriceKernel<double>(item.type, item.S, d.K, d.T, d.sig, d.rf, d.b);
+	}
+	for (int transport = 0; transport < 2; transport++) {
+		PricingClient client;
+		bool ok = (transport == 0) ? client.Connect(config.socket_path) : client.Attach(config.shm_name);
+		if (!ok) {
+			cout << "Cannot reach the service" << endl;
+			continue;
+		}
+		const int requests = 20000;
+		std::vector<double> results(16), latency(requests);
+		double max_diff = 0.0;
+		for (int r = 0; r < requests; r++) {
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			ok = (transport == 0) ? client.Price(&items[0], 16, &results[0]) : client.PriceShared(&items[0], 16, &results[0]);
+			std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+			latency[r] = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+			for (int i = 0; ok && i < 16; i++) {
+				max_diff = std::max(max_diff, fabs(results[i] - expected[i]));
+			}
+		}
+		std::sort(latency.begin(), latency.end());
+		cout << (transport == 0 ? "Unix socket" : "Shared memory") << ": " << requests << " requests of 16 contracts, round trip median "
+			<< latency[requests / 2] / 1000.0 << " us, p99 " << latency[requests * 99 / 100] / 1000.0 << " us, max difference " << max_diff << endl;
+	}
+	cout << service.Stats().ToString();
+	cout << "Serving, press Enter to stop..." << endl;
+	cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	cin.get();
+	service.Stop();
+}
+
+
+void MarketDataDemo() {
+	cout << "************* MARKET DATA FEED *************" << endl;
+	//200 underlyings with 50 European and 10 perpetual American contracts each
+	OptionBook book;
+	const unsigned int underlyings = 200;
+	for (unsigned int u = 0; u < underlyings; u++) {
+		std::stringstream name;
+		name << "UND" << u;
+		unsigned int index = book.UnderlyingIndex(name.str());
+		for (int k = 0; k < 60; k++) {
+			int type = (k < 50) ? k % 2 : US_CALL + k % 2;
+			OptionContract c = { 100.0, 75.0 + k, 0.25 + (k % 5) * 0.25, 0.2 + 0.002 * k, 0.08, 0.04, 1.0, index, type };
+			book.Add(c);
+		}
+	}
+	//random walk of 200000 ticks over one second of market time
+	std::mt19937 rng(7);
+	std::normal_distribution<double> move(0.0, 0.001);
+	std::uniform_int_distribution<unsigned int> pick(0, underlyings - 1);
+	std::vector<double> spot(underlyings, 100.0), shift(underlyings, 0.0);
+	std::vector<Tick> recorded(200000);
+	for (size_t i = 0; i < recorded.size(); i++) {
+		unsigned int u = pick(rng);
+		spot[u] *= exp(move(rng));
+		shift[u] += 0.1 * move(rng);
+		Tick tick = { (long long)(i * 5), u, spot[u], shift[u] };
+		recorded[i] = tick;
+	}
+	TickReplay replay;
+	if (!TickReplay::Save("ticks.txt", recorded, book) || !replay.Load("ticks.txt", book)) {
+		cout << "Cannot write ticks.txt" << endl;
+		return;
+	}
+	cout << "Contracts: " << book.size() << ", ticks in ticks.txt: " << replay.size() << endl;
+	const double speeds[2] = { 0.0, 1.0 };
+	for (int s = 0; s < 2; s++) {
+		MarketDataFeed feed(book, 1);
+		feed.Start();
+		double wall = replay.Replay(feed, speeds[s]);
+		feed.Stop();
+		//the final prices must be those of the last tick of every underlying
+		const std::vector<double>& prices = feed.Prices();
+		double max_diff = 0.0;
+		for (size_t i = 0; i < book.size(); i++) {
+			const OptionContract& c = book[i];
+			double sig = std::max(c.sig + shift[c.underlying], 1e-4);
+			max_diff = std::max(max_diff, fabs(prices[i] - PriceKernel<double>(c.type, spot[c.underlying], c.K, c.T, sig, c.rf, c.b)));
+		}
+		NL;
+		cout << (speeds[s] == 0.0 ? "Replay as fast as possible" : "Replay at the recorded pace") << ": " << wall / 1000.0 << " ms" << endl;
+		cout << feed.Stats().ToString();
+		cout << "Max difference with the last tick: " << max_diff << endl;
+	}
+	//raw hand-off cost of the queues, one thread pushing then popping
+	NL;
+	const size_t n = 1 << 20;
+	SpscRing<MarketUpdate> spsc(1024);
+	MpscRing<MarketUpdate> mpsc(1024);
+	MarketUpdate update = { 0, 100.0, 0.0, 0 };
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < n; i++) {
+		spsc.TryPush(update);
+		spsc.TryPop(update);
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < n; i++) {
+		mpsc.TryPush(update);
+		mpsc.TryPop(update);
+	}
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	cout << "Push + pop: SpscRing " << std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)n << " ns, MpscRing "
+		<< std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / (double)n << " ns" << endl;
+}
+
+
+void SelectiveGreeksDemo() {
+	cout << "************* SELECTIVE GREEKS *************" << endl;
+	//a ladder of 100001 spots: one pass with a mask against one pass per Greek
+	EuOptCall call(0.05, 0.25, 100.0, 0.75, 0.03);
+	const int num = 100000;
+	GreekColumns columns;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	std::vector<double> deltas(num + 1), gammas(num + 1);
+	for (int i = 0; i <= num; i++) {
+		deltas[i] = call.Delta(50.0 + i * 0.001);
+	}
+	for (int i = 0; i <= num; i++) {
+		gammas[i] = call.Gamma(50.0 + i * 0.001);
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	call.GreeksRange(num, 50.0, 150.0, OUT_DELTA | OUT_GAMMA, columns);
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	double max_diff = 0.0;
+	for (int i = 0; i <= num; i++) {
+		max_diff = std::max(max_diff, std::max(fabs(deltas[i] - columns.delta[i]), fabs(gammas[i] - columns.gamma[i])));
+	}
+	cout << "Delta and gamma ladders: two passes " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()
+		<< " us, one masked pass " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us, max difference " << max_diff << endl;
+	NL;
+	//a book of European and perpetual contracts, priced with growing masks
+	OptionBook book;
+	for (int i = 0; i < 400000; i++) {
+		OptionContract c = { 80.0 + (i % 41), 100.0, 0.1 + (i % 20) * 0.1, 0.15 + (i % 7) * 0.05, 0.08, 0.04, 1.0, 0, (i % 10 == 9) ? US_CALL + (i / 10) % 2 : i % 2 };
+		book.Add(c);
+	}
+	std::vector<double> prices;
+	t0 = std::chrono::steady_clock::now();
+	PriceBook(book, prices);
+	t1 = std::chrono::steady_clock::now();
+	cout << "Contracts: " << book.size() << ", PriceBook: " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us" << endl;
+	const unsigned int masks[5] = { OUT_PRICE, OUT_HEDGE, OUT_HEDGE | OUT_GAMMA, OUT_FIRST_ORDER, OUT_ALL };
+	const char* names[5] = { "price", "price + delta", "price + delta + gamma", "first order", "all (with vanna and volga)" };
+	for (int m = 0; m < 5; m++) {
+		t0 = std::chrono::steady_clock::now();
+		PriceBookGreeks(book, masks[m], columns);
+		t1 = std::chrono::steady_clock::now();
+		cout << "PriceBookGreeks, " << names[m] << ": " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us" << endl;
+	}
+	//checks of the mask outputs against the class Greeks and central differences
+	NL;
+	double err_price = 0.0, err_class = 0.0, err_fd = 0.0;
+	for (size_t i = 0; i < book.size(); i += 997) {
+		const OptionContract& c = book[i];
+		err_price = std::max(err_price, fabs(columns.price[i] - prices[i]));
+		double h = 1e-4 * c.sig;
+		OptionOutputs<double> up = OptionOutputs<double>(), down = OptionOutputs<double>();
+		GreeksKernel<OUT_ALL>(c.type, c.S, c.K, c.T, c.sig + h, c.rf, c.b, OUT_DELTA | OUT_VEGA, up);
+		GreeksKernel<OUT_ALL>(c.type, c.S, c.K, c.T, c.sig - h, c.rf, c.b, OUT_DELTA | OUT_VEGA, down);
+		err_fd = std::max(err_fd, fabs((up.delta - down.delta) / (2.0 * h) - columns.vanna[i]) / std::max(1.0, fabs(columns.vanna[i])));
+		err_fd = std::max(err_fd, fabs((up.vega - down.vega) / (2.0 * h) - columns.volga[i]) / std::max(1.0, fabs(columns.volga[i])));
+		if (c.type == EU_CALL) {
+			EuOptCall option(c.rf, c.sig, c.K, c.T, c.b);
+			err_class = std::max(err_class, std::max(fabs(option.Delta(c.S) - columns.delta[i]), fabs(option.Gamma(c.S) - columns.gamma[i])));
+			err_class = std::max(err_class, std::max(fabs(option.Vega(c.S) - columns.vega[i]), fabs(option.Theta(c.S) - columns.theta[i])));
+		}
+		else if (c.type == EU_PUT) {
+			EuOptPut option(c.rf, c.sig, c.K, c.T, c.b);
+			err_class = std::max(err_class, std::max(fabs(option.Delta(c.S) - columns.delta[i]), fabs(option.Gamma(c.S) - columns.gamma[i])));
+			err_class = std::max(err_class, std::max(fabs(option.Vega(c.S) - columns.vega[i]), fabs(option.Theta(c.S) - columns.theta[i])));
+		}
+	}
+	cout << "Max difference with PriceBook: " << err_price << ", with the class Greeks: " << err_class
+		<< ", vanna and volga against differences of delta and vega: " << err_fd << endl;
+}
+
+
+void AggregationDemo() {
+	cout << "************* PORTFOLIO AGGREGATION *************" << endl;
+	//three desks holding positions on 500 underlyings, the names overlapping between the desks
+	OptionBook desks[3];
+	const char* desk_names[3] = { "Flow", "Exotics", "Index" };
+	for (int d = 0; d < 3; d++) {
+		desks[d].Reserve(1000000);
+		for (int u = 0; u < 500; u++) {
+			std::stringstream name;
+			name << "UND" << (u + 150 * d) % 800;
+			unsigned int index = desks[d].UnderlyingIndex(name.str());
+			for (int k = 0; k < 2000; k++) {
+				OptionContract c = { 100.0, 60.0 + (k % 80), 0.1 + (k % 40) * 0.3, 0.2 + 0.001 * (k % 100), 0.05, 0.02,
+					(k % 3 == 0) ? -2.0 : 1.0, index, (k % 50 == 49) ? US_CALL + (k / 50) % 2 : k % 2 };
+				desks[d].Add(c);
+			}
+		}
+	}
+	PortfolioAggregator aggregator(OUT_FIRST_ORDER);
+	for (int d = 0; d < 3; d++) {
+		aggregator.AddBook(desk_names[d], desks[d]);
+	}
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	aggregator.Run();
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	cout << "Positions: " << aggregator.Total().positions << ", underlyings: " << aggregator.UnderlyingCount() << ", cells: " << aggregator.Cells().size()
+		<< ", fused pricing and aggregation: " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms" << endl;
+	cout << aggregator.ToString();
+	Exposure und;
+	if (aggregator.Underlying("UND300", und)) {
+		cout << "UND300 (held by two desks): " << und.ToString() << endl;
+	}
+	//the same rollup materializing every per-contract result first
+	NL;
+	t0 = std::chrono::steady_clock::now();
+	double value = 0.0, delta = 0.0;
+	GreekColumns columns;
+	for (int d = 0; d < 3; d++) {
+		PriceBookGreeks(desks[d], OUT_FIRST_ORDER, columns);
+		for (size_t i = 0; i < desks[d].size(); i++) {
+			value += desks[d][i].qty * columns.price[i];
+			delta += desks[d][i].qty * columns.delta[i];
+		}
+	}
+	t1 = std::chrono::steady_clock::now();
+	cout << "Materialized per-contract results then summed: " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms, value difference "
+		<< fabs(value - aggregator.Total().value) << ", delta difference " << fabs(delta - aggregator.Total().delta) << endl;
+	//the merge order does not depend on the threads
+	PortfolioAggregator single(OUT_FIRST_ORDER, 1);
+	for (int d = 0; d < 3; d++) {
+		single.AddBook(desk_names[d], desks[d]);
+	}
+	single.Run();
+	bool identical = single.Cells().size() == aggregator.Cells().size();
+	for (size_t k = 0; identical && k < single.Cells().size(); k++) {
+		const Exposure& x = single.Cells()[k].exposure;
+		const Exposure& y = aggregator.Cells()[k].exposure;
+		identical = x.value == y.value && x.delta == y.delta && x.gamma == y.gamma && x.vega == y.vega && x.theta == y.theta && x.rho == y.rho;
+	}
+	cout << "One thread against all threads: " << (identical ? "bit for bit identical" : "different") << endl;
+}
+
+
+void AsyncPricingDemo() {
+	cout << "************* ASYNCHRONOUS PRICING *************" << endl;
+	//gateway: client threads sending single contract requests, a few in flight each
+	const int clients = 8;
+	const int per_client = 25000;
+	const int in_flight = 32;
+	AsyncPricer pricer;
+	std::atomic<int> mismatches(0);
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int c = 0; c < clients; c++) {
+		threads.push_back(std::thread([&, c]() {
+			std::vector<std::future<AsyncResult> > pending(in_flight);
+			std::vector<AsyncRequest> sent(in_flight);
+			for (int i = 0; i < per_client; i++) {
+				int slot = i % in_flight;
+				if (i >= in_flight) { //oldest request of this client
+					AsyncResult r = pending[slot].get();
+					const AsyncRequest& q = sent[slot];
+					double expected = (q.kind == ASYNC_IMPLIED_VOL) ? 0.25 : PriceKernel<double>(q.type, q.S, q.K, q.T, q.sig, q.rf, q.b);
+					double got = (q.kind == ASYNC_GREEKS) ? r.outputs.price : r.value;
+					if (r.status != ASYNC_OK || fabs(got - expected) > 1e-8) {
+						mismatches++;
+					}
+				}
+				double K = 80.0 + (i + c) % 40;
+				int type = (i % 7 == 0) ? US_PUT : (i % 2);
+				if (i % 10 == 3) {
+					double market = PriceKernel<double>(type, 100.0, K, 1.0, 0.25, 0.05, 0.02);
+					sent[slot] = AsyncPricer::ImpliedVolRequest(type, market, 100.0, K, 1.0, 0.05, 0.02);
+				}
+				else if (i % 10 == 5) {
+					sent[slot] = AsyncPricer::GreeksRequest(type, 100.0, K, 1.0, 0.2, 0.05, 0.02, OUT_PRICE | OUT_DELTA | OUT_VEGA);
+				}
+				else {
+					sent[slot] = AsyncPricer::PriceRequest(type, 100.0, K, 1.0, 0.2, 0.05, 0.02);
+				}
+				pending[slot] = pricer.Submit(sent[slot]);
+			}
+			for (int i = 0; i < in_flight; i++) {
+				pending[i].get();
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+	pricer.Stop();
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1000.0;
+	cout << clients << " clients x " << per_client << " requests in " << ms << " ms (" << clients * per_client / ms * 1000.0
+		<< " requests/s), " << mismatches << " results different from the kernels" << endl;
+	cout << pricer.Stats().ToString();
+
+	//back-pressure: callbacks from a thread that must not block, on a small queue
+	NL;
+	AsyncConfig small;
+	small.queue_capacity = 256;
+	small.max_batch = 64;
+	AsyncPricer bounded(small);
+	std::atomic<int> done(0);
+	int refused = 0;
+	for (int i = 0; i < 100000; i++) {
+		if (!bounded.TrySubmit(AsyncPricer::PriceRequest(EU_CALL, 100.0, 100.0, 1.0, 0.2, 0.05, 0.05), [&](const AsyncResult&) { done++; })) {
+			refused++;
+		}
+	}
+	bounded.Stop();
+	cout << "Non blocking submits on a queue of 256: " << done << " priced, " << refused << " refused" << endl;
+	cout << bounded.Stats().ToString();
+}
+
+
+void NumaDemo() {
+	cout << "************* NUMA PLACEMENT *************" << endl;
+	NumaTopology topology;
+	cout << topology.ToString();
+	OptionBook book;
+	const size_t n = 4000000;
+	book.Reserve(n);
+	unsigned int index = book.UnderlyingIndex("SPX");
+	for (size_t i = 0; i < n; i++) {
+		OptionContract c = { 100.0, 50.0 + (i % 100), 0.1 + (i % 50) * 0.1, 0.1 + 0.002 * (i % 200), 0.05, 0.03, 1.0, index, (int)(i % 4) };
+		book.Add(c);
+	}
+	std::vector<double> reference;
+	PriceBook(book, reference);
+
+	//naive placement against pinned workers on node local, huge page backed partitions
+	NumaConfig configs[3];
+	configs[0].pin = false;
+	configs[0].first_touch = false;
+	configs[0].huge_pages = HUGE_PAGES_NONE;
+	configs[2].huge_pages = HUGE_PAGES_EXPLICIT;
+	const char* names[3] = { "Unpinned, copied by the caller, small pages", "Pinned, first touch, transparent huge pages", "Pinned, first touch, explicit huge pages" };
+	for (int k = 0; k < 3; k++) {
+		NumaPricer pricer(configs[k]);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		pricer.Load(book);
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		std::vector<double> prices;
+		double best = 1e300;
+		for (int run = 0; run < 3; run++) {
+			std::chrono::steady_clock::time_point r0 = std::chrono::steady_clock::now();
+			pricer.Price(prices);
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - r0).count());
+		}
+		double diff = 0.0;
+		for (size_t i = 0; i < n; i++) {
+			diff = std::max(diff, fabs(prices[i] - reference[i]));
+		}
+		NL;
+		cout << names[k] << ": load " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms, best price run "
+			<< best * 1000.0 << " ms, max difference with PriceBook " << diff << endl;
+		cout << pricer.Report();
+	}
+
+	//portfolio aggregation on the same placement
+	NL;
+	PortfolioAggregator aggregator(OUT_HEDGE);
+	aggregator.AddBook("Book", book);
+	aggregator.Run();
+	Exposure unplaced = aggregator.Total();
+	aggregator.Placement(NumaConfig());
+	aggregator.Run();
+	cout << "Portfolio aggregation on pinned workers: value " << aggregator.Total().value << ", delta " << aggregator.Total().delta
+		<< (unplaced.value == aggregator.Total().value && unplaced.delta == aggregator.Total().delta ? " (identical to the unpinned run)" : " (differs from the unpinned run)") << endl;
+}
+
+
+void PathDependentDemo() {
+	cout << "************* ASIAN AND LOOKBACK OPTIONS *************" << endl;
+	//monthly averaging over one year, S = K = 100
+	double S = 100.0;
+	AsianOption asian(0.05, 0.25, 100.0, 1.0, 0.03, 12, true);
+	MonteCarloSettings settings;
+	settings.paths = 200000;
+	cout << "Geometric Asian call, closed form: " << asian.GeometricPrice(S) << ", simulated: " << asian.GeometricPriceMC(S, settings).ToString() << endl;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	MonteCarloResult arithmetic = asian.ArithmeticPrice(S, settings);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	cout << "Arithmetic Asian call: " << arithmetic.ToString() << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms" << endl;
+	//paths needed without the control variate for the same standard error
+	cout << "Paths for the same error without the control variate: " << (size_t)(settings.paths * arithmetic.VarianceReduction()) << endl;
+	AsianOption asian_put(0.05, 0.25, 100.0, 1.0, 0.03, 12, false);
+	cout << "Arithmetic Asian put: " << asian_put.ArithmeticPrice(S, settings).ToString() << ", geometric " << asian_put.GeometricPrice(S) << endl;
+
+	//daily observed lookbacks over six months
+	NL;
+	const char* names[4] = { "Floating strike call", "Floating strike put", "Fixed strike call (K = 105)", "Fixed strike put (K = 95)" };
+	LookbackOption lookbacks[4] = { LookbackOption(0.05, 0.25, 100.0, 0.5, 0.03, 126, true, true), LookbackOption(0.05, 0.25, 100.0, 0.5, 0.03, 126, false, true),
+		LookbackOption(0.05, 0.25, 105.0, 0.5, 0.03, 126, true, false), LookbackOption(0.05, 0.25, 95.0, 0.5, 0.03, 126, false, false) };
+	for (int k = 0; k < 4; k++) {
+		cout << names[k] << ": continuous " << lookbacks[k].ContinuousPrice(S) << ", discrete (corrected) " << lookbacks[k].DiscretePrice(S)
+			<< ", simulated " << lookbacks[k].Price(S, settings).ToString() << endl;
+	}
+}
+
+
+void MultilevelDemo() {
+	cout << "************* MULTILEVEL MONTE CARLO *************" << endl;
+	//European call and put (one fixing) against the closed form
+	PathModel model = { 100.0, 1.0, 0.2, 0.05, 0.05, 1 };
+	EuOptCall call(0.05, 0.2, 100.0, 1.0, 0.05);
+	EuOptPut put(0.05, 0.2, 100.0, 1.0, 0.05);
+	EuropeanPayoff call_payoff(100.0, true), put_payoff(100.0, false);
+	const char* schemes[2] = { "Euler", "Milstein" };
+	for (int scheme = SCHEME_EULER; scheme <= SCHEME_MILSTEIN; scheme++) {
+		MlmcSettings settings;
+		settings.scheme = scheme;
+		settings.rmse = 0.01;
+		MlmcResult c = MultilevelMC(model, call_payoff, settings).Run();
+		MlmcResult p = MultilevelMC(model, put_payoff, settings).Run();
+		cout << schemes[scheme] << ", RMSE 0.01: call " << c.price << " (exact " << call.Price(100.0) << "), put " << p.price << " (exact " << put.Price(100.0) << ")" << endl;
+		cout << c.ToString();
+		NL;
+	}
+
+	//cost against the target error
+	MlmcSettings settings;
+	for (double eps = 0.04; eps > 0.004; eps /= 2.0) {
+		settings.rmse = eps;
+		MlmcResult r = MultilevelMC(model, call_payoff, settings).Run();
+		cout << "RMSE " << eps << ": levels " << r.levels.size() << ", cost " << r.cost << ", cost * eps^2 " << r.cost * eps * eps
+			<< ", single level cost * eps^2 " << r.single_level_cost * eps * eps << ", error " << fabs(r.price - call.Price(100.0)) << endl;
+	}
+
+	//monthly arithmetic Asian call against the exact simulation with control variate
+	NL;
+	PathModel monthly = { 100.0, 1.0, 0.25, 0.05, 0.03, 12 };
+	AsianPayoff asian_payoff(100.0, true);
+	settings.rmse = 0.005;
+	MlmcResult asian = MultilevelMC(monthly, asian_payoff, settings).Run();
+	MonteCarloSettings mc;
+	mc.paths = 400000;
+	cout << "Arithmetic Asian call, MLMC: " << asian.price << " +/- " << asian.std_error << ", exact paths with control variate: "
+		<< AsianOption(0.05, 0.25, 100.0, 1.0, 0.03, 12, true).ArithmeticPrice(100.0, mc).ToString() << endl;
+}
+
+
+void HedgingDemo() {
+	cout << "************* DELTA HEDGING BACKTEST *************" << endl;
+	//one year at-the-money call sold and hedged daily over 10000 paths
+	EuOptCall call(0.05, 0.2, 100.0, 1.0, 0.05);
+	HedgingSimulator simulator(call);
+	HedgeSettings settings;
+	HedgeResult daily = simulator.Run(100.0, settings);
+	cout << "Daily rebalancing, no costs" << endl << daily.ToString() << daily.Histogram(15, 40);
+
+	//schedules and costs: the error shrinks like 1/sqrt(rebalancing frequency), the costs grow with it
+	NL;
+	int every[3] = { 1, 5, 21 };
+	const char* names[3] = { "daily", "weekly", "monthly" };
+	settings.cost_rate = 0.0005;
+	for (int k = 0; k < 3; k++) {
+		settings.rebalance_every = every[k];
+		HedgeResult r = simulator.Run(100.0, settings);
+		cout << "Rebalanced " << names[k] << " with 5bp costs: mean " << r.mean << ", standard deviation " << r.std_dev << ", 5% ES " << r.es95
+			<< ", costs " << r.mean_cost << ", trades " << r.mean_trades << endl;
+	}
+	settings.rebalance_every = 1;
+	settings.delta_band = 0.05;
+	HedgeResult band = simulator.Run(100.0, settings);
+	cout << "Reviewed daily, traded when the delta moved by 0.05: mean " << band.mean << ", standard deviation " << band.std_dev << ", 5% ES " << band.es95
+		<< ", costs " << band.mean_cost << ", trades " << band.mean_trades << endl;
+
+	//volatility mismatch: hedging a put at 20% while the realized volatility is 30%
+	NL;
+	EuOptPut put(0.05, 0.2, 100.0, 1.0, 0.05);
+	HedgeSettings mismatch;
+	mismatch.realized_vol = 0.3;
+	HedgeResult r = HedgingSimulator(put).Run(100.0, mismatch);
+	cout << "Put hedged at 20% with 30% realized volatility: mean error " << r.mean << " (premium " << r.premium << ", at 30% the put is worth "
+		<< EuOptPut(0.05, 0.3, 100.0, 1.0, 0.05).Price(100.0) << ")" << endl;
+}
+
+
+void ExoticDemo() {
+	cout << "************* EXOTIC OPTIONS *************" << endl;
+	const double S = 100.0, K = 100.0, T = 1.0, sig = 0.2, rf = 0.05, b = 0.02;
+	//digitals: the cash-or-nothing call is -dC/dK, asset-or-nothing less K cash-or-nothing is the vanilla call
+	double h = 0.01;
+	double slope = -(EuCallKernel(S, K + h, T, sig, rf, b) - EuCallKernel(S, K - h, T, sig, rf, b)) / (2.0 * h);
+	double cash_call = ExoticPriceKernel<double>(CASH_CALL, S, K, T, sig, rf, b, 0.0, 1.0);
+	double asset_call = ExoticPriceKernel<double>(ASSET_CALL, S, K, T, sig, rf, b, 0.0, 0.0);
+	cout << "Cash-or-nothing call: " << cash_call << ", -dC/dK: " << slope << endl;
+	cout << "Asset-or-nothing call - K cash-or-nothing call: " << asset_call - K * cash_call << ", vanilla call: " << EuCallKernel(S, K, T, sig, rf, b) << endl;
+	cout << "Gap call (trigger 100, strike 90): " << ExoticPriceKernel<double>(GAP_CALL, S, K, T, sig, rf, b, 90.0, 0.0)
+		<< ", gap put (trigger 100, strike 110): " << ExoticPriceKernel<double>(GAP_PUT, S, K, T, sig, rf, b, 110.0, 0.0) << endl;
+
+	//barriers: knock-in + knock-out = vanilla without rebate
+	NL;
+	struct Barrier {
+		int in, out;
+		double H;
+		const char* name;
+	};
+	Barrier barriers[4] = { { DOWN_IN_CALL, DOWN_OUT_CALL, 90.0, "Down call, H = 90" }, { UP_IN_CALL, UP_OUT_CALL, 120.0, "Up call, H = 120" },
+		{ DOWN_IN_PUT, DOWN_OUT_PUT, 90.0, "Down put, H = 90" }, { UP_IN_PUT, UP_OUT_PUT, 120.0, "Up put, H = 120" } };
+	for (int k = 0; k < 4; k++) {
+		const Barrier& bar = barriers[k];
+		double in = ExoticPriceKernel<double>(bar.in, S, K, T, sig, rf, b, bar.H, 0.0);
+		double out = ExoticPriceKernel<double>(bar.out, S, K, T, sig, rf, b, bar.H, 0.0);
+		bool call = (bar.in == DOWN_IN_CALL || bar.in == UP_IN_CALL);
+		cout << bar.name << ": in " << in << ", out " << out << ", in + out " << in + out << ", vanilla "
+			<< (call ? EuCallKernel(S, K, T, sig, rf, b) : EuPutKernel(S, K, T, sig, rf, b)) << endl;
+	}
+
+	//down-and-out call monitored daily: Monte Carlo against the closed form at the shifted barrier H e^(-0.5826 sig sqrt(dt))
+	NL;
+	const double H = 95.0, rebate = 2.0;
+	const int days = 252;
+	double shifted = H * exp(-0.5826 * sig * sqrt(T / days));
+	PathModel model = { S, T, sig, rf, b, days };
+	MonteCarloSettings mc;
+	mc.paths = 200000;
+	mc.control_variate = false;
+	const double df = exp(-rf * T);
+	MonteCarloResult r = SimulateGBM(model, 0.0, mc, [=](const double* path, int n, double& y, double& x) {
+		x = 0.0;
+		for (int i = 1; i <= n; i++) {
+			if (path[i] <= H) {
+				y = rebate * exp(-rf * T * i / n); //rebate paid at the hit
+				return;
+			}
+		}
+		y = df * std::max(path[n] - K, 0.0);
+	});
+	cout << "Down-and-out call, H = 95, rebate 2, daily monitoring: Monte Carlo " << r.price << " +/- " << r.std_error << ", closed form at the shifted barrier "
+		<< ExoticPriceKernel<double>(DOWN_OUT_CALL, S, K, T, sig, rf, b, shifted, rebate) << ", continuous monitoring "
+		<< ExoticPriceKernel<double>(DOWN_OUT_CALL, S, K, T, sig, rf, b, H, rebate) << endl;
+
+	//closed form Greeks of the digitals against bumped prices, spot 105
+	NL;
+	const double spot = 105.0;
+	int types[3] = { CASH_PUT, ASSET_CALL, GAP_PUT };
+	const char* names[3] = { "Cash-or-nothing put", "Asset-or-nothing call", "Gap put" };
+	for (int k = 0; k < 3; k++) {
+		OptionOutputs<double> exact = OptionOutputs<double>();
+		ExoticGreeksKernel<OUT_ALL>(types[k], spot, K, T, sig, rf, b, 110.0, 10.0, OUT_ALL, exact);
+		double hS = 1e-3 * spot, hs = 1e-4;
+		double up = ExoticPriceKernel<double>(types[k], spot + hS, K, T, sig, rf, b, 110.0, 10.0);
+		double dn = ExoticPriceKernel<double>(types[k], spot - hS, K, T, sig, rf, b, 110.0, 10.0);
+		double vega = (ExoticPriceKernel<double>(types[k], spot, K, T, sig + hs, rf, b, 110.0, 10.0) - ExoticPriceKernel<double>(types[k], spot, K, T, sig - hs, rf, b, 110.0, 10.0)) / (2.0 * hs);
+		cout << names[k] << ": delta " << exact.delta << " (bumped " << (up - dn) / (2.0 * hS) << "), gamma " << exact.gamma << " (bumped "
+			<< (up - 2.0 * exact.price + dn) / (hS * hS) << "), vega " << exact.vega << " (bumped " << vega << ")" << endl;
+	}
+
+	//batch of mixed exotics
+	NL;
+	const size_t n = 1000000;
+	std::vector<ExoticContract> contracts(n);
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<double> u(0.0, 1.0);
+	for (size_t i = 0; i < n; i++) {
+		ExoticContract& c = contracts[i];
+		c.S = 80.0 + 40.0 * u(gen);
+		c.K = 100.0;
+		c.T = 0.25 + 1.75 * u(gen);
+		c.sig = 0.1 + 0.3 * u(gen);
+		c.rf = 0.05;
+		c.b = 0.02;
+		c.type = (int)(i % (UP_OUT_PUT + 1));
+		c.H = (c.type == GAP_CALL || c.type == GAP_PUT) ? 95.0 : ((c.type >= UP_IN_CALL && c.type <= UP_OUT_CALL) || c.type >= UP_IN_PUT ? 130.0 : 75.0);
+		c.cash = (c.type <= CASH_PUT) ? 10.0 : 0.0;
+	}
+	GreekColumns columns;
+	unsigned int masks[3] = { OUT_PRICE, OUT_HEDGE, OUT_ALL };
+	const char* mask_names[3] = { "price", "price and delta", "all outputs" };
+	for (int k = 0; k < 3; k++) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		PriceExotics(contracts, masks[k], columns);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		cout << n << " digital, gap and barrier options (" << mask_names[k] << "): " << ms << " ms" << endl;
+	}
+}
+
+#endif
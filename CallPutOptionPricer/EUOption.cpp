@@ -1,13 +1,14 @@
 /* Call and Put Options functions implementation */
 /*****************************************************
 Name: EUOption.cpp
-version: 0.1
+version: 0.2
 Description:
 Implementation of the functions in EUOption.hpp to
 provide functionality for plain (European) equity options (with zero dividends)
 
 Change history:
 0.1 Initial version
+0.2 Underlying asset accessors
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -71,6 +72,7 @@ EuOpt::EuOpt() { //batch 1 is the default initialization for the default constru
 
 EuOpt::EuOpt(const EuOpt& source) {
 	m_contract = source.m_contract;
+	underlying = source.underlying;
 }
 
 EuOpt::~EuOpt() {
@@ -81,10 +83,20 @@ EuOpt::~EuOpt() {
 EuOpt& EuOpt::operator = (const EuOpt& source) {
 	if (this != &source) {//checking if the objects are equal before performing assignment operations
 		m_contract = source.m_contract;
+		underlying = source.underlying;
 	}
 	return *this;
 }
 
+/*Underlying asset member functions implementation*/
+std::string EuOpt::Underlying() const {
+	return underlying;
+}
+
+void EuOpt::Underlying(const std::string& name) {
+	underlying = name;
+}
+
 /*ToString member function implementation*/
 std::string EuOpt::ToString() const {
 	std::stringstream ss;
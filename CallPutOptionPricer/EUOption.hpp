@@ -1,12 +1,13 @@
 /* Call and Put Options functions */
 /*****************************************************
 Name: EUOption.hpp
-version: 0.1
+version: 0.2
 Description:
 These functions provide functionality for plain (European) equity options (with zero dividends)
 
 Change history:
 0.1 Initial version
+0.2 Underlying asset accessors
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -66,6 +67,10 @@ public:
 	/*Overload operators*/
 	EuOpt& operator = (const EuOpt& source);
 
+	/*Member functions to retrieve and set the underlying asset*/
+	std::string Underlying() const;
+	void Underlying(const std::string& name);
+
 	/*Printing functions*/
 	virtual std::string ToString() const;
 	std::string Print() const;
@@ -1,13 +1,18 @@
 /* Call Options functions implementation */
 /*****************************************************
 Name: EUOptionCall.cpp
-version: 0.1
+version: 0.6
 Description:
 Implementation of the functions in EUOption.hpp to
 provide functionality for plain (European) equity options (with zero dividends)
 
 Change history:
 0.1 Initial version
+0.2 Shared-grid divided differences Greek ladders (GreeksLadderDDM)
+0.3 Pricing with the volatility read from a VolSurface
+0.4 Pricing with rate and carry term structures
+0.5 Vega discounts with exp((b-rf)*T) (was exp(b-rf)*T)
+0.6 Greeks selected by an output mask; Theta discounts with exp((b-rf)*T) (was exp(b-rf))
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -43,6 +48,11 @@ C + Ke^(-rT) = P + S
 
 #include "EUOptionCall.hpp"
 #include <cmath>
+#include "Instrumentation.hpp"
+#include "GreeksLadder.hpp"
+#include "PricingKernels.hpp"
+#include "VolSurface.hpp"
+#include "TermCurve.hpp"
 #include <iostream>
 
 /*Default constructor, parameterized constructor, copy constructor, and destructor implementation*/
@@ -128,6 +138,7 @@ void EuOptCall::CostOfCarry(double new_b) {
 
 /*Pricer and sensitivities functions implementation*/
 double EuOptCall::Price(double S) const {
+	PRICER_PROBE("EuOptCall::Price");
 		double denominator = sig * sqrt(T);
 		double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
 		double d2 = d1 - denominator;
@@ -135,6 +146,28 @@ double EuOptCall::Price(double S) const {
 		return (S * exp((b - rf)*T) * N(d1)) - (K * exp(-rf * T)* N(d2));
 }
 
+double EuOptCall::Price(double S, const VolSurface& surface) const {
+	PRICER_PROBE("EuOptCall::Price(surface)");
+	double vol = surface.Vol(S * exp(b * T), K, T); //the surface is quoted in forward moneyness
+	double denominator = vol * sqrt(T);
+	double d1 = (log(S / K) + (b + (vol*vol)*0.5) * T) / denominator;
+	double d2 = d1 - denominator;
+
+	return (S * exp((b - rf)*T) * N(d1)) - (K * exp(-rf * T)* N(d2));
+}
+
+double EuOptCall::Price(double S, const TermCurve& rates, const TermCurve& carry) const {
+	PRICER_PROBE("EuOptCall::Price(curves)");
+	//cached curves turn both exp calls into table lookups and hand back the cached carry rate for d1
+	double df = rates.DiscountFactor(T);
+	double growth = carry.Growth(T);
+	double denominator = sig * sqrt(T);
+	double d1 = (log(S / K) + (carry.Rate(T) + (sig*sig)*0.5) * T) / denominator;
+	double d2 = d1 - denominator;
+
+	return (S * growth * df * N(d1)) - (K * df * N(d2));
+}
+
 /*double EuOptPut::Price(double S, OptionData& data) {
 double denominator = data.sig * sqrt(data.T);
 double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) * denominator;
@@ -162,6 +195,7 @@ double EuOptCall::PutCallParity(double S) const {
 
 std::vector<double> EuOptCall::PriceRange(int num, double start_S, double end_S)
 { //num equals the number of increments before reaching the end price end_S
+	PRICER_PROBE("EuOptCall::PriceRange");
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
 	double mesh_size = (end_S - start_S) / num; //increment size h
@@ -173,6 +207,7 @@ std::vector<double> EuOptCall::PriceRange(int num, double start_S, double end_S)
 }
 
 std::vector<double> EuOptCall::PriceRange(int num, double S, double start, double end, int param) {
+	PRICER_PROBE("EuOptCall::PriceRange(T/sig)");
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
 	double mesh_size = (end - start) / num; //increment size h
@@ -202,6 +237,7 @@ std::vector<double> EuOptCall::PriceRange(int num, double S, double start, doubl
 
 //Greeks initialization
 double EuOptCall::Delta(double S) const {
+	PRICER_PROBE("EuOptCall::Delta");
 	//exp((b - rf)*T) * N(d1) -- f'(C) with respect to S
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
@@ -210,6 +246,7 @@ double EuOptCall::Delta(double S) const {
 }
 
 double EuOptCall::Gamma(double S) const {
+	PRICER_PROBE("EuOptCall::Gamma");
 	//exp((b-rf)*T)*(N(d1)/(S*sig*sqrt(T)) -- f''(C) with respect to S
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
@@ -218,24 +255,27 @@ double EuOptCall::Gamma(double S) const {
 }
 
 double EuOptCall::Vega(double S) const {
-	//S*sqrt(T)*(exp(b-rf)*T)*n(d1) -- f'(C) with respect to sigma
+	PRICER_PROBE("EuOptCall::Vega");
+	//S*sqrt(T)*exp((b-rf)*T)*n(d1) -- f'(C) with respect to sigma
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
 
-	return S*sqrt(T)*(exp(b - rf)*T)*n(d1);
+	return S*sqrt(T)*exp((b - rf)*T)*n(d1);
 
 }
 
 double EuOptCall::Theta(double S) const {
-	//-((S*sig*exp((b-rf))*n(d1))/(2*sqrt(T))) - (b-rf)*S*exp((b-rf)*T)*N(d1)-rf*K*exp(-rf*T)*N(d2) -- -f'(C) with respect to T
+	PRICER_PROBE("EuOptCall::Theta");
+	//-((S*sig*exp((b-rf)*T)*n(d1))/(2*sqrt(T))) - (b-rf)*S*exp((b-rf)*T)*N(d1)-rf*K*exp(-rf*T)*N(d2) -- -f'(C) with respect to T
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
 	double d2 = d1 - denominator;
 
-	return -((S*sig*exp((b - rf))*n(d1)) / (2.0 * sqrt(T))) - (b - rf)*S*exp((b - rf)*T)*N(d1) - rf*K*exp(-rf*T)*N(d2);
+	return -((S*sig*exp((b - rf)*T)*n(d1)) / (2.0 * sqrt(T))) - (b - rf)*S*exp((b - rf)*T)*N(d1) - rf*K*exp(-rf*T)*N(d2);
 }
 
 std::vector<double> EuOptCall::GreeksRange(int num, double start_S, double end_S, int param) {
+	PRICER_PROBE("EuOptCall::GreeksRange");
 	//num equals the number of increments before reaching the end price end_S
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
@@ -270,6 +310,21 @@ std::vector<double> EuOptCall::GreeksRange(int num, double start_S, double end_S
 	return vec;
 }
 
+void EuOptCall::GreeksRange(int num, double start_S, double end_S, unsigned int mask, GreekColumns& columns) const {
+	PRICER_PROBE("EuOptCall::GreeksRange(mask)");
+	//every requested output of every node in one pass, d1, d2 and the factors shared between the outputs
+	columns.Resize(mask, num + 1);
+	double mesh_size = (end_S - start_S) / num; //increment size h
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		OptionOutputs<double> out = OptionOutputs<double>();
+		for (int i = 0; i <= num; i++) {
+			GreeksKernel<Mask>(EU_CALL, start_S + i*mesh_size, K, T, sig, rf, b, mask, out);
+			columns.Store<Mask>(i, out);
+		}
+	});
+}
+
 //We now use divided differences to approximate option sensitivities.
 //In general, we can approximate first and second - order derivatives in S by 3-point second order approximations
 double EuOptCall::DeltaDDM(double S, double h) const {
@@ -283,6 +338,7 @@ double EuOptCall::GammaDDM(double S, double h) const {
 }
 
 std::vector<double> EuOptCall::GreeksRangeDDM(int num, double h, double start_S, double end_S, int param) {
+	PRICER_PROBE("EuOptCall::GreeksRangeDDM");
 	//num equals the number of increments before reaching the end price end_S
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
@@ -305,6 +361,11 @@ std::vector<double> EuOptCall::GreeksRangeDDM(int num, double h, double start_S,
 	return vec;
 }
 
+void EuOptCall::GreeksLadderDDM(int num, double h, double start_S, double end_S, std::vector<double>& deltas, std::vector<double>& gammas) const {
+	PRICER_PROBE("EuOptCall::GreeksLadderDDM");
+	::GreeksLadderDDM(num, h, start_S, end_S, [this](double S) { return this->Price(S); }, deltas, gammas);
+}
+
 /*Print function implementation*/
 std::string EuOptCall::ToString() const {
 	std::string s = EuOpt::ToString();
@@ -1,12 +1,16 @@
 /* Call Options functions */
 /*****************************************************
 Name: EUOptionCall.hpp
-version: 0.1
+version: 0.5
 Description:
 These functions provide functionality for plain (European) equity options (with zero dividends)
 
 Change history:
 0.1 Initial version
+0.2 Shared-grid divided differences Greek ladders (GreeksLadderDDM)
+0.3 Pricing with the volatility read from a VolSurface
+0.4 Pricing with rate and carry term structures
+0.5 Greeks selected by an output mask in one pass (GreeksRange with a mask)
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -45,6 +49,10 @@ C + Ke^(-rT) = P + S
 
 #include "EUOption.hpp"
 
+class VolSurface;
+class TermCurve;
+struct GreekColumns;
+
 class EuOptCall : public EuOpt {
 private:
 	/*Initialization of parameters for the option pricing model*/
@@ -81,6 +89,8 @@ public:
 
 	/*Pricer & sensitivites functions*/
 	double Price(double S) const;
+	double Price(double S, const VolSurface& surface) const; //uses the surface volatility at (K, T) instead of sig
+	double Price(double S, const TermCurve& rates, const TermCurve& carry) const; //uses the curves at T instead of rf and b
 	//double Price(double S, OptionData& data); //Pricer function that does not need to be called on an instance of the class
 	double PutCallParity(double S) const;
 	double PutCallParity(double C, double S) const;
@@ -92,12 +102,16 @@ public:
 	double Vega(double S) const;
 	double Theta(double S) const;
 	std::vector<double> GreeksRange(int num, double start_S, double end_S, int param); //Sensitivities as a f(S)
+	void GreeksRange(int num, double start_S, double end_S, unsigned int mask, GreekColumns& columns) const; //outputs selected by a mask of OutputFlag as a f(S), one pass
 	//We now use divided differences to approximate option sensitivities.
 	//In general, we can approximate first and second - order derivatives in S by 3-point second order approximations
 	//As we input a smaller and smaller h, the approximation gets closer to the actual B-S formula
 	double DeltaDDM(double S, double h) const; //approximate Delta using the Divided Differences Method
 	double GammaDDM(double S, double h) const; //approximate Gamma using the Divided Differences Method
 	std::vector<double> GreeksRangeDDM(int num, double h,double start_S, double end_S, int param); //Sensitivities as a f(S) using DDM
+	//Ladder mode: prices the grid once and derives both the delta and the gamma ladder from the shared prices.
+	//If h is a multiple of the mesh size the offset points S-h and S+h are grid nodes and are not priced twice
+	void GreeksLadderDDM(int num, double h, double start_S, double end_S, std::vector<double>& deltas, std::vector<double>& gammas) const;
 
 	/*Printing functions*/
 	virtual std::string ToString() const;
@@ -1,13 +1,17 @@
 /* Put Options functions implementation */
 /*****************************************************
 Name: EUOptionPut.cpp
-version: 0.1
+version: 0.5
 Description:
 Implementation of the functions in EUOption.hpp to
 provide functionality for plain (European) equity options (with zero dividends)
 
 Change history:
 0.1 Initial version
+0.2 Shared-grid divided differences Greek ladders (GreeksLadderDDM)
+0.3 Pricing with the volatility read from a VolSurface
+0.4 Pricing with rate and carry term structures
+0.5 Greeks selected by an output mask (GreeksRange with a mask)
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -43,6 +47,11 @@ C + Ke^(-rT) = P + S
 
 #include "EUOptionPut.hpp"
 #include <cmath>
+#include "Instrumentation.hpp"
+#include "GreeksLadder.hpp"
+#include "PricingKernels.hpp"
+#include "VolSurface.hpp"
+#include "TermCurve.hpp"
 #include <iostream>
 
 /*Default constructor, parameterized constructor, copy constructor, and destructor implementation*/
@@ -128,6 +137,7 @@ void EuOptPut::CostOfCarry(double new_b) {
 
 /*Pricer and sensitivities functions implementation*/
 double EuOptPut::Price(double S) const {
+	PRICER_PROBE("EuOptPut::Price");
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
 	double d2 = d1 - denominator;
@@ -135,6 +145,28 @@ double EuOptPut::Price(double S) const {
 	return (K * exp(-rf * T)* N(-d2)) - (S * exp((b - rf)*T) * N(-d1));
 }
 
+double EuOptPut::Price(double S, const VolSurface& surface) const {
+	PRICER_PROBE("EuOptPut::Price(surface)");
+	double vol = surface.Vol(S * exp(b * T), K, T); //the surface is quoted in forward moneyness
+	double denominator = vol * sqrt(T);
+	double d1 = (log(S / K) + (b + (vol*vol)*0.5) * T) / denominator;
+	double d2 = d1 - denominator;
+
+	return (K * exp(-rf * T)* N(-d2)) - (S * exp((b - rf)*T) * N(-d1));
+}
+
+double EuOptPut::Price(double S, const TermCurve& rates, const TermCurve& carry) const {
+	PRICER_PROBE("EuOptPut::Price(curves)");
+	//cached curves turn both exp calls into table lookups and hand back the cached carry rate for d1
+	double df = rates.DiscountFactor(T);
+	double growth = carry.Growth(T);
+	double denominator = sig * sqrt(T);
+	double d1 = (log(S / K) + (carry.Rate(T) + (sig*sig)*0.5) * T) / denominator;
+	double d2 = d1 - denominator;
+
+	return (K * df * N(-d2)) - (S * growth * df * N(-d1));
+}
+
 /*double EuOptPut::Price(double S, OptionData& data) {
 	double denominator = data.sig * sqrt(data.T);
 	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) * denominator;
@@ -162,6 +194,7 @@ double EuOptPut::PutCallParity(double S) const {
 
 std::vector<double> EuOptPut::PriceRange(int num, double start_S, double end_S)
 { //num equals the number of increments before reaching the end price end_S
+	PRICER_PROBE("EuOptPut::PriceRange");
 	std::vector<double> vec;
 	vec.resize(num+1); //allocates space
 	double mesh_size = (end_S - start_S) / num; //increment size h
@@ -173,6 +206,7 @@ std::vector<double> EuOptPut::PriceRange(int num, double start_S, double end_S)
 }
 
 std::vector<double> EuOptPut::PriceRange(int num, double S, double start, double end, int param) {
+	PRICER_PROBE("EuOptPut::PriceRange(T/sig)");
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
 	double mesh_size = (end - start) / num; //increment size h
@@ -202,6 +236,7 @@ std::vector<double> EuOptPut::PriceRange(int num, double S, double start, double
 
 //Greeks initialization
 double EuOptPut::Delta(double S) const {
+	PRICER_PROBE("EuOptPut::Delta");
 	//exp((b - rf)*T) * (N(d1) - 1.0) -- f'(P) with respect to S
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
@@ -210,6 +245,7 @@ double EuOptPut::Delta(double S) const {
 }
 
 double EuOptPut::Gamma(double S) const {
+	PRICER_PROBE("EuOptPut::Gamma");
 	//exp((b-rf)*T)*(n(d1)/(S*sig*sqrt(T)) -- f''(P) with respect to S
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
@@ -218,6 +254,7 @@ double EuOptPut::Gamma(double S) const {
 }
 
 double EuOptPut::Vega(double S) const {
+	PRICER_PROBE("EuOptPut::Vega");
 	//K*exp(-rf*T)*n(d2)*sqrt(T) -- f'(P) with respect to sigma
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
@@ -227,6 +264,7 @@ double EuOptPut::Vega(double S) const {
 }
 
 double EuOptPut::Theta(double S) const {
+	PRICER_PROBE("EuOptPut::Theta");
 	//-exp((b-rf)*T) * ((S*n(di)*sig)/(2*sqrt(T))) + rf*K*exp(-rf*T)*N(-d2)-(rf-b)*S*exp((b-rf)*T)*N(-d1) -- -f'(P) with respect to T
 	double denominator = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / denominator;
@@ -236,6 +274,7 @@ double EuOptPut::Theta(double S) const {
 }
 
 std::vector<double> EuOptPut::GreeksRange(int num, double start_S, double end_S, int param) {
+	PRICER_PROBE("EuOptPut::GreeksRange");
 	//num equals the number of increments before reaching the end price end_S
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
@@ -270,6 +309,21 @@ std::vector<double> EuOptPut::GreeksRange(int num, double start_S, double end_S,
 	return vec;
 }
 
+void EuOptPut::GreeksRange(int num, double start_S, double end_S, unsigned int mask, GreekColumns& columns) const {
+	PRICER_PROBE("EuOptPut::GreeksRange(mask)");
+	//every requested output of every node in one pass, d1, d2 and the factors shared between the outputs
+	columns.Resize(mask, num + 1);
+	double mesh_size = (end_S - start_S) / num; //increment size h
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		OptionOutputs<double> out = OptionOutputs<double>();
+		for (int i = 0; i <= num; i++) {
+			GreeksKernel<Mask>(EU_PUT, start_S + i*mesh_size, K, T, sig, rf, b, mask, out);
+			columns.Store<Mask>(i, out);
+		}
+	});
+}
+
 //We now use divided differences to approximate option sensitivities.
 //In general, we can approximate first and second - order derivatives in S by 3-point second order approximations
 double EuOptPut::DeltaDDM(double S, double h) const {
@@ -283,6 +337,7 @@ double EuOptPut::GammaDDM(double S, double h) const {
 }
 
 std::vector<double> EuOptPut::GreeksRangeDDM(int num, double h, double start_S, double end_S, int param) {
+	PRICER_PROBE("EuOptPut::GreeksRangeDDM");
 	//num equals the number of increments before reaching the end price end_S
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
@@ -305,6 +360,11 @@ std::vector<double> EuOptPut::GreeksRangeDDM(int num, double h, double start_S,
 	return vec;
 }
 
+void EuOptPut::GreeksLadderDDM(int num, double h, double start_S, double end_S, std::vector<double>& deltas, std::vector<double>& gammas) const {
+	PRICER_PROBE("EuOptPut::GreeksLadderDDM");
+	::GreeksLadderDDM(num, h, start_S, end_S, [this](double S) { return this->Price(S); }, deltas, gammas);
+}
+
 /*Print function implementation*/
 std::string EuOptPut::ToString() const {
 	std::string s = EuOpt::ToString();
@@ -0,0 +1,239 @@
+/* Inline exotic option kernels */
+/*****************************************************
+Name: ExoticKernels.hpp
+version: 0.2
+Description:
+Closed form kernels for the European exotics of the generalized Black-Scholes model of EuOptCall / EuOptPut
+(risk-free rate rf, cost of carry b), working on plain numbers like PricingKernels.hpp so that batch pricers
+(PriceExotics in BatchPricer.hpp) call them in tight loops. Every kernel starts from the BsFactors of the contract
+(d1, d2, sig*sqrt(T), e^((b-rf)T), e^(-rf T)), the intermediates of the vanilla kernel.
+
+Digitals (cash = amount paid):
+	cash-or-nothing call: cash e^(-rT) N(d2), put: cash e^(-rT) N(-d2)
+	asset-or-nothing call: S e^((b-r)T) N(d1), put: S e^((b-r)T) N(-d1)
+Gap options (K is the trigger, H the strike paid; the payoff S(T) - H when S(T) > K can be negative):
+	call: S e^((b-r)T) N(d1) - H e^(-rT) N(d2), put: H e^(-rT) N(-d2) - S e^((b-r)T) N(-d1), d1 and d2 at K
+Single barrier options (Reiner and Rubinstein, 1991), strike K, barrier H observed continuously until T, rebate
+cash paid at expiry for the knock-in options never knocked in and at the hit for the knock-out options:
+with phi = 1 (call) or -1 (put), eta = 1 (down) or -1 (up), mu = (b - sig^2/2) / sig^2,
+lambda = sqrt(mu^2 + 2r / sig^2) and the terms A..F of the standard decomposition
+	A = phi S e^((b-r)T) N(phi x1) - phi K e^(-rT) N(phi x1 - phi sig sqrt(T)), x1 = d1 (the vanilla price)
+	B = as A with x2 = ln(S/H) / (sig sqrt(T)) + (1 + mu) sig sqrt(T)
+	C = phi S e^((b-r)T) (H/S)^(2(mu+1)) N(eta y1) - phi K e^(-rT) (H/S)^(2mu) N(eta y1 - eta sig sqrt(T))
+	D = as C with y2 = ln(H/S) / (sig sqrt(T)) + (1 + mu) sig sqrt(T) in place of y1 = ln(H^2/(S K)) / (sig sqrt(T)) + (1 + mu) sig sqrt(T)
+	E = cash e^(-rT) (N(eta x2 - eta sig sqrt(T)) - (H/S)^(2mu) N(eta y2 - eta sig sqrt(T)))
+	F = cash ((H/S)^(mu+lambda) N(eta z) + (H/S)^(mu-lambda) N(eta z - 2 eta lambda sig sqrt(T))), z = ln(H/S) / (sig sqrt(T)) + lambda sig sqrt(T)
+A barrier already crossed (S <= H down, S >= H up) turns a knock-in into the vanilla option and a knock-out into
+its rebate. Knock-in + knock-out = vanilla when the rebate is 0.
+
+ExoticGreeksKernel<Mask> computes the outputs of a mask of OutputFlag like GreeksKernel: delta, gamma and vega of
+the digitals and gap options in closed form (a gap option is an asset-or-nothing less H cash-or-nothing), every
+other output by central differences of the closed form price (relative bumps of 1e-4; rho moves rf and b together).
+The unbumped price and the closed forms share one BsFactors (ExoticPriceAt prices from given factors).
+
+Change history:
+0.1 Initial version
+0.2 BsFactors computed once per contract in ExoticGreeksKernel (ExoticPriceAt), no T in BarrierKernel
+
+******************************************************/
+
+#ifndef EXOTICKERNELS_HPP
+#define EXOTICKERNELS_HPP
+
+#include <cmath>
+#include "PricingKernels.hpp"
+
+enum ExoticType {
+	CASH_CALL = 0, //cash-or-nothing
+	CASH_PUT = 1,
+	ASSET_CALL = 2, //asset-or-nothing
+	ASSET_PUT = 3,
+	GAP_CALL = 4,
+	GAP_PUT = 5,
+	DOWN_IN_CALL = 6,
+	DOWN_OUT_CALL = 7,
+	UP_IN_CALL = 8,
+	UP_OUT_CALL = 9,
+	DOWN_IN_PUT = 10,
+	DOWN_OUT_PUT = 11,
+	UP_IN_PUT = 12,
+	UP_OUT_PUT = 13
+};
+
+struct ExoticContract {
+	double S; //current price of the underlying
+	double K; //strike (trigger of the gap options)
+	double T; //expiry time/maturity expressed in years
+	double sig; //volatility
+	double rf; //risk-free interest rate
+	double b; //cost of carry
+	double H; //barrier, or strike paid by the gap options
+	double cash; //amount of the cash-or-nothing options, rebate of the barrier options
+	int type; //ExoticType
+};
+
+/*Digitals*/
+template <typename Real>
+inline Real CashDigitalKernel(bool call, Real cash, const BsFactors<Real>& f) {
+	return cash * f.df * NormCdf(call ? f.d2 : -f.d2);
+}
+
+template <typename Real>
+inline Real AssetDigitalKernel(bool call, Real S, const BsFactors<Real>& f) {
+	return S * f.carry * NormCdf(call ? f.d1 : -f.d1);
+}
+
+/*Single barrier (Reiner-Rubinstein)*/
+template <typename Real>
+inline Real BarrierKernel(int type, Real S, Real K, Real sig, Real rf, Real b, Real H, Real rebate, const BsFactors<Real>& f) { //T enters through f
+	const bool call = (type == DOWN_IN_CALL || type == DOWN_OUT_CALL || type == UP_IN_CALL || type == UP_OUT_CALL);
+	const bool down = (type == DOWN_IN_CALL || type == DOWN_OUT_CALL || type == DOWN_IN_PUT || type == DOWN_OUT_PUT);
+	const bool knock_in = (type == DOWN_IN_CALL || type == UP_IN_CALL || type == DOWN_IN_PUT || type == UP_IN_PUT);
+	const Real phi = call ? Real(1.0) : Real(-1.0);
+	const Real eta = down ? Real(1.0) : Real(-1.0);
+	const Real vanilla = phi * (S * f.carry * NormCdf(phi * f.d1) - K * f.df * NormCdf(phi * f.d2));
+	if (down ? S <= H : S >= H) { //already crossed
+		return knock_in ? vanilla : rebate;
+	}
+	const Real sig2 = sig * sig;
+	const Real mu = (b - Real(0.5) * sig2) / sig2;
+	const Real lambda = std::sqrt(mu * mu + Real(2.0) * rf / sig2);
+	const Real drift = (Real(1.0) + mu) * f.den;
+	const Real logHS = std::log(H / S);
+	const Real x2 = -logHS / f.den + drift;
+	const Real y1 = (Real(2.0) * logHS - std::log(K / S)) / f.den + drift; //ln(H^2/(S K))
+	const Real y2 = logHS / f.den + drift;
+	const Real z = logHS / f.den + lambda * f.den;
+	const Real HS2mu = std::exp(Real(2.0) * mu * logHS); //(H/S)^(2 mu)
+	const Real HS2mu1 = HS2mu * (H / S) * (H / S); //(H/S)^(2 (mu + 1))
+	const Real fwd = S * f.carry;
+	const Real pv = K * f.df;
+	const Real A = vanilla;
+	const Real B = phi * (fwd * NormCdf(phi * x2) - pv * NormCdf(phi * (x2 - f.den)));
+	const Real C = phi * (fwd * HS2mu1 * NormCdf(eta * y1) - pv * HS2mu * NormCdf(eta * (y1 - f.den)));
+	const Real D = phi * (fwd * HS2mu1 * NormCdf(eta * y2) - pv * HS2mu * NormCdf(eta * (y2 - f.den)));
+	Real E = Real(0.0), F = Real(0.0);
+	if (rebate != Real(0.0)) {
+		E = rebate * f.df * (NormCdf(eta * (x2 - f.den)) - HS2mu * NormCdf(eta * (y2 - f.den)));
+		F = rebate * (std::exp((mu + lambda) * logHS) * NormCdf(eta * z) + std::exp((mu - lambda) * logHS) * NormCdf(eta * (z - Real(2.0) * lambda * f.den)));
+	}
+	const bool above = (K > H);
+	switch (type) {
+	case DOWN_IN_CALL:
+		return above ? C + E : A - B + D + E;
+	case UP_IN_CALL:
+		return above ? A + E : B - C + D + E;
+	case DOWN_OUT_CALL:
+		return above ? A - C + F : B - D + F;
+	case UP_OUT_CALL:
+		return above ? F : A - B + C - D + F;
+	case DOWN_IN_PUT:
+		return above ? B - C + D + E : A + E;
+	case UP_IN_PUT:
+		return above ? A - B + D + E : C + E;
+	case DOWN_OUT_PUT:
+		return above ? A - B + C - D + F : F;
+	case UP_OUT_PUT:
+		return above ? B - D + F : A - C + F;
+	default:
+		return Real(0.0);
+	}
+}
+
+/*Dispatch on the exotic type, from the factors of the contract (BsFactorsAt(S, K, T, sig, rf, b))*/
+template <typename Real>
+inline Real ExoticPriceAt(int type, Real S, Real K, Real sig, Real rf, Real b, Real H, Real cash, const BsFactors<Real>& f) {
+	switch (type) {
+	case CASH_CALL:
+	case CASH_PUT:
+		return CashDigitalKernel(type == CASH_CALL, cash, f);
+	case ASSET_CALL:
+	case ASSET_PUT:
+		return AssetDigitalKernel(type == ASSET_CALL, S, f);
+	case GAP_CALL:
+	case GAP_PUT:
+		return (type == GAP_CALL) ? AssetDigitalKernel(true, S, f) - CashDigitalKernel(true, H, f) : CashDigitalKernel(false, H, f) - AssetDigitalKernel(false, S, f);
+	default:
+		if (type >= DOWN_IN_CALL && type <= UP_OUT_PUT) {
+			return BarrierKernel(type, S, K, sig, rf, b, H, cash, f);
+		}
+		return Real(0.0);
+	}
+}
+
+template <typename Real>
+inline Real ExoticPriceKernel(int type, Real S, Real K, Real T, Real sig, Real rf, Real b, Real H, Real cash) {
+	return ExoticPriceAt(type, S, K, sig, rf, b, H, cash, BsFactorsAt(S, K, T, sig, rf, b));
+}
+
+/*Outputs of one exotic contract, Mask and mask as in GreeksKernel*/
+template <unsigned int Mask, typename Real>
+inline void ExoticGreeksKernel(int type, Real S, Real K, Real T, Real sig, Real rf, Real b, Real H, Real cash, unsigned int mask, OptionOutputs<Real>& out) {
+	const unsigned int want = Mask & mask;
+	const BsFactors<Real> f = BsFactorsAt(S, K, T, sig, rf, b); //shared by the price and the closed form Greeks
+	const Real price = ExoticPriceAt(type, S, K, sig, rf, b, H, cash, f);
+	if (want & OUT_PRICE) out.price = price;
+	unsigned int numeric = want & (OUT_DELTA | OUT_GAMMA | OUT_VEGA | OUT_THETA | OUT_RHO | OUT_VANNA | OUT_VOLGA);
+	if (type >= CASH_CALL && type <= GAP_PUT && (want & (OUT_DELTA | OUT_GAMMA | OUT_VEGA))) {
+		//closed form: a gap option is an asset-or-nothing less H cash-or-nothing
+		const bool call = (type == CASH_CALL || type == ASSET_CALL || type == GAP_CALL);
+		const Real sign = call ? Real(1.0) : Real(-1.0);
+		const Real pdf1 = NormPdf(f.d1), pdf2 = NormPdf(f.d2);
+		//weights of the cash-or-nothing and asset-or-nothing options of the same side
+		Real w_cash = Real(0.0), w_asset = Real(0.0);
+		if (type == CASH_CALL || type == CASH_PUT) {
+			w_cash = cash;
+		}
+		else if (type == ASSET_CALL || type == ASSET_PUT) {
+			w_asset = Real(1.0);
+		}
+		else {
+			w_cash = -sign * H;
+			w_asset = sign;
+		}
+		//cash-or-nothing (unit amount): the put is the discount factor less the call
+		Real delta = w_cash * sign * f.df * pdf2 / (S * f.den);
+		Real gamma = -w_cash * sign * f.df * pdf2 * f.d1 / (S * S * f.den * f.den);
+		Real vega = -w_cash * sign * f.df * pdf2 * f.d1 / sig;
+		//asset-or-nothing: the put is S e^((b-r)T) less the call
+		delta += w_asset * (f.carry * NormCdf(sign * f.d1) + sign * f.carry * pdf1 / f.den);
+		gamma += w_asset * sign * f.carry * pdf1 * (Real(1.0) - f.d1 / f.den) / (S * f.den);
+		vega += -w_asset * sign * S * f.carry * pdf1 * f.d2 / sig;
+		if (want & OUT_DELTA) out.delta = delta;
+		if (want & OUT_GAMMA) out.gamma = gamma;
+		if (want & OUT_VEGA) out.vega = vega;
+		numeric &= ~(unsigned int)(OUT_DELTA | OUT_GAMMA | OUT_VEGA);
+	}
+	if (numeric == 0) {
+		return;
+	}
+	//central differences of the closed form
+	const Real hS = Real(1e-4) * S, hs = Real(1e-4) * sig, hT = Real(1e-4) * T, hr = Real(1e-4);
+	if (numeric & (OUT_DELTA | OUT_GAMMA)) {
+		Real up = ExoticPriceKernel(type, S + hS, K, T, sig, rf, b, H, cash);
+		Real dn = ExoticPriceKernel(type, S - hS, K, T, sig, rf, b, H, cash);
+		if (numeric & OUT_DELTA) out.delta = (up - dn) / (Real(2.0) * hS);
+		if (numeric & OUT_GAMMA) out.gamma = (up - Real(2.0) * price + dn) / (hS * hS);
+	}
+	if (numeric & (OUT_VEGA | OUT_VOLGA)) {
+		Real up = ExoticPriceKernel(type, S, K, T, sig + hs, rf, b, H, cash);
+		Real dn = ExoticPriceKernel(type, S, K, T, sig - hs, rf, b, H, cash);
+		if (numeric & OUT_VEGA) out.vega = (up - dn) / (Real(2.0) * hs);
+		if (numeric & OUT_VOLGA) out.volga = (up - Real(2.0) * price + dn) / (hs * hs);
+	}
+	if (numeric & OUT_THETA) {
+		out.theta = -(ExoticPriceKernel(type, S, K, T + hT, sig, rf, b, H, cash) - ExoticPriceKernel(type, S, K, T - hT, sig, rf, b, H, cash)) / (Real(2.0) * hT);
+	}
+	if (numeric & OUT_RHO) {
+		out.rho = (ExoticPriceKernel(type, S, K, T, sig, rf + hr, b + hr, H, cash) - ExoticPriceKernel(type, S, K, T, sig, rf - hr, b - hr, H, cash)) / (Real(2.0) * hr);
+	}
+	if (numeric & OUT_VANNA) {
+		Real uu = ExoticPriceKernel(type, S + hS, K, T, sig + hs, rf, b, H, cash);
+		Real ud = ExoticPriceKernel(type, S + hS, K, T, sig - hs, rf, b, H, cash);
+		Real du = ExoticPriceKernel(type, S - hS, K, T, sig + hs, rf, b, H, cash);
+		Real dd = ExoticPriceKernel(type, S - hS, K, T, sig - hs, rf, b, H, cash);
+		out.vanna = (uu - ud - du + dd) / (Real(4.0) * hS * hs);
+	}
+}
+
+#endif
@@ -0,0 +1,232 @@
+/* Fourier option pricing implementation */
+/*****************************************************
+Name: FourierPricer.cpp
+version: 0.1
+Description:
+Implementation of the functions in FourierPricer.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "FourierPricer.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const double PI = 3.14159265358979323846;
+typedef std::complex<double> cplx;
+
+/*In place iterative radix-2 FFT: a[m] = sum_j a[j] * e^(-2*pi*i*j*m/n), n a power of two*/
+static void FFT(std::vector<cplx>& a) {
+	size_t n = a.size();
+	for (size_t i = 1, j = 0; i < n; i++) { //bit reversal permutation
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap(a[i], a[j]);
+		}
+	}
+	for (size_t len = 2; len <= n; len <<= 1) {
+		double ang = -2.0 * PI / len;
+		cplx wlen(cos(ang), sin(ang));
+		for (size_t i = 0; i < n; i += len) {
+			cplx w(1.0, 0.0);
+			for (size_t j = 0; j < len / 2; j++) {
+				cplx u = a[i + j];
+				cplx v = a[i + j + len / 2] * w;
+				a[i + j] = u + v;
+				a[i + j + len / 2] = u - v;
+				w *= wlen;
+			}
+		}
+	}
+}
+
+/*CharacteristicFunction implementation*/
+void CharacteristicFunction::Cumulants(double T, double& c1, double& c2, double& c4) const {
+	//cumulant generating function K(t) = ln E[e^(tX)] = ln phi(-it), differentiated at t = 0
+	const double h = 1e-3;
+	double kp = log((*this)(cplx(0.0, -h), T).real());
+	double km = log((*this)(cplx(0.0, h), T).real());
+	c1 = (kp - km) / (2.0 * h); //K(0) = 0
+	c2 = std::max((kp + km) / (h * h), 1e-12);
+	c4 = 0.0;
+}
+
+/*BlackScholesCF implementation*/
+BlackScholesCF::BlackScholesCF(double p_sig, double p_b) : sig(p_sig), b(p_b) {}
+
+cplx BlackScholesCF::operator () (cplx u, double T) const {
+	cplx i(0.0, 1.0);
+	return exp(i * u * (b - 0.5 * sig * sig) * T - 0.5 * sig * sig * u * u * T);
+}
+
+void BlackScholesCF::Cumulants(double T, double& c1, double& c2, double& c4) const {
+	c1 = (b - 0.5 * sig * sig) * T;
+	c2 = sig * sig * T;
+	c4 = 0.0;
+}
+
+/*HestonCF implementation*/
+HestonCF::HestonCF(double p_b, double p_v0, double p_kappa, double p_theta, double p_xi, double p_rho)
+	: b(p_b), v0(p_v0), kappa(p_kappa), theta(p_theta), xi(p_xi), rho(p_rho) {}
+
+cplx HestonCF::operator () (cplx u, double T) const {
+	//formulation of Albrecher et al. which stays on the principal branch of the logarithm
+	cplx i(0.0, 1.0);
+	cplx beta = kappa - rho * xi * i * u;
+	cplx d = sqrt(beta * beta + xi * xi * (i * u + u * u));
+	cplx g = (beta - d) / (beta + d);
+	cplx edT = exp(-d * T);
+	cplx C = kappa * theta / (xi * xi) * ((beta - d) * T - 2.0 * log((1.0 - g * edT) / (1.0 - g)));
+	cplx D = (beta - d) / (xi * xi) * (1.0 - edT) / (1.0 - g * edT);
+	return exp(i * u * b * T + C + D * v0);
+}
+
+/*MertonCF implementation*/
+MertonCF::MertonCF(double p_sig, double p_b, double p_lambda, double p_muJ, double p_sigJ)
+	: sig(p_sig), b(p_b), lambda(p_lambda), muJ(p_muJ), sigJ(p_sigJ) {}
+
+cplx MertonCF::operator () (cplx u, double T) const {
+	cplx i(0.0, 1.0);
+	double k = exp(muJ + 0.5 * sigJ * sigJ) - 1.0; //mean relative jump, compensated in the drift
+	cplx jump = exp(i * u * muJ - 0.5 * sigJ * sigJ * u * u) - 1.0;
+	return exp(i * u * (b - 0.5 * sig * sig - lambda * k) * T - 0.5 * sig * sig * u * u * T + lambda * T * jump);
+}
+
+void MertonCF::Cumulants(double T, double& c1, double& c2, double& c4) const {
+	double k = exp(muJ + 0.5 * sigJ * sigJ) - 1.0;
+	double s2 = sigJ * sigJ;
+	c1 = (b - 0.5 * sig * sig - lambda * k + lambda * muJ) * T;
+	c2 = (sig * sig + lambda * (muJ * muJ + s2)) * T;
+	c4 = lambda * T * (muJ * muJ * muJ * muJ + 6.0 * s2 * muJ * muJ + 3.0 * s2 * s2);
+}
+
+/*FourierPricer implementation*/
+FourierPricer::FourierPricer(const CharacteristicFunction& p_cf, double p_rf) : cf(&p_cf), rf(p_rf) {
+	fft_points = 4096;
+	fft_eta = 0.25;
+	fft_alpha = 1.5;
+	cos_terms = 256;
+	cos_L = 10.0;
+}
+
+FourierPricer::~FourierPricer() {}
+
+void FourierPricer::FFTSettings(int points, double eta, double alpha) {
+	fft_points = 16;
+	while (fft_points < points) {
+		fft_points <<= 1; //rounds up to a power of two
+	}
+	fft_eta = eta;
+	fft_alpha = alpha;
+}
+
+void FourierPricer::COSSettings(int terms, double L) {
+	cos_terms = std::max(terms, 2);
+	cos_L = L;
+}
+
+double FourierPricer::Forward(double S, double T) const {
+	return S * (*cf)(cplx(0.0, -1.0), T).real();
+}
+
+void FourierPricer::PriceChainFFT(double S, double T, const std::vector<double>& K, std::vector<double>& calls, std::vector<double>& puts) const {
+	PRICER_PROBE("FourierPricer::PriceChainFFT");
+	const int N = fft_points;
+	const double eta = fft_eta;
+	const double alpha = fft_alpha;
+	const double lambda = 2.0 * PI / (N * eta); //log strike spacing
+	const double k0 = -0.5 * N * lambda; //first log strike, the grid is centered on k = ln(K/S) = 0
+	const double df = exp(-rf * T);
+	cplx i(0.0, 1.0);
+
+	//psi(v) is the transform of the damped call price per unit of spot, weighted for Simpson's rule
+	std::vector<cplx> x(N);
+	for (int j = 0; j < N; j++) {
+		double v = eta * j;
+		cplx psi = df * (*cf)(cplx(v, -(alpha + 1.0)), T) / cplx(alpha * alpha + alpha - v * v, (2.0 * alpha + 1.0) * v);
+		double w = (j == 0) ? 1.0 : ((j % 2 == 1) ? 4.0 : 2.0);
+		x[j] = exp(-i * v * k0) * psi * (eta * w / 3.0);
+	}
+	FFT(x);
+
+	calls.resize(K.size()); //allocates space
+	puts.resize(K.size());
+	double fwd_df = Forward(S, T) * df;
+	for (size_t m = 0; m < K.size(); m++) {
+		double k = log(K[m] / S);
+		//cubic Lagrange interpolation on the 4 grid points around k
+		double pos = (k - k0) / lambda;
+		int j = std::min(std::max((int)floor(pos) - 1, 0), N - 4);
+		double t = pos - j;
+		double c = 0.0;
+		for (int a = 0; a < 4; a++) {
+			double l = 1.0;
+			for (int q = 0; q < 4; q++) {
+				if (q != a) {
+					l *= (t - q) / (a - q);
+				}
+			}
+			double kj = k0 + lambda * (j + a);
+			c += l * exp(-alpha * kj) / PI * x[j + a].real();
+		}
+		calls[m] = S * c;
+		puts[m] = calls[m] - fwd_df + K[m] * df; //put-call parity
+	}
+}
+
+void FourierPricer::PriceChainCOS(double S, double T, const std::vector<double>& K, std::vector<double>& calls, std::vector<double>& puts) const {
+	PRICER_PROBE("FourierPricer::PriceChainCOS");
+	const int N = cos_terms;
+	double c1, c2, c4;
+	cf->Cumulants(T, c1, c2, c4);
+	//truncation range of X, shifted by ln(S/K) for every strike
+	double half = cos_L * sqrt(c2 + sqrt(c4));
+	double a0 = c1 - half;
+	double width = 2.0 * half;
+	const double df = exp(-rf * T);
+
+	//characteristic function terms, shared by all strikes: Re[phi(k*pi/width) * e^(-i*k*pi*a0/width)]
+	std::vector<double> phi(N);
+	for (int k = 0; k < N; k++) {
+		double w = k * PI / width;
+		phi[k] = ((*cf)(cplx(w, 0.0), T) * exp(cplx(0.0, -w * a0))).real();
+	}
+	phi[0] *= 0.5; //the first term of the cosine series has weight 1/2
+
+	calls.resize(K.size()); //allocates space
+	puts.resize(K.size());
+	double fwd_df = Forward(S, T) * df;
+	for (size_t m = 0; m < K.size(); m++) {
+		//y = ln(S_T/K) lies in [a, a + width]; the put pays K(1 - e^y) on [a, min(0, a + width)]
+		double a = log(S / K[m]) + a0;
+		double put = 0.0;
+		if (a < 0.0) {
+			double d = std::min(0.0, a + width);
+			double ed = exp(d), ea = exp(a);
+			//cos(k*theta) and sin(k*theta) by rotation, theta = pi*(d - a)/width
+			double theta = PI * (d - a) / width;
+			double cr = cos(theta), sr = sin(theta);
+			double ck = 1.0, sk = 0.0;
+			double sum = 0.0;
+			for (int k = 0; k < N; k++) {
+				double w = k * PI / width;
+				double chi = (ck * ed - ea + w * sk * ed) / (1.0 + w * w); //integral of e^y cos(w(y - a)) on [a, d]
+				double psi = (k == 0) ? d - a : sk / w; //integral of cos(w(y - a)) on [a, d]
+				sum += phi[k] * (psi - chi);
+				double cn = ck * cr - sk * sr;
+				sk = sk * cr + ck * sr;
+				ck = cn;
+			}
+			put = std::max(df * K[m] * 2.0 / width * sum, 0.0);
+		}
+		puts[m] = put;
+		calls[m] = put + fwd_df - K[m] * df; //put-call parity
+	}
+}
@@ -0,0 +1,113 @@
+/* Fourier option pricing */
+/*****************************************************
+Name: FourierPricer.hpp
+version: 0.1
+Description:
+Prices a whole chain of European strikes for one expiry from the characteristic function of the log return
+X = ln(S_T / S) under the pricing measure, instead of one Price call per strike.
+
+Two methods are provided:
+FFT (Carr-Madan): the damped call price c(k) = e^(alpha*k) * C(k) is Fourier transformed in the log strike
+k = ln(K/S), so a single radix-2 FFT of N points gives the calls on a grid of N log strikes (O(N log N)).
+The requested strikes are interpolated on that grid (cubic Lagrange), puts follow from put-call parity.
+COS (Fang-Oosterlee): the density of ln(S_T/K) is expanded in a cosine series on a truncation range
+[c1 - L*sqrt(c2 + sqrt(c4)), c1 + L*sqrt(c2 + sqrt(c4))] built from the cumulants c1, c2, c4 of X
+(closed form for Black-Scholes and Merton, read from the characteristic function for Heston).
+The N characteristic function values are computed once per chain and each strike is then O(N) without any
+transcendental function call. Puts are priced by the series and calls follow from put-call parity.
+
+Characteristic functions (all with cost of carry b, i.e. E[S_T] = S * e^(bT), discounting at rf):
+BlackScholesCF(sig, b) - validated against EuOptCall / EuOptPut
+HestonCF(b, v0, kappa, theta, xi, rho) - stochastic variance with mean reversion kappa to theta, vol of vol xi
+MertonCF(sig, b, lambda, muJ, sigJ) - lognormal jumps ln(1 + J) ~ N(muJ, sigJ^2) arriving at rate lambda
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef FOURIERPRICER_HPP
+#define FOURIERPRICER_HPP
+
+#include <complex>
+#include <vector>
+using namespace std;
+
+/*Characteristic function of X = ln(S_T / S)*/
+class CharacteristicFunction {
+public:
+	virtual ~CharacteristicFunction() {}
+	virtual std::complex<double> operator () (std::complex<double> u, double T) const = 0; //E[e^(iuX)]
+	virtual void Cumulants(double T, double& c1, double& c2, double& c4) const; //first, second and fourth cumulants of X, by default from finite differences of ln E[e^(tX)] with c4 = 0
+};
+
+class BlackScholesCF : public CharacteristicFunction {
+private:
+	double sig;
+	double b;
+
+public:
+	BlackScholesCF(double p_sig, double p_b);
+	std::complex<double> operator () (std::complex<double> u, double T) const;
+	void Cumulants(double T, double& c1, double& c2, double& c4) const;
+};
+
+class HestonCF : public CharacteristicFunction {
+private:
+	double b;
+	double v0; //initial variance
+	double kappa; //speed of mean reversion
+	double theta; //long run variance
+	double xi; //volatility of variance
+	double rho; //correlation between the asset and its variance
+
+public:
+	HestonCF(double p_b, double p_v0, double p_kappa, double p_theta, double p_xi, double p_rho);
+	std::complex<double> operator () (std::complex<double> u, double T) const;
+};
+
+class MertonCF : public CharacteristicFunction {
+private:
+	double sig; //diffusion volatility
+	double b;
+	double lambda; //jump intensity
+	double muJ; //mean of the log jump size
+	double sigJ; //volatility of the log jump size
+
+public:
+	MertonCF(double p_sig, double p_b, double p_lambda, double p_muJ, double p_sigJ);
+	std::complex<double> operator () (std::complex<double> u, double T) const;
+	void Cumulants(double T, double& c1, double& c2, double& c4) const;
+};
+
+class FourierPricer {
+private:
+	const CharacteristicFunction* cf; //not owned, must outlive the pricer
+	double rf;
+
+	/*FFT settings*/
+	int fft_points; //power of two
+	double fft_eta; //spacing of the integration grid
+	double fft_alpha; //damping factor
+
+	/*COS settings*/
+	int cos_terms;
+	double cos_L; //width of the truncation range in standard deviations
+
+	double Forward(double S, double T) const; //S * E[S_T/S] read from the characteristic function at u = -i
+
+public:
+	/*Constructor and destructor*/
+	FourierPricer(const CharacteristicFunction& p_cf, double p_rf);
+	virtual ~FourierPricer();
+
+	/*Settings*/
+	void FFTSettings(int points, double eta, double alpha);
+	void COSSettings(int terms, double L);
+
+	/*Chain pricing: calls and puts for every strike of K at spot S and expiry T*/
+	void PriceChainFFT(double S, double T, const std::vector<double>& K, std::vector<double>& calls, std::vector<double>& puts) const;
+	void PriceChainCOS(double S, double T, const std::vector<double>& K, std::vector<double>& calls, std::vector<double>& puts) const;
+};
+
+#endif
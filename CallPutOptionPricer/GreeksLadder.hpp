@@ -0,0 +1,68 @@
+/* Divided differences Greek ladders */
+/*****************************************************
+Name: GreeksLadder.hpp
+version: 0.1
+Description:
+GreeksLadderDDM(num, h, start_S, end_S, price, deltas, gammas) fills the divided differences delta and gamma of a
+price functor, price(S), on the mesh of num + 1 spots from start_S to end_S. Shared by the GreeksLadderDDM members
+of EuOptCall, EuOptPut, UsOptCall and UsOptPut.
+
+When h is a multiple k of the mesh size the grid is extended by k nodes on each side so that S-h and S+h are grid
+nodes and every node is priced exactly once (num + 1 + 2k evaluations instead of 5 per point); otherwise S-h, S and
+S+h are priced once per node and shared between delta and gamma.
+
+Change history:
+0.1 Initial version (moved out of the option classes)
+
+******************************************************/
+
+#ifndef GREEKSLADDER_HPP
+#define GREEKSLADDER_HPP
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+template <typename PriceFn>
+void GreeksLadderDDM(int num, double h, double start_S, double end_S, PriceFn price, std::vector<double>& deltas, std::vector<double>& gammas) {
+	//num equals the number of increments before reaching the end price end_S
+	if (num <= 0 || h <= 0.0) {
+		std::cout << "Invalid input. The number of increments and h must be positive" << std::endl;
+		deltas.clear();
+		gammas.clear();
+		return;
+	}
+	deltas.assign(num + 1, 0.0);
+	gammas.assign(num + 1, 0.0);
+	double mesh_size = (end_S - start_S) / num; //increment size of the mesh
+	double steps = (mesh_size != 0.0) ? h / std::fabs(mesh_size) : 0.0; //h expressed in mesh increments
+	int k = (int)std::floor(steps + 0.5);
+	if (k >= 1 && std::fabs(steps - k) <= 1e-9 * steps) {
+		//h aligns with the mesh: S-h and S+h are nodes of the extended grid
+		std::vector<double> prices(num + 1 + 2 * k);
+		for (int j = 0; j < (int)prices.size(); j++) {
+			prices[j] = price(start_S + (j - k)*mesh_size);
+		}
+		int up_shift = (mesh_size > 0.0) ? 2 * k : 0; //a decreasing mesh has S+h on the left of S
+		int down_shift = 2 * k - up_shift;
+		for (int i = 0; i <= num; i++) {
+			double up = prices[i + up_shift];
+			double mid = prices[i + k];
+			double down = prices[i + down_shift];
+			deltas[i] = (up - down) / (2.0 * h);
+			gammas[i] = (up - 2.0 * mid + down) / (h*h);
+		}
+	}
+	else {
+		for (int i = 0; i <= num; i++) {
+			double S = start_S + i*mesh_size;
+			double up = price(S + h);
+			double mid = price(S);
+			double down = price(S - h);
+			deltas[i] = (up - down) / (2.0 * h);
+			gammas[i] = (up - 2.0 * mid + down) / (h*h);
+		}
+	}
+}
+
+#endif
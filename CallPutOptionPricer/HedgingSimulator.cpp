@@ -0,0 +1,187 @@
+/* Delta hedging backtests implementation */
+/*****************************************************
+Name: HedgingSimulator.cpp
+version: 0.1
+Description:
+Implementation of the functions in HedgingSimulator.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "HedgingSimulator.hpp"
+#include "PricingKernels.hpp"
+#include "ParallelFor.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "boost/random.hpp"
+
+/*Settings and result implementation*/
+HedgeSettings::HedgeSettings() : paths(10000), steps(252), rebalance_every(1), delta_band(0.0), cost_rate(0.0), fixed_cost(0.0), mu(0.05),
+	realized_vol(0.0), seed(42), threads(0) {
+
+}
+
+std::string HedgeResult::ToString() const {
+	std::stringstream ss;
+	ss << "Premium: " << premium << "\nHedging error: mean " << mean << ", standard deviation " << std_dev << " (" << (premium > 0.0 ? std_dev / premium * 100.0 : 0.0)
+		<< "% of the premium)\nPercentiles: 1% " << p01 << ", 5% " << p05 << ", 50% " << p50 << ", 95% " << p95 << ", 99% " << p99
+		<< "\nExpected shortfall (5%): " << es95 << "\nTransaction costs: " << mean_cost << " per path, " << mean_trades << " trades per path\n"
+		<< errors.size() << " paths in " << seconds * 1000.0 << " ms" << endl;
+	return ss.str();
+}
+
+std::string HedgeResult::Histogram(int bins, int width) const {
+	std::stringstream ss;
+	if (errors.empty() || bins < 1 || p99 <= p01) {
+		return ss.str();
+	}
+	//bins between the 1% and 99% percentiles, the tails counted in the end bins
+	std::vector<size_t> count(bins, 0);
+	double step = (p99 - p01) / bins;
+	for (size_t i = 0; i < errors.size(); i++) {
+		int bin = (int)floor((errors[i] - p01) / step);
+		count[std::min(std::max(bin, 0), bins - 1)]++;
+	}
+	size_t top = *std::max_element(count.begin(), count.end());
+	for (int k = 0; k < bins; k++) {
+		ss.width(10);
+		ss << p01 + (k + 0.5) * step << " | " << std::string(top ? count[k] * width / top : 0, '#') << " " << count[k] << endl;
+	}
+	return ss.str();
+}
+
+/*Constructors and destructor implementation*/
+HedgingSimulator::HedgingSimulator(const EuOptCall& option) : rf(option.rate()), sig(option.sigma()), K(option.strike()), T(option.maturity()),
+	b(option.CostOfCarry()), call(true) {
+
+}
+
+HedgingSimulator::HedgingSimulator(const EuOptPut& option) : rf(option.rate()), sig(option.sigma()), K(option.strike()), T(option.maturity()),
+	b(option.CostOfCarry()), call(false) {
+
+}
+
+HedgingSimulator::~HedgingSimulator() {
+
+}
+
+/*Simulation implementation*/
+void HedgingSimulator::SimulateBlock(double S0, const HedgeSettings& settings, size_t block, size_t count, double* errors, double* costs, double& trades) const {
+	boost::mt19937 gen(settings.seed + 0x9E3779B9u * (unsigned int)(block + 1));
+	boost::normal_distribution<double> norm(0.0, 1.0);
+	boost::variate_generator< boost::mt19937&, boost::normal_distribution<double> > z(gen, norm);
+	const int steps = std::max(settings.steps, 1);
+	const int every = std::max(settings.rebalance_every, 1);
+	const double dt = T / steps;
+	const double vol = (settings.realized_vol > 0.0) ? settings.realized_vol : sig;
+	const double move = (settings.mu - 0.5 * vol * vol) * dt;
+	const double shock = vol * sqrt(dt);
+	const double growth = exp(rf * dt); //cash account over one step
+	const double yield = exp((rf - b) * dt) - 1.0; //income of a share over one step, per unit of spot
+	const double premium = PriceKernel<double>(call ? EU_CALL : EU_PUT, S0, K, T, sig, rf, b);
+
+	//state of the block, one entry per path
+	std::vector<double> S(count, S0), hedge(count), cash(count), cost(count, 0.0), target(count);
+	std::vector<unsigned int> n_trades(count, 0);
+	const double sqrtT = sqrt(T);
+	const double d1_0 = (log(S0 / K) + (b + 0.5 * sig * sig) * T) / (sig * sqrtT);
+	const double delta_0 = exp((b - rf) * T) * (call ? NormCdf(d1_0) : NormCdf(d1_0) - 1.0);
+	for (size_t p = 0; p < count; p++) {
+		hedge[p] = delta_0;
+		cost[p] = fabs(delta_0) * S0 * settings.cost_rate + settings.fixed_cost;
+		cash[p] = premium - delta_0 * S0 - cost[p];
+		n_trades[p] = 1;
+	}
+	for (int k = 1; k <= steps; k++) {
+		//spots and carry of the positions
+		for (size_t p = 0; p < count; p++) {
+			cash[p] = cash[p] * growth + hedge[p] * S[p] * yield;
+			S[p] *= exp(move + shock * z());
+		}
+		if (k == steps || k % every != 0) {
+			continue;
+		}
+		//deltas of the block with the factors of the remaining time computed once
+		double tau = T - k * dt;
+		double den = sig * sqrt(tau);
+		double drift = (b + 0.5 * sig * sig) * tau;
+		double carry = exp((b - rf) * tau);
+		double shift = call ? 0.0 : -1.0;
+		for (size_t p = 0; p < count; p++) {
+			target[p] = carry * (NormCdf((log(S[p] / K) + drift) / den) + shift);
+		}
+		double scale = exp(rf * k * dt); //costs are reported at t = 0
+		for (size_t p = 0; p < count; p++) {
+			double trade = target[p] - hedge[p];
+			if (fabs(trade) <= settings.delta_band || trade == 0.0) {
+				continue;
+			}
+			double c = fabs(trade) * S[p] * settings.cost_rate + settings.fixed_cost;
+			cash[p] -= trade * S[p] + c;
+			cost[p] += c / scale;
+			hedge[p] = target[p];
+			n_trades[p]++;
+		}
+	}
+	const double df = exp(-rf * T);
+	for (size_t p = 0; p < count; p++) {
+		double payoff = call ? std::max(S[p] - K, 0.0) : std::max(K - S[p], 0.0);
+		errors[p] = df * (cash[p] + hedge[p] * S[p] - payoff);
+		costs[p] = cost[p];
+		trades += n_trades[p];
+	}
+}
+
+HedgeResult HedgingSimulator::Run(double S, const HedgeSettings& settings) const {
+	PRICER_PROBE("HedgingSimulator::Run");
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	HedgeResult result = HedgeResult();
+	result.premium = PriceKernel<double>(call ? EU_CALL : EU_PUT, S, K, T, sig, rf, b);
+	size_t n = settings.paths;
+	if (n == 0) {
+		return result;
+	}
+	result.errors.resize(n);
+	result.costs.resize(n);
+	size_t blocks = (n + HEDGE_BLOCK - 1) / HEDGE_BLOCK;
+	std::vector<double> trades(blocks, 0.0);
+	ParallelFor(blocks, settings.threads, [&](size_t block) {
+		size_t begin = block * HEDGE_BLOCK;
+		size_t count = std::min(HEDGE_BLOCK, n - begin);
+		SimulateBlock(S, settings, block, count, &result.errors[begin], &result.costs[begin], trades[block]);
+	});
+
+	//distribution of the errors
+	double sum = 0.0, sum2 = 0.0, cost = 0.0, total_trades = 0.0;
+	for (size_t p = 0; p < n; p++) {
+		sum += result.errors[p];
+		sum2 += result.errors[p] * result.errors[p];
+		cost += result.costs[p];
+	}
+	for (size_t block = 0; block < blocks; block++) {
+		total_trades += trades[block];
+	}
+	result.mean = sum / n;
+	result.std_dev = (n > 1) ? sqrt(std::max((sum2 - n * result.mean * result.mean) / (n - 1), 0.0)) : 0.0;
+	result.mean_cost = cost / n;
+	result.mean_trades = total_trades / n;
+	std::vector<double> sorted(result.errors);
+	std::sort(sorted.begin(), sorted.end());
+	double q[5] = { 0.01, 0.05, 0.5, 0.95, 0.99 };
+	double* out[5] = { &result.p01, &result.p05, &result.p50, &result.p95, &result.p99 };
+	for (int i = 0; i < 5; i++) {
+		*out[i] = sorted[std::min((size_t)(q[i] * (n - 1) + 0.5), n - 1)];
+	}
+	size_t tail = std::max((size_t)(0.05 * n), (size_t)1);
+	double worst = 0.0;
+	for (size_t p = 0; p < tail; p++) {
+		worst += sorted[p];
+	}
+	result.es95 = worst / tail;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	return result;
+}
@@ -0,0 +1,88 @@
+/* Delta hedging backtests */
+/*****************************************************
+Name: HedgingSimulator.hpp
+version: 0.1
+Description:
+Simulates the delta hedge of a sold European option (EuOptCall / EuOptPut) over many paths of the underlying and
+reports the distribution of the hedging error.
+
+The option is sold at its Black-Scholes price and hedged with the Black-Scholes delta at the pricing volatility;
+the underlying follows a geometric Brownian motion with the drift mu and the realized volatility of the settings
+(under the physical measure, both can differ from the pricing parameters). At every rebalancing date the hedge is
+moved to the current delta, paying cost_rate times the traded notional plus fixed_cost per trade; in between the
+cash accrues at rf and the shares earn the yield rf - b. The hedging error of a path is the value at expiry of the
+cash, the shares and the sold payoff, discounted at rf: 0 for a perfect continuous hedge without costs.
+
+Schedules: the hedge is reviewed every rebalance_every steps and moved when the delta drifted by more than
+delta_band since the last trade (0 moves it at every review).
+
+The paths are simulated in blocks of HEDGE_BLOCK paths stepped together: at every step the spots of the block are
+updated and the deltas recomputed in one loop over the block, with the time dependent factors of d1 and the carry
+discount computed once per step. Each block has its own generator seeded from the seed and the block number and
+writes its own range of the results, so the results do not depend on the number of threads.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef HEDGINGSIMULATOR_HPP
+#define HEDGINGSIMULATOR_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "EUOptionCall.hpp"
+#include "EUOptionPut.hpp"
+using namespace std;
+
+const size_t HEDGE_BLOCK = 256;
+
+struct HedgeSettings {
+	size_t paths;
+	int steps; //time steps to expiry
+	int rebalance_every; //steps between two reviews of the hedge
+	double delta_band; //trades only when the delta moved by more than this, 0 trades at every review
+	double cost_rate; //proportional cost, fraction of the traded notional
+	double fixed_cost; //cost per trade
+	double mu; //drift of the underlying (physical measure)
+	double realized_vol; //volatility of the underlying, <= 0 uses the pricing volatility
+	unsigned int seed;
+	int threads; //0 uses the hardware concurrency
+
+	HedgeSettings();
+};
+
+struct HedgeResult {
+	std::vector<double> errors; //hedging error of every path, in path order
+	std::vector<double> costs; //transaction costs of every path (discounted)
+	double premium; //price received for the option
+	double mean, std_dev;
+	double p01, p05, p50, p95, p99; //percentiles of the error
+	double es95; //mean of the worst 5% errors
+	double mean_cost;
+	double mean_trades; //trades per path
+	double seconds;
+
+	std::string ToString() const;
+	std::string Histogram(int bins = 20, int width = 50) const;
+};
+
+class HedgingSimulator {
+private:
+	double rf, sig, K, T, b;
+	bool call;
+
+	void SimulateBlock(double S, const HedgeSettings& settings, size_t block, size_t count, double* errors, double* costs, double& trades) const;
+
+public:
+	/*Constructors and destructor*/
+	HedgingSimulator(const EuOptCall& option);
+	HedgingSimulator(const EuOptPut& option);
+	virtual ~HedgingSimulator();
+
+	/*Runs the backtest from the spot S*/
+	HedgeResult Run(double S, const HedgeSettings& settings = HedgeSettings()) const;
+};
+
+#endif
@@ -0,0 +1,324 @@
+/* Hot path instrumentation implementation */
+/*****************************************************
+Name: Instrumentation.cpp
+version: 0.2
+Description:
+Implementation of the functions in Instrumentation.hpp
+
+Change history:
+0.1 Initial version
+0.2 ResetInstrumentation bumps an epoch instead of clearing live histograms, each thread clears its own
+
+******************************************************/
+
+#include "Instrumentation.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*Histogram layout: 64 powers of two with 16 linear sub-buckets each*/
+static const int SUB_BITS = 4;
+static const int SUB_BUCKETS = 1 << SUB_BITS;
+static const int BUCKETS = 64 * SUB_BUCKETS;
+static const int MAX_PROBES = 128;
+
+static int BucketIndex(unsigned long long v) {
+	if (v < (unsigned long long)SUB_BUCKETS) {
+		return (int)v; //values below 16 ticks are recorded exactly
+	}
+	int msb = 63;
+	while (!(v >> msb)) {
+		msb--;
+	}
+	int shift = msb - SUB_BITS;
+	return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+}
+
+static unsigned long long BucketValue(int index) { //midpoint of the bucket
+	if (index < SUB_BUCKETS) {
+		return (unsigned long long)index;
+	}
+	int shift = index / SUB_BUCKETS - 1;
+	unsigned long long low = ((unsigned long long)(SUB_BUCKETS + index % SUB_BUCKETS)) << shift;
+	return low + ((1ULL << shift) >> 1);
+}
+
+/*Samples of one probe on one thread. Only the owner thread writes, so relaxed load/store pairs suffice*/
+struct ProbeHistogram {
+	std::atomic<unsigned long long> counts[BUCKETS];
+	std::atomic<unsigned long long> total;
+	std::atomic<unsigned long long> sum;
+	std::atomic<unsigned long long> max;
+
+	ProbeHistogram() {
+		Clear();
+	}
+
+	void Clear() {
+		for (int i = 0; i < BUCKETS; i++) {
+			counts[i].store(0, std::memory_order_relaxed);
+		}
+		total.store(0, std::memory_order_relaxed);
+		sum.store(0, std::memory_order_relaxed);
+		max.store(0, std::memory_order_relaxed);
+	}
+
+	void Record(unsigned long long v) {
+		std::atomic<unsigned long long>& c = counts[BucketIndex(v)];
+		c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		sum.store(sum.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+		if (v > max.load(std::memory_order_relaxed)) {
+			max.store(v, std::memory_order_relaxed);
+		}
+	}
+
+	void Merge(const ProbeHistogram& other) { //under the registry lock
+		for (int i = 0; i < BUCKETS; i++) {
+			counts[i].store(counts[i].load(std::memory_order_relaxed) + other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		total.store(total.load(std::memory_order_relaxed) + other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		sum.store(sum.load(std::memory_order_relaxed) + other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		if (other.max.load(std::memory_order_relaxed) > max.load(std::memory_order_relaxed)) {
+			max.store(other.max.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	}
+};
+
+/*Histograms of one thread, allocated on the first sample of each probe. epoch is the reset generation the
+histograms belong to: only the owner clears them, when it sees that ResetInstrumentation moved the epoch on*/
+struct ThreadProbes {
+	std::atomic<ProbeHistogram*> probes[MAX_PROBES];
+	std::atomic<unsigned long long> epoch;
+
+	ThreadProbes(unsigned long long p_epoch) {
+		for (int i = 0; i < MAX_PROBES; i++) {
+			probes[i].store(0, std::memory_order_relaxed);
+		}
+		epoch.store(p_epoch, std::memory_order_relaxed);
+	}
+
+	void Clear() { //owner thread only
+		for (int i = 0; i < MAX_PROBES; i++) {
+			ProbeHistogram* h = probes[i].load(std::memory_order_relaxed);
+			if (h != 0) {
+				h->Clear();
+			}
+		}
+	}
+};
+
+/*Registry of probe names and thread histograms. When a thread exits its samples are added to the per-probe totals
+and its histograms are cleared and handed to the next new thread, so short-lived workers (ParallelFor) do not grow
+the registry*/
+struct ProbeRegistry {
+	std::mutex lock;
+	std::vector<std::string> names;
+	std::vector<ThreadProbes*> threads; //every slot ever allocated, live or free
+	std::vector<ThreadProbes*> free_slots;
+	ProbeHistogram* totals[MAX_PROBES]; //samples of the exited threads
+	unsigned long long exited[MAX_PROBES]; //exited threads that recorded the probe
+	std::atomic<unsigned long long> epoch; //bumped by ResetInstrumentation, histograms of an older epoch are ignored
+
+	ProbeRegistry() : epoch(0) {
+		for (int i = 0; i < MAX_PROBES; i++) {
+			totals[i] = 0;
+			exited[i] = 0;
+		}
+	}
+};
+
+static ProbeRegistry& Registry() {
+	static ProbeRegistry* registry = new ProbeRegistry(); //never destroyed: probes may fire during static destruction
+	return *registry;
+}
+
+int RegisterProbe(const char* name) {
+	ProbeRegistry& r = Registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	for (size_t i = 0; i < r.names.size(); i++) {
+		if (r.names[i] == name) {
+			return (int)i;
+		}
+	}
+	if ((int)r.names.size() == MAX_PROBES) {
+		return -1;
+	}
+	r.names.push_back(name);
+	return (int)r.names.size() - 1;
+}
+
+/*Moves the samples of an exiting thread to the totals and frees its slot*/
+static void RetireProbes(ThreadProbes* local) {
+	ProbeRegistry& r = Registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	bool current = local->epoch.load(std::memory_order_relaxed) == r.epoch.load(std::memory_order_relaxed);
+	for (int p = 0; p < MAX_PROBES; p++) {
+		ProbeHistogram* h = local->probes[p].load(std::memory_order_acquire);
+		if (h == 0 || h->total.load(std::memory_order_relaxed) == 0) {
+			continue;
+		}
+		if (!current) { //samples taken before the last reset
+			h->Clear();
+			continue;
+		}
+		if (r.totals[p] == 0) {
+			r.totals[p] = new ProbeHistogram();
+		}
+		r.totals[p]->Merge(*h);
+		r.exited[p]++;
+		h->Clear();
+	}
+	r.free_slots.push_back(local);
+}
+
+/*Slot of the calling thread, taken on its first sample and retired at thread exit*/
+struct LocalSlot {
+	ThreadProbes* probes;
+
+	LocalSlot() : probes(0) {}
+	~LocalSlot() {
+		if (probes != 0) {
+			RetireProbes(probes);
+			probes = 0;
+		}
+	}
+};
+
+static ThreadProbes* LocalProbes() {
+	static thread_local LocalSlot local;
+	if (local.probes == 0) {
+		ProbeRegistry& r = Registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		if (!r.free_slots.empty()) {
+			local.probes = r.free_slots.back();
+			r.free_slots.pop_back();
+		}
+		else {
+			local.probes = new ThreadProbes(r.epoch.load(std::memory_order_relaxed));
+			r.threads.push_back(local.probes);
+		}
+	}
+	return local.probes;
+}
+
+void RecordProbe(int id, unsigned long long ticks) {
+	if (id < 0) {
+		return;
+	}
+	ThreadProbes* local = LocalProbes();
+	unsigned long long epoch = Registry().epoch.load(std::memory_order_acquire);
+	if (local->epoch.load(std::memory_order_relaxed) != epoch) { //reset since the last sample: start over
+		local->Clear();
+		local->epoch.store(epoch, std::memory_order_release); //published after the clear, for the reports
+	}
+	ProbeHistogram* h = local->probes[id].load(std::memory_order_relaxed);
+	if (h == 0) {
+		h = new ProbeHistogram();
+		local->probes[id].store(h, std::memory_order_release);
+	}
+	h->Record(ticks);
+}
+
+/*Conversion of timer ticks to nanoseconds, measured once against steady_clock*/
+static double MeasureNanosecondsPerTick() {
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	unsigned long long c0 = ReadTimer();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	unsigned long long c1 = ReadTimer();
+	double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+	return (c1 > c0) ? ns / (double)(c1 - c0) : 1.0;
+}
+
+static double NanosecondsPerTick() {
+	static const double ns_per_tick = MeasureNanosecondsPerTick(); //thread-safe initialization
+	return ns_per_tick;
+}
+
+static double Percentile(const std::vector<unsigned long long>& counts, unsigned long long total, double q) {
+	unsigned long long rank = (unsigned long long)(q * (double)total);
+	if (rank >= total) {
+		rank = total - 1;
+	}
+	unsigned long long seen = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		seen += counts[i];
+		if (seen > rank) {
+			return (double)BucketValue(i);
+		}
+	}
+	return 0.0;
+}
+
+/*Reporting implementation*/
+void DumpInstrumentationJSON(std::ostream& os) {
+	double scale = NanosecondsPerTick();
+	ProbeRegistry& r = Registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	os << "{\n  \"enabled\": " << (PRICER_INSTRUMENTATION ? "true" : "false") << ",\n  \"ns_per_tick\": " << scale << ",\n  \"probes\": [";
+	bool first = true;
+	for (size_t p = 0; p < r.names.size(); p++) {
+		//merge the histograms of every thread
+		std::vector<unsigned long long> counts(BUCKETS, 0);
+		unsigned long long total = 0, sum = 0, max = 0;
+		unsigned long long threads = r.exited[p];
+		unsigned long long epoch = r.epoch.load(std::memory_order_relaxed);
+		for (size_t t = 0; t <= r.threads.size(); t++) {
+			//live threads still holding samples of an older epoch are skipped, then the totals of the exited ones
+			if (t < r.threads.size() && r.threads[t]->epoch.load(std::memory_order_acquire) != epoch) {
+				continue;
+			}
+			ProbeHistogram* h = (t < r.threads.size()) ? r.threads[t]->probes[p].load(std::memory_order_acquire) : r.totals[p];
+			if (h == 0 || h->total.load(std::memory_order_relaxed) == 0) {
+				continue;
+			}
+			if (t < r.threads.size()) {
+				threads++;
+			}
+			for (int i = 0; i < BUCKETS; i++) {
+				counts[i] += h->counts[i].load(std::memory_order_relaxed);
+			}
+			total += h->total.load(std::memory_order_relaxed);
+			sum += h->sum.load(std::memory_order_relaxed);
+			if (h->max.load(std::memory_order_relaxed) > max) {
+				max = h->max.load(std::memory_order_relaxed);
+			}
+		}
+		if (total == 0) {
+			continue;
+		}
+		os << (first ? "\n" : ",\n") << "    {\"name\": \"" << r.names[p] << "\", \"count\": " << total << ", \"threads\": " << threads
+			<< ", \"mean_ns\": " << scale * (double)sum / (double)total
+			<< ", \"p50_ns\": " << scale * Percentile(counts, total, 0.50)
+			<< ", \"p99_ns\": " << scale * Percentile(counts, total, 0.99)
+			<< ", \"p999_ns\": " << scale * Percentile(counts, total, 0.999)
+			<< ", \"max_ns\": " << scale * (double)max << "}";
+		first = false;
+	}
+	os << "\n  ]\n}\n";
+}
+
+bool DumpInstrumentationJSON(const std::string& path) {
+	std::ofstream file(path.c_str());
+	if (!file) {
+		return false;
+	}
+	DumpInstrumentationJSON(file);
+	return true;
+}
+
+void ResetInstrumentation() {
+	ProbeRegistry& r = Registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	r.epoch.fetch_add(1, std::memory_order_release); //live histograms are only written by their owners, which clear them on their next sample
+	for (int p = 0; p < MAX_PROBES; p++) {
+		if (r.totals[p] != 0) {
+			r.totals[p]->Clear();
+		}
+		r.exited[p] = 0;
+	}
+}
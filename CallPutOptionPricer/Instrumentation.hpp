@@ -0,0 +1,87 @@
+/* Hot path instrumentation */
+/*****************************************************
+Name: Instrumentation.hpp
+version: 0.2
+Description:
+Lightweight timing probes for the pricing entry points and the batch engines.
+
+Instrumentation is switched at compile time: build with PRICER_INSTRUMENTATION=1 to enable it.
+When it is 0 (the default) PRICER_PROBE expands to nothing and the pricers are compiled exactly as before.
+
+PRICER_PROBE("name") placed at the top of a function times the enclosing scope with the time stamp counter
+(RDTSC on x86, steady_clock elsewhere) and records the latency in a per-thread histogram, so the hot path never
+takes a lock or touches memory written by another thread. The histograms use HdrHistogram-style log-linear buckets:
+16 linear sub-buckets per power of two, i.e. a relative resolution of about 6%.
+
+When a thread exits its histograms are added to per-probe totals and reused by the next thread, so the memory
+stays bounded by the number of threads alive at once.
+
+DumpInstrumentationJSON merges the per-thread histograms and writes count, mean, p50, p99, p99.9 and max in
+nanoseconds for every probe.
+
+ResetInstrumentation starts a new epoch: each thread clears its own histograms on its next sample and the reports
+ignore the histograms of older epochs, so a reset never writes to a histogram another thread is recording into.
+
+Change history:
+0.1 Initial version
+0.2 Epoch based ResetInstrumentation, safe while probes are recording
+
+******************************************************/
+
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <ostream>
+#include <string>
+
+#ifndef PRICER_INSTRUMENTATION
+#define PRICER_INSTRUMENTATION 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/*Time stamp counter*/
+inline unsigned long long ReadTimer() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*Probe registration and recording*/
+int RegisterProbe(const char* name); //returns the id of the probe with this name, registering it if needed
+void RecordProbe(int id, unsigned long long ticks); //adds a latency sample to the calling thread's histogram
+
+/*Times the scope it is declared in*/
+class ScopedProbe {
+private:
+	int m_id;
+	unsigned long long m_start;
+
+	ScopedProbe(const ScopedProbe& source);
+	ScopedProbe& operator = (const ScopedProbe& source);
+
+public:
+	explicit ScopedProbe(int id) : m_id(id), m_start(ReadTimer()) {}
+	~ScopedProbe() { RecordProbe(m_id, ReadTimer() - m_start); }
+};
+
+#if PRICER_INSTRUMENTATION
+#define PRICER_PROBE(name) static const int pricer_probe_id = RegisterProbe(name); ScopedProbe pricer_scoped_probe(pricer_probe_id)
+#else
+#define PRICER_PROBE(name) ((void)0)
+#endif
+
+/*Reporting*/
+void DumpInstrumentationJSON(std::ostream& os); //latency summary of every probe in JSON
+bool DumpInstrumentationJSON(const std::string& path);
+void ResetInstrumentation(); //drops the samples of every thread (the probes stay registered), safe while probes are live
+
+#endif
@@ -0,0 +1,158 @@
+/* Lookback options implementation */
+/*****************************************************
+Name: LookbackOption.cpp
+version: 0.1
+Description:
+Implementation of the functions in LookbackOption.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "LookbackOption.hpp"
+#include "Instrumentation.hpp"
+#include "PricingKernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const double LOOKBACK_MIN_CARRY = 1e-7; //|b| below this is taken as this carry
+
+/*Constructors and destructor implementation*/
+LookbackOption::LookbackOption() : rf(0.08), sig(0.30), K(65), T(0.25), b(0.08), fixings(63), call(true), floating(true) {
+
+}
+
+LookbackOption::LookbackOption(double p_rf, double p_sig, double p_K, double p_T, double p_b, int p_fixings, bool p_call, bool p_floating)
+	: rf(p_rf), sig(p_sig), K(p_K), T(p_T), b(p_b), fixings(std::max(p_fixings, 1)), call(p_call), floating(p_floating) {
+
+}
+
+LookbackOption::LookbackOption(OptionData& data, int p_fixings, bool p_call, bool p_floating)
+	: rf(data.rf), sig(data.sig), K(data.K), T(data.T), b(data.b), fixings(std::max(p_fixings, 1)), call(p_call), floating(p_floating) {
+
+}
+
+LookbackOption::~LookbackOption() {
+
+}
+
+/*Member functions to retrieve and set the data implementation*/
+int LookbackOption::FixingCount() const {
+	return fixings;
+}
+
+void LookbackOption::FixingCount(int new_fixings) {
+	if (new_fixings < 1) {
+		cout << "Invalid input. A lookback option needs at least one fixing" << endl;
+		return;
+	}
+	fixings = new_fixings;
+}
+
+bool LookbackOption::IsCall() const {
+	return call;
+}
+
+bool LookbackOption::IsFloating() const {
+	return floating;
+}
+
+/*Pricers implementation*/
+double LookbackOption::Continuous(double S, double strike) const {
+	double carry = (fabs(b) < LOOKBACK_MIN_CARRY) ? ((b < 0.0) ? -LOOKBACK_MIN_CARRY : LOOKBACK_MIN_CARRY) : b;
+	double sqrtT = sqrt(T);
+	double den = sig * sqrtT;
+	double df = exp(-rf * T);
+	double fwd = S * exp((carry - rf) * T); //discounted forward
+	double lambda = sig * sig / (2.0 * carry);
+	double shift = 2.0 * carry * sqrtT / sig;
+	double growth = exp(carry * T);
+	if (floating) {
+		//extremes observed from inception: min = max = S
+		double a1 = (carry + 0.5 * sig * sig) * T / den;
+		double a2 = a1 - den;
+		if (call) {
+			return fwd * NormCdf(a1) - S * df * NormCdf(a2) + S * df * lambda * (NormCdf(-a1 + shift) - growth * NormCdf(-a1));
+		}
+		return S * df * NormCdf(-a2) - fwd * NormCdf(-a1) + S * df * lambda * (-NormCdf(a1 - shift) + growth * NormCdf(a1));
+	}
+	if (call) { //the running maximum is above X = max(K, S)
+		double X = std::max(strike, S);
+		double d1 = (log(S / X) + (carry + 0.5 * sig * sig) * T) / den;
+		double d2 = d1 - den;
+		return df * std::max(S - strike, 0.0) + fwd * NormCdf(d1) - X * df * NormCdf(d2)
+			+ S * df * lambda * (-pow(S / X, -1.0 / lambda) * NormCdf(d1 - shift) + growth * NormCdf(d1));
+	}
+	double Y = std::min(strike, S); //the running minimum is below Y = min(K, S)
+	double d1 = (log(S / Y) + (carry + 0.5 * sig * sig) * T) / den;
+	double d2 = d1 - den;
+	return df * std::max(strike - S, 0.0) + Y * df * NormCdf(-d2) - fwd * NormCdf(-d1)
+		+ S * df * lambda * (pow(S / Y, -1.0 / lambda) * NormCdf(-d1 + shift) - growth * NormCdf(-d1));
+}
+
+double LookbackOption::ContinuousPrice(double S) const {
+	PRICER_PROBE("LookbackOption::ContinuousPrice");
+	return Continuous(S, K);
+}
+
+double LookbackOption::DiscretePrice(double S) const {
+	PRICER_PROBE("LookbackOption::DiscretePrice");
+	double a = LOOKBACK_BGK_BETA * sig * sqrt(T / fixings);
+	double fwd = S * exp((b - rf) * T); //value of S(T)
+	if (floating) { //value of the discounted extreme, shifted
+		if (call) {
+			return fwd - exp(a) * (fwd - Continuous(S, K));
+		}
+		return exp(-a) * (Continuous(S, K) + fwd) - fwd;
+	}
+	if (call) { //(e^(-a) max - K)+ = e^(-a) (max - K e^a)+
+		return exp(-a) * Continuous(S, K * exp(a));
+	}
+	return exp(a) * Continuous(S, K * exp(-a)); //(K - e^a min)+ = e^a (K e^(-a) - min)+
+}
+
+MonteCarloResult LookbackOption::Price(double S, const MonteCarloSettings& settings) const {
+	PRICER_PROBE("LookbackOption::Price");
+	PathModel model = { S, T, sig, rf, b, fixings };
+	const double df = exp(-rf * T);
+	const double strike = K;
+	const bool is_call = call;
+	const bool is_floating = floating;
+	double control_mean = 0.0;
+	if (floating) {
+		control_mean = S * exp((b - rf) * T);
+	}
+	else {
+		control_mean = call ? EuCallKernel(S, K, T, sig, rf, b) : EuPutKernel(S, K, T, sig, rf, b);
+	}
+	return SimulateGBM(model, control_mean, settings, [=](const double* path, int n, double& y, double& x) {
+		double lo = path[0], hi = path[0];
+		for (int i = 1; i <= n; i++) {
+			lo = std::min(lo, path[i]);
+			hi = std::max(hi, path[i]);
+		}
+		double ST = path[n];
+		if (is_floating) {
+			y = df * (is_call ? ST - lo : hi - ST);
+			x = df * ST;
+		}
+		else if (is_call) {
+			y = df * std::max(hi - strike, 0.0);
+			x = df * std::max(ST - strike, 0.0);
+		}
+		else {
+			y = df * std::max(strike - lo, 0.0);
+			x = df * std::max(strike - ST, 0.0);
+		}
+	});
+}
+
+/*Printing functions implementation*/
+std::string LookbackOption::ToString() const {
+	std::stringstream ss;
+	ss << "********** " << (floating ? "FLOATING" : "FIXED") << " STRIKE LOOKBACK " << (call ? "CALL" : "PUT") << " OPTION PARAMETERS **********\n"
+		<< "T: " << T << "\nK: " << K << "\nrf: " << rf << "\nsig: " << sig << "\nb: " << b << "\nFixings: " << fixings << endl;
+	return ss.str();
+}
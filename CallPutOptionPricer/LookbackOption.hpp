@@ -0,0 +1,71 @@
+/* Lookback options */
+/*****************************************************
+Name: LookbackOption.hpp
+version: 0.1
+Description:
+European options on the extremes of the underlying observed from inception (t = 0, where min = max = S) to the
+expiry T, in the generalized Black-Scholes setting of EuOptCall / EuOptPut (risk-free rate rf, cost of carry b).
+	floating strike call: S(T) - min, floating strike put: max - S(T)
+	fixed strike call: max(max - K, 0), fixed strike put: max(K - min, 0)
+
+ContinuousPrice is the closed form for a continuously observed path (Goldman, Sosin and Gatto for the floating
+strike, Conze and Viswanathan for the fixed strike, both with carry b; b = 0 is taken as a tiny carry, the limit
+being finite).
+DiscretePrice shifts the continuous extremes by the correction of Broadie, Glasserman and Kou for n fixings,
+max_discrete ~ max_continuous * e^(-beta sig sqrt(T/n)) and min_discrete ~ min_continuous * e^(beta sig sqrt(T/n)),
+beta = 0.5826: a fast approximation of the price with n fixings.
+Price simulates the n fixings t_i = i*T/n (MonteCarlo.hpp) with the European payoff at T as control variate:
+the vanilla call or put of the same strike for the fixed strike options, the discounted S(T) (worth S e^((b-r)T))
+for the floating strike ones.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef LOOKBACKOPTION_HPP
+#define LOOKBACKOPTION_HPP
+
+#include <string>
+#include <sstream>
+#include "OptionData.hpp"
+#include "MonteCarlo.hpp"
+
+const double LOOKBACK_BGK_BETA = 0.5825971579390106; //-zeta(1/2)/sqrt(2 pi)
+
+class LookbackOption {
+private:
+	double rf; //risk-free interest rate
+	double sig; //volatility
+	double K; //strike price, ignored by the floating strike options
+	double T; //expiry time/maturity expressed in years
+	double b; //cost of carry
+	int fixings; //number of observation dates after inception
+	bool call;
+	bool floating; //floating strike (true) or fixed strike
+
+	double Continuous(double S, double strike) const; //closed form with the given strike
+
+public:
+	/*Constructors and destructor*/
+	LookbackOption();
+	LookbackOption(double p_rf, double p_sig, double p_K, double p_T, double p_b, int p_fixings, bool p_call = true, bool p_floating = true);
+	LookbackOption(OptionData& data, int p_fixings, bool p_call = true, bool p_floating = true);
+	virtual ~LookbackOption();
+
+	/*Member functions to retrieve and set the data*/
+	int FixingCount() const;
+	void FixingCount(int new_fixings);
+	bool IsCall() const;
+	bool IsFloating() const;
+
+	/*Pricers*/
+	double ContinuousPrice(double S) const; //continuous observation
+	double DiscretePrice(double S) const; //n fixings, continuity correction
+	MonteCarloResult Price(double S, const MonteCarloSettings& settings = MonteCarloSettings()) const; //n fixings, European control variate
+
+	/*Printing functions*/
+	virtual std::string ToString() const;
+};
+
+#endif
@@ -0,0 +1,325 @@
+/* Market data driven repricing implementation */
+/*****************************************************
+Name: MarketDataFeed.cpp
+version: 0.2
+Description:
+Implementation of the functions in MarketDataFeed.hpp
+
+Change history:
+0.1 Initial version
+0.2 Repricing one underlying at a time with a drain in between, per worker price arrays, spinning idle workers
+
+******************************************************/
+
+#include "MarketDataFeed.hpp"
+#include "PricingKernels.hpp"
+#include "Instrumentation.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+
+static const double MIN_VOL = 1e-4; //floor of the shifted volatility
+static const int SPIN_LIMIT = 4096; //empty polls of an idle worker before it yields its CPU
+
+/*Hint to the CPU that the thread is spinning*/
+static inline void CpuRelax() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#endif
+}
+
+/*FeedStats implementation*/
+std::string FeedStats::ToString() const {
+	std::stringstream ss;
+	ss << "Updates: " << updates << "\nUnderlyings repriced: " << repricings << " (" << (updates - repricings) << " updates coalesced)"
+		<< "\nContracts repriced: " << contracts << "\nDropped: " << dropped
+		<< "\nTick-to-price latency: p50 " << latency_p50 << " us, p99 " << latency_p99 << " us, max " << latency_max << " us" << endl;
+	return ss.str();
+}
+
+/*Constructor and destructor*/
+MarketDataFeed::MarketDataFeed(const OptionBook& p_book, int p_workers, size_t queue_capacity, size_t latency_samples)
+	: book(p_book), running(false), dropped(0), pin(false) {
+	//contracts of every underlying (counting sort on the underlying index)
+	size_t underlyings = book.UnderlyingCount();
+	for (size_t i = 0; i < book.size(); i++) {
+		underlyings = std::max(underlyings, (size_t)book[i].underlying + 1);
+	}
+	offsets.assign(underlyings + 1, 0);
+	for (size_t i = 0; i < book.size(); i++) {
+		offsets[book[i].underlying + 1]++;
+	}
+	for (size_t u = 0; u < underlyings; u++) {
+		offsets[u + 1] += offsets[u];
+	}
+	members.resize(book.size());
+	std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < book.size(); i++) {
+		members[fill[book[i].underlying]++] = i;
+	}
+	prices.resize(book.size());
+
+	size_t n = (p_workers > 0) ? (size_t)p_workers : 1;
+	for (size_t w = 0; w < n; w++) {
+		Worker* worker = new Worker(queue_capacity);
+		size_t owned = (underlyings + n - 1) / n;
+		worker->latest.resize(owned);
+		worker->is_dirty.assign(owned, 0);
+		worker->dirty.resize(owned > 0 ? owned : 1);
+		worker->first.assign(owned + 1, 0);
+		for (size_t slot = 0; slot < owned; slot++) {
+			size_t u = slot * n + w;
+			size_t count = (u < underlyings) ? offsets[u + 1] - offsets[u] : 0;
+			worker->first[slot + 1] = worker->first[slot] + count;
+		}
+		worker->values.resize(worker->first[owned]);
+		worker->latency.resize(latency_samples);
+		workers.push_back(worker);
+	}
+}
+
+MarketDataFeed::~MarketDataFeed() {
+	Stop();
+	for (size_t w = 0; w < workers.size(); w++) {
+		delete workers[w];
+	}
+}
+
+/*Control*/
+long long MarketDataFeed::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void MarketDataFeed::Start(bool p_pin) {
+	if (running) {
+		return;
+	}
+	for (size_t i = 0; i < book.size(); i++) {
+		const OptionContract& c = book[i];
+		prices[i] = PriceKernel<double>(c.type, c.S, c.K, c.T, c.sig, c.rf, c.b);
+	}
+	size_t n = workers.size();
+	for (size_t u = 0; u + 1 < offsets.size(); u++) {
+		Worker& worker = *workers[u % n];
+		size_t at = worker.first[u / n];
+		for (size_t m = offsets[u]; m < offsets[u + 1]; m++) {
+			worker.values[at++] = prices[members[m]];
+		}
+	}
+	pin = p_pin;
+	running = true;
+	for (size_t w = 0; w < workers.size(); w++) {
+		threads.push_back(std::thread(&MarketDataFeed::Run, this, w));
+	}
+}
+
+void MarketDataFeed::Stop() {
+	running = false;
+	if (threads.empty()) {
+		return;
+	}
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+	threads.clear();
+	size_t n = workers.size();
+	for (size_t u = 0; u + 1 < offsets.size(); u++) {
+		const Worker& worker = *workers[u % n];
+		size_t at = worker.first[u / n];
+		for (size_t m = offsets[u]; m < offsets[u + 1]; m++) {
+			prices[members[m]] = worker.values[at++];
+		}
+	}
+}
+
+bool MarketDataFeed::Publish(const MarketUpdate& update) {
+	if (update.underlying + 1 >= offsets.size()) {
+		return false;
+	}
+	MarketUpdate stamped = update;
+	stamped.stamp = Now();
+	if (!workers[update.underlying % workers.size()]->queue.TryPush(stamped)) {
+		dropped++;
+		return false;
+	}
+	return true;
+}
+
+/*Workers*/
+size_t MarketDataFeed::Drain(Worker& worker) {
+	size_t n = workers.size();
+	MarketUpdate update;
+	size_t got = 0;
+	while (worker.queue.TryPop(update)) {
+		size_t slot = update.underlying / n;
+		if (!worker.is_dirty[slot]) {
+			worker.is_dirty[slot] = 1;
+			worker.dirty[(worker.dirty_head + worker.dirty_count) % worker.dirty.size()] = update.underlying;
+			worker.dirty_count++;
+		}
+		worker.latest[slot] = update;
+		got++;
+	}
+	worker.updates += got;
+	return got;
+}
+
+void MarketDataFeed::Reprice(Worker& worker, const MarketUpdate& update) {
+	PRICER_PROBE("MarketDataFeed::Reprice");
+	size_t begin = offsets[update.underlying];
+	size_t end = offsets[update.underlying + 1];
+	double* values = &worker.values[0] + worker.first[update.underlying / workers.size()];
+	for (size_t m = begin; m < end; m++) {
+		const OptionContract& c = book[members[m]];
+		double sig = std::max(c.sig + update.vol_shift, MIN_VOL);
+		values[m - begin] = PriceKernel<double>(c.type, update.spot, c.K, c.T, sig, c.rf, c.b);
+	}
+	worker.contracts += end - begin;
+	worker.repricings++;
+	if (worker.samples < worker.latency.size()) {
+		worker.latency[worker.samples++] = (float)((Now() - update.stamp) * 1e-3);
+	}
+}
+
+void MarketDataFeed::Run(size_t w) {
+	if (pin && !PinThread(AllowedCpu(w + 1))) {
+		cout << "Market data worker " << w << " could not be pinned" << endl;
+	}
+	Worker& worker = *workers[w];
+	size_t n = workers.size();
+	//spinning only pays when the producers do not need the CPU the worker would hold
+	int spin_limit = (std::thread::hardware_concurrency() > n) ? SPIN_LIMIT : 0;
+	int spins = 0;
+	while (true) {
+		bool stopping = !running.load(std::memory_order_acquire);
+		size_t got = Drain(worker);
+		//one underlying at a time, oldest first, so that the ticks arriving meanwhile coalesce into the queued ones
+		while (worker.dirty_count > 0) {
+			unsigned int u = worker.dirty[worker.dirty_head];
+			worker.dirty_head = (worker.dirty_head + 1) % worker.dirty.size();
+			worker.dirty_count--;
+			size_t slot = u / n;
+			worker.is_dirty[slot] = 0;
+			Reprice(worker, worker.latest[slot]);
+			got += Drain(worker);
+		}
+		if (got > 0) {
+			spins = 0;
+		}
+		else if (stopping) {
+			return;
+		}
+		else if (spins < spin_limit) {
+			spins++;
+			CpuRelax();
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+/*Results*/
+size_t MarketDataFeed::UnderlyingCount() const {
+	return offsets.size() - 1;
+}
+
+const std::vector<double>& MarketDataFeed::Prices() const {
+	return prices;
+}
+
+FeedStats MarketDataFeed::Stats() const {
+	FeedStats stats;
+	stats.updates = stats.repricings = stats.contracts = 0;
+	stats.dropped = dropped;
+	std::vector<float> latency;
+	for (size_t w = 0; w < workers.size(); w++) {
+		stats.updates += workers[w]->updates;
+		stats.repricings += workers[w]->repricings;
+		stats.contracts += workers[w]->contracts;
+		latency.insert(latency.end(), workers[w]->latency.begin(), workers[w]->latency.begin() + workers[w]->samples);
+	}
+	stats.latency_p50 = stats.latency_p99 = stats.latency_max = 0.0;
+	if (!latency.empty()) {
+		std::sort(latency.begin(), latency.end());
+		stats.latency_p50 = latency[latency.size() / 2];
+		stats.latency_p99 = latency[latency.size() * 99 / 100];
+		stats.latency_max = latency.back();
+	}
+	return stats;
+}
+
+/*TickReplay implementation*/
+TickReplay::TickReplay() {}
+
+TickReplay::~TickReplay() {}
+
+bool TickReplay::Load(const std::string& path, const OptionBook& book) {
+	std::ifstream in(path.c_str());
+	if (!in) {
+		return false;
+	}
+	std::map<std::string, unsigned int> index;
+	for (size_t u = 0; u < book.UnderlyingCount(); u++) {
+		index[book.UnderlyingName((unsigned int)u)] = (unsigned int)u;
+	}
+	ticks.clear();
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::stringstream ss(line);
+		std::string name;
+		Tick tick;
+		if (!(ss >> tick.time_us >> name >> tick.spot >> tick.vol_shift)) {
+			continue;
+		}
+		std::map<std::string, unsigned int>::const_iterator it = index.find(name);
+		if (it == index.end()) {
+			continue;
+		}
+		tick.underlying = it->second;
+		ticks.push_back(tick);
+	}
+	return true;
+}
+
+bool TickReplay::Save(const std::string& path, const std::vector<Tick>& recorded, const OptionBook& book) {
+	std::ofstream out(path.c_str());
+	if (!out) {
+		return false;
+	}
+	out.precision(17);
+	out << "# time_us underlying spot vol_shift" << endl;
+	for (size_t i = 0; i < recorded.size(); i++) {
+		out << recorded[i].time_us << " " << book.UnderlyingName(recorded[i].underlying) << " " << recorded[i].spot << " " << recorded[i].vol_shift << "\n";
+	}
+	return (bool)out;
+}
+
+size_t TickReplay::size() const {
+	return ticks.size();
+}
+
+const std::vector<Tick>& TickReplay::Ticks() const {
+	return ticks;
+}
+
+double TickReplay::Replay(MarketDataFeed& feed, double speed) const {
+	PRICER_PROBE("TickReplay::Replay");
+	long long start = MarketDataFeed::Now();
+	for (size_t i = 0; i < ticks.size(); i++) {
+		if (speed > 0.0) { //waits for the time of the tick, scaled by the speed
+			long long due = start + (long long)(ticks[i].time_us * 1000.0 / speed);
+			while (MarketDataFeed::Now() < due) {
+				std::this_thread::yield();
+			}
+		}
+		MarketUpdate update = { ticks[i].underlying, ticks[i].spot, ticks[i].vol_shift, 0 };
+		feed.Publish(update);
+	}
+	return (MarketDataFeed::Now() - start) * 1e-3;
+}
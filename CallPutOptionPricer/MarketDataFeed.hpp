@@ -0,0 +1,151 @@
+/* Market data driven repricing */
+/*****************************************************
+Name: MarketDataFeed.hpp
+version: 0.2
+Description:
+Keeps the prices of an OptionBook current as spot and volatility updates arrive.
+
+Producers call Publish() from any thread. The underlyings are partitioned across the workers
+(underlying % workers) and every worker owns an MpscRing of MarketUpdate, so an underlying is only ever touched by
+one worker and the prices need no locking. A worker drains everything queued in its ring, keeps the latest update
+of each underlying (several ticks of the same underlying cost one repricing) and reprices the underlyings that
+changed in arrival order, one at a time, draining its ring again after each of them: a tick arriving during a burst
+coalesces into the pending repricing of its underlying instead of waiting for the whole burst to be priced first.
+Contracts are priced in the European (EuOptCall / EuOptPut) or perpetual American (UsOptCall / UsOptPut) model of
+each contract with S = spot and sig = max(book vol + vol_shift, 1e-4).
+The contracts of every underlying are indexed once when the feed is built. Every worker writes the prices of its
+own contracts into its own array (contiguous per underlying, so no cache line is shared with another worker);
+Prices() is gathered into the book order when the feed is stopped. An idle worker spins on its ring for a few
+thousand pause instructions before yielding its CPU (it yields at once when there are no more CPUs than workers).
+
+The tick-to-price latency of every repricing (publication stamp of the latest coalesced update to the end of the
+repricing of its underlying) is recorded per worker; Stats() reports the percentiles once the feed is stopped.
+The latency is bounded by the repricing cost of an underlying (about 60 ns per contract, 4 us for the 60 contracts
+per underlying of demo 16) and by the arrival rate. Measured with demo 16 (one worker, a single CPU shared with the
+replay thread): replaying the 200000 ticks as fast as possible (about 15 million ticks per second, far beyond the
+250000 underlyings per second one worker can reprice) gives p50 0.5 to 0.8 ms and p99 0.9 to 1.3 ms; the recorded
+pace (one tick every 5 us, the worker about 80% busy) gives p50 3.5 to 9.5 us and p99 140 to 300 us. The < 10 us
+tick-to-price target is only met at the median of the recorded pace; the tail is set by the scheduling of the
+worker, and meeting it needs a dedicated CPU per worker (Start(true)) and fewer contracts per worker.
+
+TickReplay loads a recorded tick file and publishes it at a configurable speed, for testing. One tick per line:
+	time_us underlying spot vol_shift
+where time_us is the offset of the tick from the start of the recording in microseconds and underlying is the name
+of the underlying in the book. Lines starting with # are comments.
+
+Change history:
+0.1 Initial version
+0.2 Repricing one underlying at a time with a drain in between, per worker price arrays, spinning idle workers
+
+******************************************************/
+
+#ifndef MARKETDATAFEED_HPP
+#define MARKETDATAFEED_HPP
+
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "OptionBook.hpp"
+#include "RingBuffer.hpp"
+using namespace std;
+
+struct MarketUpdate {
+	unsigned int underlying; //index of the underlying in the book
+	double spot;
+	double vol_shift; //added to the volatility of every contract of the underlying
+	long long stamp; //publication time in ns (MarketDataFeed::Now), set by Publish
+};
+
+struct FeedStats {
+	unsigned long long updates; //updates consumed
+	unsigned long long repricings; //underlyings repriced (updates - repricings were coalesced)
+	unsigned long long contracts; //contracts repriced
+	unsigned long long dropped; //updates refused because a queue was full
+	double latency_p50; //tick-to-price latency in us
+	double latency_p99;
+	double latency_max;
+
+	std::string ToString() const;
+};
+
+class MarketDataFeed {
+private:
+	/*Per worker state, only touched by its worker once started*/
+	struct Worker {
+		MpscRing<MarketUpdate> queue;
+		std::vector<MarketUpdate> latest; //latest update per owned underlying, indexed by underlying / workers
+		std::vector<unsigned int> dirty; //circular queue of the underlyings waiting for a repricing, in arrival order
+		size_t dirty_head, dirty_count;
+		std::vector<char> is_dirty;
+		std::vector<double> values; //prices of the owned contracts, contiguous per underlying
+		std::vector<size_t> first; //offset in values of the contracts of each owned underlying
+		std::vector<float> latency; //samples in us, preallocated
+		size_t samples;
+		unsigned long long updates, repricings, contracts;
+
+		Worker(size_t capacity) : queue(capacity), dirty_head(0), dirty_count(0), samples(0), updates(0), repricings(0), contracts(0) {}
+	};
+
+	const OptionBook& book;
+	std::vector<size_t> offsets; //contracts of underlying u: members[offsets[u]] .. members[offsets[u + 1] - 1]
+	std::vector<size_t> members;
+	std::vector<double> prices; //price of every contract in the book order, gathered from the workers by Stop
+	std::vector<Worker*> workers;
+	std::vector<std::thread> threads;
+	std::atomic<bool> running;
+	std::atomic<unsigned long long> dropped;
+	bool pin;
+
+	MarketDataFeed(const MarketDataFeed& source);
+	MarketDataFeed& operator = (const MarketDataFeed& source);
+
+	void Run(size_t w);
+	size_t Drain(Worker& worker); //moves the queued updates into latest / dirty, returns their number
+	void Reprice(Worker& worker, const MarketUpdate& update);
+
+public:
+	/*Constructor and destructor*/
+	MarketDataFeed(const OptionBook& p_book, int p_workers = 1, size_t queue_capacity = 1 << 16, size_t latency_samples = 1 << 20);
+	virtual ~MarketDataFeed();
+
+	/*Control*/
+	void Start(bool p_pin = false); //prices the whole book, then starts the workers (pinned to the allowed CPUs after the first if p_pin)
+	void Stop(); //processes what is queued, joins the workers and gathers the prices
+	bool Publish(const MarketUpdate& update); //any thread; false if the queue of the underlying is full
+
+	/*Results*/
+	size_t UnderlyingCount() const;
+	const std::vector<double>& Prices() const; //only consistent once stopped
+	FeedStats Stats() const; //only consistent once stopped
+	static long long Now(); //steady clock in ns
+};
+
+/*Recorded ticks and their replay into a feed*/
+struct Tick {
+	long long time_us;
+	unsigned int underlying;
+	double spot;
+	double vol_shift;
+};
+
+class TickReplay {
+private:
+	std::vector<Tick> ticks;
+
+public:
+	TickReplay();
+	virtual ~TickReplay();
+
+	bool Load(const std::string& path, const OptionBook& book); //unknown underlyings are skipped
+	static bool Save(const std::string& path, const std::vector<Tick>& recorded, const OptionBook& book);
+	size_t size() const;
+	const std::vector<Tick>& Ticks() const;
+
+	/*Publishes the ticks into the feed. speed 1 keeps the recorded pace, 10 replays ten times faster and 0 as fast
+	as possible. Returns the wall time of the replay in us*/
+	double Replay(MarketDataFeed& feed, double speed) const;
+};
+
+#endif
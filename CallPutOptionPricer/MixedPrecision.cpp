@@ -0,0 +1,140 @@
+/* Single and mixed precision batch pricing implementation */
+/*****************************************************
+Name: MixedPrecision.cpp
+version: 0.1
+Description:
+Implementation of the functions in MixedPrecision.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "MixedPrecision.hpp"
+#include "PricingKernels.hpp"
+#include <cmath>
+#include "Instrumentation.hpp"
+#include <cfloat>
+#include <iostream>
+
+/*PrecisionReport implementation*/
+PrecisionReport::PrecisionReport() : count(0), repriced(0), max_abs_error(0.0), max_rel_error(0.0), rms_error(0.0) {
+
+}
+
+std::string PrecisionReport::ToString() const {
+	std::stringstream ss;
+	ss << "Contracts compared: " << count << "\nRe-priced in double: " << repriced << "\nMax absolute error: " << max_abs_error
+		<< "\nMax relative error: " << max_rel_error << "\nRMS error: " << rms_error << endl;
+	return ss.str();
+}
+
+/*Conversion functions implementation*/
+OptionDataF ToFloat(const OptionData& data) {
+	OptionDataF f;
+	f.rf = (float)data.rf;
+	f.sig = (float)data.sig;
+	f.K = (float)data.K;
+	f.T = (float)data.T;
+	f.b = (float)data.b;
+	return f;
+}
+
+std::vector<OptionDataF> ToFloat(const std::vector<OptionData>& data) {
+	std::vector<OptionDataF> vec;
+	vec.resize(data.size()); //allocates space
+	for (size_t i = 0; i < data.size(); i++) {
+		vec[i] = ToFloat(data[i]);
+	}
+	return vec;
+}
+
+/*Batch pricers implementation*/
+std::vector<double> PriceBatch(const std::vector<OptionData>& data, const std::vector<double>& S, const std::vector<int>& types) {
+	PRICER_PROBE("PriceBatch");
+	std::vector<double> vec;
+	if (data.size() != S.size() || data.size() != types.size()) {
+		cout << "Invalid input. Contracts, spots and types must have the same size" << endl;
+		return vec;
+	}
+	vec.resize(data.size());
+	for (size_t i = 0; i < data.size(); i++) {
+		const OptionData& d = data[i];
+		vec[i] = PriceKernel<double>(types[i], S[i], d.K, d.T, d.sig, d.rf, d.b);
+	}
+	return vec;
+}
+
+std::vector<float> PriceBatchFloat(const std::vector<OptionDataF>& data, const std::vector<float>& S, const std::vector<int>& types) {
+	PRICER_PROBE("PriceBatchFloat");
+	std::vector<float> vec;
+	if (data.size() != S.size() || data.size() != types.size()) {
+		cout << "Invalid input. Contracts, spots and types must have the same size" << endl;
+		return vec;
+	}
+	vec.resize(data.size());
+	for (size_t i = 0; i < data.size(); i++) {
+		const OptionDataF& d = data[i];
+		vec[i] = PriceKernel<float>(types[i], S[i], d.K, d.T, d.sig, d.rf, d.b);
+	}
+	return vec;
+}
+
+std::vector<double> PriceBatchMixed(const std::vector<OptionData>& data, const std::vector<double>& S, const std::vector<int>& types, double rel_tol, PrecisionReport& report) {
+	PRICER_PROBE("PriceBatchMixed");
+	std::vector<double> vec;
+	report = PrecisionReport();
+	if (data.size() != S.size() || data.size() != types.size()) {
+		cout << "Invalid input. Contracts, spots and types must have the same size" << endl;
+		return vec;
+	}
+	vec.resize(data.size());
+	//the float price is the difference of terms of size S and K, so its rounding error is a few ulps of S + K
+	const double ulps = 16.0 * FLT_EPSILON;
+	for (size_t i = 0; i < data.size(); i++) {
+		const OptionData& d = data[i];
+		float price = PriceKernel<float>(types[i], (float)S[i], (float)d.K, (float)d.T, (float)d.sig, (float)d.rf, (float)d.b);
+		double error_bound = ulps * (fabs(S[i]) + fabs(d.K));
+		if (!(error_bound <= rel_tol * fabs(price))) { //also catches NaN and infinite float results
+			vec[i] = PriceKernel<double>(types[i], S[i], d.K, d.T, d.sig, d.rf, d.b);
+			report.repriced++;
+		}
+		else {
+			vec[i] = price;
+		}
+	}
+	report.count = (int)data.size();
+	return vec;
+}
+
+/*Accuracy report implementation*/
+template <typename Real>
+static PrecisionReport Compare(const std::vector<double>& reference, const std::vector<Real>& prices) {
+	PrecisionReport report;
+	if (reference.size() != prices.size()) {
+		cout << "Invalid input. Reference and compared prices must have the same size" << endl;
+		return report;
+	}
+	double sum_sq = 0.0;
+	for (size_t i = 0; i < reference.size(); i++) {
+		double abs_error = fabs((double)prices[i] - reference[i]);
+		sum_sq += abs_error * abs_error;
+		if (abs_error > report.max_abs_error) {
+			report.max_abs_error = abs_error;
+		}
+		if (reference[i] != 0.0 && abs_error / fabs(reference[i]) > report.max_rel_error) {
+			report.max_rel_error = abs_error / fabs(reference[i]);
+		}
+	}
+	report.count = (int)reference.size();
+	report.rms_error = (report.count > 0) ? sqrt(sum_sq / report.count) : 0.0;
+	return report;
+}
+
+PrecisionReport CompareToDouble(const std::vector<double>& reference, const std::vector<double>& prices) {
+	return Compare(reference, prices);
+}
+
+PrecisionReport CompareToDouble(const std::vector<double>& reference, const std::vector<float>& prices) {
+	return Compare(reference, prices);
+}
@@ -0,0 +1,56 @@
+/* Single and mixed precision batch pricing */
+/*****************************************************
+Name: MixedPrecision.hpp
+version: 0.1
+Description:
+Batch pricers for arrays of contracts in double, single (float) and mixed precision.
+
+The float path stores the contracts as OptionDataF (half the memory traffic of OptionData) and
+evaluates the kernels of PricingKernels.hpp in float arithmetic.
+The mixed path screens every contract in float and re-prices in double only the contracts whose
+estimated float rounding error is larger than the requested relative tolerance, e.g. deep out of the money
+options where S*e^((b-r)T)*N(d1) and K*e^(-rT)*N(d2) almost cancel.
+
+PrecisionReport compares any of these results against the double path.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef MIXEDPRECISION_HPP
+#define MIXEDPRECISION_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "OptionData.hpp"
+using namespace std;
+
+/*Accuracy of a batch of prices measured against the double path*/
+struct PrecisionReport {
+	int count; //number of contracts compared
+	int repriced; //number of contracts re-priced in double by the mixed path
+	double max_abs_error; //max |p - p_double|
+	double max_rel_error; //max |p - p_double| / |p_double| over contracts with a non-zero double price
+	double rms_error; //root mean square of the absolute errors
+
+	PrecisionReport();
+	std::string ToString() const;
+};
+
+/*Conversion between double and float contract data*/
+OptionDataF ToFloat(const OptionData& data);
+std::vector<OptionDataF> ToFloat(const std::vector<OptionData>& data);
+
+/*Batch pricers. types holds one OptionType per contract and S one spot per contract*/
+std::vector<double> PriceBatch(const std::vector<OptionData>& data, const std::vector<double>& S, const std::vector<int>& types);
+std::vector<float> PriceBatchFloat(const std::vector<OptionDataF>& data, const std::vector<float>& S, const std::vector<int>& types);
+//Screens in float and re-prices in double the contracts whose float error bound exceeds rel_tol * |price|
+std::vector<double> PriceBatchMixed(const std::vector<OptionData>& data, const std::vector<double>& S, const std::vector<int>& types, double rel_tol, PrecisionReport& report);
+
+/*Accuracy report of a batch of prices against the double reference prices*/
+PrecisionReport CompareToDouble(const std::vector<double>& reference, const std::vector<double>& prices);
+PrecisionReport CompareToDouble(const std::vector<double>& reference, const std::vector<float>& prices);
+
+#endif
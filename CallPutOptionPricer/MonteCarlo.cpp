@@ -0,0 +1,73 @@
+/* Monte Carlo engine for path dependent payoffs implementation */
+/*****************************************************
+Name: MonteCarlo.cpp
+version: 0.1
+Description:
+Implementation of the functions in MonteCarlo.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "MonteCarlo.hpp"
+#include <algorithm>
+
+/*Settings and result implementation*/
+MonteCarloSettings::MonteCarloSettings() : paths(100000), seed(42), antithetic(true), control_variate(true), threads(0) {
+
+}
+
+double MonteCarloResult::VarianceReduction() const {
+	return (std_error > 0.0) ? (raw_std_error * raw_std_error) / (std_error * std_error) : 0.0;
+}
+
+std::string MonteCarloResult::ToString() const {
+	std::stringstream ss;
+	ss << price << " +/- " << std_error << " (plain " << raw_price << " +/- " << raw_std_error << ", variance reduction " << VarianceReduction()
+		<< "x, " << paths << " paths)";
+	return ss.str();
+}
+
+/*Sums implementation*/
+void MonteCarloSums::Add(double y, double x) {
+	n += 1.0;
+	sy += y;
+	syy += y * y;
+	sx += x;
+	sxx += x * x;
+	sxy += x * y;
+}
+
+void MonteCarloSums::Add(const MonteCarloSums& other) {
+	n += other.n;
+	sy += other.sy;
+	syy += other.syy;
+	sx += other.sx;
+	sxx += other.sxx;
+	sxy += other.sxy;
+}
+
+MonteCarloResult MonteCarloEstimate(const MonteCarloSums& sums, double control_mean, bool control_variate, size_t paths) {
+	MonteCarloResult result = { 0.0, 0.0, 0.0, 0.0, 0.0, paths };
+	if (sums.n < 2.0) {
+		result.price = result.raw_price = (sums.n > 0.0) ? sums.sy / sums.n : 0.0;
+		return result;
+	}
+	double N = sums.n;
+	double mean_y = sums.sy / N;
+	double mean_x = sums.sx / N;
+	double var_y = std::max((sums.syy - N * mean_y * mean_y) / (N - 1.0), 0.0);
+	double var_x = std::max((sums.sxx - N * mean_x * mean_x) / (N - 1.0), 0.0);
+	double cov = (sums.sxy - N * mean_x * mean_y) / (N - 1.0);
+	result.raw_price = mean_y;
+	result.raw_std_error = sqrt(var_y / N);
+	result.price = mean_y;
+	result.std_error = result.raw_std_error;
+	if (control_variate && var_x > 0.0) {
+		result.beta = cov / var_x;
+		result.price = mean_y - result.beta * (mean_x - control_mean);
+		result.std_error = sqrt(std::max(var_y - cov * cov / var_x, 0.0) / N);
+	}
+	return result;
+}
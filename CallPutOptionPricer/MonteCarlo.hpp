@@ -0,0 +1,137 @@
+/* Monte Carlo engine for path dependent payoffs */
+/*****************************************************
+Name: MonteCarlo.hpp
+version: 0.1
+Description:
+Simulation of the generalized Black-Scholes underlying (drift b, volatility sig, discounting at rf) on n equally
+spaced fixings t_i = i*T/n, for payoffs that depend on the whole path (AsianOption, LookbackOption).
+The log price is stepped exactly, ln S(t_i+1) = ln S(t_i) + (b - sig^2/2) dt + sig sqrt(dt) Z, so the only error
+is the statistical one.
+
+SimulateGBM(model, control_mean, settings, payoff) calls payoff(path, n, y, x) for every path, path holding the
+n + 1 prices S(t_0) = S, ..., S(t_n): y is the discounted payoff and x a discounted control variate whose
+expectation control_mean is known in closed form. The estimate is y corrected by the regression on x:
+	price = mean(y) - beta * (mean(x) - control_mean), beta = Cov(x, y) / Var(x)
+and its standard error is that of the regression residual, so a control correlated at rho cuts the variance by
+1 - rho^2 (about 100x for an arithmetic Asian against the geometric one). The uncorrected estimate is reported too.
+With antithetic on, every draw is also used with its sign flipped and the pair counts as one sample.
+
+The paths are cut in blocks of MC_BLOCK_PATHS; the generator of a block is seeded from the seed and the block
+number and the sums of the blocks are added in block order, so the results are bit for bit the same whatever the
+number of threads.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef MONTECARLO_HPP
+#define MONTECARLO_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <vector>
+#include "ParallelFor.hpp"
+#include "boost/random.hpp"
+using namespace std;
+
+const size_t MC_BLOCK_PATHS = 4096;
+
+struct MonteCarloSettings {
+	size_t paths; //number of paths (antithetic pairs count as two)
+	unsigned int seed;
+	bool antithetic;
+	bool control_variate; //false reports the plain estimate as price
+	int threads; //0 uses the hardware concurrency
+
+	MonteCarloSettings();
+};
+
+struct MonteCarloResult {
+	double price;
+	double std_error;
+	double raw_price; //mean of the payoffs without the control variate
+	double raw_std_error;
+	double beta; //regression coefficient of the control variate
+	size_t paths;
+
+	double VarianceReduction() const; //raw variance over the variance of the estimate
+	std::string ToString() const;
+};
+
+/*Simulated underlying*/
+struct PathModel {
+	double S; //spot
+	double T; //maturity
+	double sig;
+	double rf;
+	double b; //cost of carry
+	int steps; //fixings after t = 0
+};
+
+/*Sums of one block of samples*/
+struct MonteCarloSums {
+	double n, sy, syy, sx, sxx, sxy;
+
+	void Add(double y, double x);
+	void Add(const MonteCarloSums& other);
+};
+
+MonteCarloResult MonteCarloEstimate(const MonteCarloSums& sums, double control_mean, bool control_variate, size_t paths);
+
+/*Payoff: void payoff(const double* path, int n, double& y, double& x)*/
+template <typename Payoff>
+MonteCarloResult SimulateGBM(const PathModel& model, double control_mean, const MonteCarloSettings& settings, Payoff payoff) {
+	const int n = (model.steps > 0) ? model.steps : 1;
+	const double dt = model.T / n;
+	const double drift = (model.b - 0.5 * model.sig * model.sig) * dt;
+	const double diffusion = model.sig * sqrt(dt);
+	const size_t per_block = settings.antithetic ? MC_BLOCK_PATHS / 2 : MC_BLOCK_PATHS; //samples per block
+	const size_t samples = settings.antithetic ? (settings.paths + 1) / 2 : settings.paths;
+	const size_t blocks = (samples + per_block - 1) / per_block;
+	std::vector<MonteCarloSums> partial(blocks);
+	ParallelFor(blocks, settings.threads, [&](size_t block) {
+		boost::mt19937 gen(settings.seed + 0x9E3779B9u * (unsigned int)(block + 1));
+		boost::normal_distribution<double> norm(0.0, 1.0);
+		boost::variate_generator< boost::mt19937&, boost::normal_distribution<double> > z(gen, norm);
+		std::vector<double> path(n + 1), mirror(n + 1), draws(n);
+		MonteCarloSums sums = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		size_t count = std::min(per_block, samples - block * per_block);
+		for (size_t p = 0; p < count; p++) {
+			for (int i = 0; i < n; i++) {
+				draws[i] = z();
+			}
+			double log_s = log(model.S);
+			path[0] = model.S;
+			for (int i = 0; i < n; i++) {
+				log_s += drift + diffusion * draws[i];
+				path[i + 1] = exp(log_s);
+			}
+			double y = 0.0, x = 0.0;
+			payoff(&path[0], n, y, x);
+			if (settings.antithetic) {
+				log_s = log(model.S);
+				mirror[0] = model.S;
+				for (int i = 0; i < n; i++) {
+					log_s += drift - diffusion * draws[i];
+					mirror[i + 1] = exp(log_s);
+				}
+				double y2 = 0.0, x2 = 0.0;
+				payoff(&mirror[0], n, y2, x2);
+				y = 0.5 * (y + y2);
+				x = 0.5 * (x + x2);
+			}
+			sums.Add(y, x);
+		}
+		partial[block] = sums;
+	});
+	MonteCarloSums total = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (size_t block = 0; block < blocks; block++) {
+		total.Add(partial[block]);
+	}
+	return MonteCarloEstimate(total, control_mean, settings.control_variate, settings.paths);
+}
+
+#endif
@@ -0,0 +1,266 @@
+/* Multilevel Monte Carlo implementation */
+/*****************************************************
+Name: MultilevelMC.cpp
+version: 0.1
+Description:
+Implementation of the functions in MultilevelMC.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "MultilevelMC.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+/*Payoffs implementation*/
+EuropeanPayoff::EuropeanPayoff(double p_K, bool p_call) : K(p_K), call(p_call) {
+
+}
+
+double EuropeanPayoff::operator () (double S, const double* fixings, int n) const {
+	(void)S;
+	return call ? std::max(fixings[n - 1] - K, 0.0) : std::max(K - fixings[n - 1], 0.0);
+}
+
+AsianPayoff::AsianPayoff(double p_K, bool p_call) : K(p_K), call(p_call) {
+
+}
+
+double AsianPayoff::operator () (double S, const double* fixings, int n) const {
+	(void)S;
+	double sum = 0.0;
+	for (int i = 0; i < n; i++) {
+		sum += fixings[i];
+	}
+	return call ? std::max(sum / n - K, 0.0) : std::max(K - sum / n, 0.0);
+}
+
+LookbackPayoff::LookbackPayoff(double p_K, bool p_call, bool p_floating) : K(p_K), call(p_call), floating(p_floating) {
+
+}
+
+double LookbackPayoff::operator () (double S, const double* fixings, int n) const {
+	double lo = S, hi = S;
+	for (int i = 0; i < n; i++) {
+		lo = std::min(lo, fixings[i]);
+		hi = std::max(hi, fixings[i]);
+	}
+	if (floating) {
+		return call ? fixings[n - 1] - lo : hi - fixings[n - 1];
+	}
+	return call ? std::max(hi - K, 0.0) : std::max(K - lo, 0.0);
+}
+
+/*Settings and result implementation*/
+MlmcSettings::MlmcSettings() : rmse(0.01), scheme(SCHEME_MILSTEIN), base_steps(1), min_levels(3), max_levels(12), initial_samples(10000),
+	seed(42), threads(0) {
+
+}
+
+std::string MlmcResult::ToString() const {
+	std::stringstream ss;
+	ss << "Price: " << price << " (statistical error " << std_error << ", estimated bias " << bias << (converged ? "" : ", bias target not reached") << ")" << endl;
+	ss << "Level  steps      samples        mean     variance   cost/sample   seconds" << endl;
+	for (size_t l = 0; l < levels.size(); l++) {
+		const MlmcLevel& lv = levels[l];
+		ss << l << "      " << lv.steps << "      " << lv.samples << "      " << lv.mean << "      " << lv.variance << "      " << lv.cost << "      " << lv.seconds << endl;
+	}
+	ss << "Cost: " << cost << " time steps, single level Monte Carlo at the finest level: " << single_level_cost << " ("
+		<< (cost > 0.0 ? single_level_cost / cost : 0.0) << "x)" << endl;
+	return ss.str();
+}
+
+/*Constructor and destructor implementation*/
+MultilevelMC::MultilevelMC(const PathModel& p_model, const PathPayoff& p_payoff, const MlmcSettings& p_settings)
+	: model(p_model), payoff(p_payoff), settings(p_settings) {
+	model.steps = std::max(model.steps, 1);
+	settings.base_steps = std::max(settings.base_steps, 1);
+	settings.min_levels = std::max(settings.min_levels, 2);
+	settings.max_levels = std::max(settings.max_levels, settings.min_levels);
+	settings.initial_samples = std::max(settings.initial_samples, (size_t)MLMC_BLOCK);
+}
+
+MultilevelMC::~MultilevelMC() {
+
+}
+
+int MultilevelMC::Steps(int level) const {
+	return model.steps * settings.base_steps * (1 << level);
+}
+
+double MultilevelMC::Cost(int level) const {
+	return Steps(level) + ((level > 0) ? Steps(level - 1) : 0);
+}
+
+/*Sampling implementation*/
+void MultilevelMC::SampleBlock(int level, size_t block, size_t count, LevelSums& sums) const {
+	boost::mt19937 gen(settings.seed + 0x9E3779B9u * (unsigned int)(block + 1) + 0x85EBCA6Bu * (unsigned int)(level + 1));
+	boost::normal_distribution<double> norm(0.0, 1.0);
+	boost::variate_generator< boost::mt19937&, boost::normal_distribution<double> > z(gen, norm);
+	const int n = model.steps;
+	const int fine_steps = Steps(level);
+	const int fine_per_fixing = fine_steps / n;
+	const double dt = model.T / fine_steps;
+	const double sqrt_dt = sqrt(dt);
+	const double df = exp(-model.rf * model.T);
+	const bool milstein = (settings.scheme == SCHEME_MILSTEIN);
+	const double b = model.b, sig = model.sig;
+	std::vector<double> fine_fix(n), coarse_fix(n);
+	for (size_t s = 0; s < count; s++) {
+		double Sf = model.S, Sc = model.S;
+		for (int k = 0; k < fine_steps; k += 2) {
+			//two fine steps, one coarse step on the sum of their increments
+			double dW1 = sqrt_dt * z();
+			double dW2 = (k + 1 < fine_steps) ? sqrt_dt * z() : 0.0;
+			Sf += Sf * (b * dt + sig * dW1 + (milstein ? 0.5 * sig * sig * (dW1 * dW1 - dt) : 0.0));
+			if ((k + 1) % fine_per_fixing == 0) {
+				fine_fix[(k + 1) / fine_per_fixing - 1] = Sf;
+			}
+			if (k + 1 < fine_steps) {
+				Sf += Sf * (b * dt + sig * dW2 + (milstein ? 0.5 * sig * sig * (dW2 * dW2 - dt) : 0.0));
+				if ((k + 2) % fine_per_fixing == 0) {
+					fine_fix[(k + 2) / fine_per_fixing - 1] = Sf;
+				}
+			}
+			if (level > 0) {
+				double dW = dW1 + dW2;
+				Sc += Sc * (b * 2.0 * dt + sig * dW + (milstein ? 0.5 * sig * sig * (dW * dW - 2.0 * dt) : 0.0));
+				if ((k + 2) % fine_per_fixing == 0) { //fine_per_fixing is even above level 0
+					coarse_fix[(k + 2) / fine_per_fixing - 1] = Sc;
+				}
+			}
+		}
+		double Pf = df * payoff(model.S, &fine_fix[0], n);
+		double Y = (level > 0) ? Pf - df * payoff(model.S, &coarse_fix[0], n) : Pf;
+		sums.sum += Y;
+		sums.sum2 += Y * Y;
+		sums.fine += Pf;
+		sums.fine2 += Pf * Pf;
+	}
+	sums.samples += count;
+}
+
+/*Estimation implementation*/
+MlmcResult MultilevelMC::Run() const {
+	PRICER_PROBE("MultilevelMC::Run");
+	struct Task {
+		int level;
+		size_t block;
+		size_t count;
+	};
+	const double eps = settings.rmse;
+	std::vector<LevelSums> sums(settings.min_levels);
+	std::vector<size_t> target(settings.min_levels, settings.initial_samples);
+	std::vector<size_t> planned(settings.min_levels, 0); //samples handed out in blocks
+	for (size_t l = 0; l < sums.size(); l++) {
+		sums[l] = LevelSums();
+	}
+	MlmcResult result = MlmcResult();
+	double alpha = 1.0;
+	while (true) {
+		//every block missing on every level, run together
+		std::vector<Task> tasks;
+		for (size_t l = 0; l < sums.size(); l++) {
+			while (planned[l] < target[l]) {
+				Task task = { (int)l, planned[l] / MLMC_BLOCK, MLMC_BLOCK };
+				tasks.push_back(task);
+				planned[l] += MLMC_BLOCK;
+			}
+		}
+		std::vector<LevelSums> partial(tasks.size());
+		ParallelFor(tasks.size(), settings.threads, [&](size_t t) {
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			partial[t] = LevelSums();
+			SampleBlock(tasks[t].level, tasks[t].block, tasks[t].count, partial[t]);
+			partial[t].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		});
+		for (size_t t = 0; t < tasks.size(); t++) {
+			LevelSums& s = sums[tasks[t].level];
+			s.samples += partial[t].samples;
+			s.sum += partial[t].sum;
+			s.sum2 += partial[t].sum2;
+			s.fine += partial[t].fine;
+			s.fine2 += partial[t].fine2;
+			s.seconds += partial[t].seconds;
+		}
+
+		//means, variances and the weak order alpha (regression of log2 |mean| on the level, at least 0.5)
+		const int L = (int)sums.size() - 1;
+		std::vector<double> mean(L + 1), var(L + 1);
+		for (int l = 0; l <= L; l++) {
+			double N = (double)sums[l].samples;
+			mean[l] = sums[l].sum / N;
+			var[l] = std::max(sums[l].sum2 / N - mean[l] * mean[l], 1e-300);
+		}
+		double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, m = 0.0;
+		for (int l = 1; l <= L; l++) {
+			double y = log2(std::max(fabs(mean[l]), 1e-300));
+			sx += l;
+			sy += y;
+			sxx += (double)l * l;
+			sxy += l * y;
+			m += 1.0;
+		}
+		if (m >= 2.0) {
+			alpha = std::max(-(m * sxy - sx * sy) / (m * sxx - sx * sx), 0.5);
+		}
+
+		//optimal samples per level for a statistical error of eps/sqrt(2)
+		double sum_vc = 0.0;
+		for (int l = 0; l <= L; l++) {
+			sum_vc += sqrt(var[l] * Cost(l));
+		}
+		bool more = false;
+		for (int l = 0; l <= L; l++) {
+			size_t optimal = (size_t)ceil(2.0 / (eps * eps) * sqrt(var[l] / Cost(l)) * sum_vc);
+			if (optimal > sums[l].samples) {
+				target[l] = (optimal + MLMC_BLOCK - 1) / MLMC_BLOCK * MLMC_BLOCK;
+				more = true;
+			}
+		}
+		if (more) {
+			continue;
+		}
+
+		//bias of the finest level, from the last two corrections
+		double bias = std::max(fabs(mean[L]), fabs(mean[L - 1]) / pow(2.0, alpha)) / (pow(2.0, alpha) - 1.0);
+		result.bias = bias;
+		result.converged = (bias <= eps / sqrt(2.0));
+		if (result.converged || L + 1 >= settings.max_levels) {
+			break;
+		}
+		sums.push_back(LevelSums());
+		target.push_back(settings.initial_samples);
+		planned.push_back(0);
+	}
+
+	//estimate and per level report
+	double variance = 0.0;
+	result.price = 0.0;
+	result.cost = 0.0;
+	for (size_t l = 0; l < sums.size(); l++) {
+		double N = (double)sums[l].samples;
+		MlmcLevel lv;
+		lv.steps = Steps((int)l);
+		lv.samples = sums[l].samples;
+		lv.mean = sums[l].sum / N;
+		lv.variance = std::max(sums[l].sum2 / N - lv.mean * lv.mean, 0.0);
+		double fine_mean = sums[l].fine / N;
+		lv.fine_variance = std::max(sums[l].fine2 / N - fine_mean * fine_mean, 0.0);
+		lv.cost = Cost((int)l);
+		lv.seconds = sums[l].seconds;
+		result.levels.push_back(lv);
+		result.price += lv.mean;
+		variance += lv.variance / N;
+		result.cost += N * lv.cost;
+	}
+	result.std_error = sqrt(variance);
+	const MlmcLevel& finest = result.levels.back();
+	result.single_level_cost = (variance > 0.0) ? finest.fine_variance / variance * finest.steps : 0.0;
+	return result;
+}
@@ -0,0 +1,151 @@
+/* Multilevel Monte Carlo */
+/*****************************************************
+Name: MultilevelMC.hpp
+version: 0.1
+Description:
+Multilevel Monte Carlo estimator (Giles, 2008) for payoffs observed on n equally spaced fixings, with the
+underlying of MonteCarlo.hpp (PathModel: drift b, volatility sig, discounting at rf) discretized by the Euler or
+the Milstein scheme.
+
+Level l steps the path with N_l = n * base_steps * 2^l time steps. The price at the finest level L is written as
+	E[P_L] = E[P_0] + sum over l = 1..L of E[P_l - P_l-1]
+and every correction is estimated from coupled paths: the coarse path of a sample sums the Brownian increments of
+the fine one two by two, so P_l - P_l-1 has a small variance V_l, decaying like 2^(-beta l) (beta = 1 for Euler,
+2 for Milstein). The samples per level are N_l = 2 eps^-2 sqrt(V_l / C_l) sum_k sqrt(V_k C_k), C_l being the
+cost of a sample, so that the statistical error is eps/sqrt(2); levels are added until the estimated bias
+|E[P_L - P_L-1]| / (2^alpha - 1) is below eps/sqrt(2). For a target RMSE eps the cost is about eps^-2 (Milstein)
+instead of eps^-3 for a single level at the step size that reaches the same bias.
+
+The samples of a level are drawn in blocks of MLMC_BLOCK; the generator of a block is seeded from the seed, the
+level and the block number, and all the blocks requested in a round (of every level) are run in parallel and added
+in order, so the results do not depend on the number of threads.
+
+Payoffs derive from PathPayoff and see the prices at the fixings, S(t_1) .. S(t_n):
+EuropeanPayoff (n = 1 validates against EuOptCall / EuOptPut), AsianPayoff (arithmetic average) and
+LookbackPayoff (extremes over S and the fixings).
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef MULTILEVELMC_HPP
+#define MULTILEVELMC_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "MonteCarlo.hpp"
+using namespace std;
+
+const size_t MLMC_BLOCK = 1024;
+
+enum Discretization {
+	SCHEME_EULER = 0,
+	SCHEME_MILSTEIN = 1
+};
+
+/*Undiscounted payoff from the prices at the fixings*/
+class PathPayoff {
+public:
+	virtual ~PathPayoff() {}
+	virtual double operator () (double S, const double* fixings, int n) const = 0; //S: price at t = 0
+};
+
+class EuropeanPayoff : public PathPayoff {
+private:
+	double K;
+	bool call;
+
+public:
+	EuropeanPayoff(double p_K, bool p_call);
+	double operator () (double S, const double* fixings, int n) const;
+};
+
+class AsianPayoff : public PathPayoff {
+private:
+	double K;
+	bool call;
+
+public:
+	AsianPayoff(double p_K, bool p_call);
+	double operator () (double S, const double* fixings, int n) const;
+};
+
+class LookbackPayoff : public PathPayoff {
+private:
+	double K; //ignored by the floating strike
+	bool call;
+	bool floating;
+
+public:
+	LookbackPayoff(double p_K, bool p_call, bool p_floating);
+	double operator () (double S, const double* fixings, int n) const;
+};
+
+struct MlmcSettings {
+	double rmse; //target root mean square error
+	int scheme; //Discretization
+	int base_steps; //time steps per fixing interval at level 0
+	int min_levels; //levels 0 .. min_levels - 1 are always used
+	int max_levels;
+	size_t initial_samples; //samples of a new level, rounded up to blocks
+	unsigned int seed;
+	int threads; //0 uses the hardware concurrency
+
+	MlmcSettings();
+};
+
+struct MlmcLevel {
+	int steps; //time steps of the fine path
+	size_t samples;
+	double mean; //E[P_l - P_l-1] (E[P_0] at level 0)
+	double variance; //V[P_l - P_l-1]
+	double fine_variance; //V[P_l]
+	double cost; //time steps per sample (fine and coarse)
+	double seconds; //time spent on the level
+};
+
+struct MlmcResult {
+	double price;
+	double std_error; //statistical error
+	double bias; //estimated bias of the finest level
+	double cost; //time steps of every sample of every level
+	double single_level_cost; //time steps of a single level Monte Carlo at the finest level with the same statistical error
+	bool converged; //false if max_levels was reached with the bias above the target
+	std::vector<MlmcLevel> levels;
+
+	std::string ToString() const;
+};
+
+class MultilevelMC {
+private:
+	/*Running sums of a level*/
+	struct LevelSums {
+		size_t samples;
+		double sum, sum2; //P_l - P_l-1
+		double fine, fine2; //P_l
+		double seconds;
+	};
+
+	PathModel model; //model.steps is the number of fixings
+	const PathPayoff& payoff; //not owned, must outlive the estimator
+	MlmcSettings settings;
+
+	MultilevelMC(const MultilevelMC& source);
+	MultilevelMC& operator = (const MultilevelMC& source);
+
+	int Steps(int level) const;
+	double Cost(int level) const;
+	void SampleBlock(int level, size_t block, size_t count, LevelSums& sums) const;
+
+public:
+	/*Constructor and destructor*/
+	MultilevelMC(const PathModel& p_model, const PathPayoff& p_payoff, const MlmcSettings& p_settings = MlmcSettings());
+	virtual ~MultilevelMC();
+
+	/*Adaptive estimation to the target RMSE*/
+	MlmcResult Run() const;
+};
+
+#endif
@@ -0,0 +1,403 @@
+/* NUMA aware batch pricing implementation */
+/*****************************************************
+Name: NumaPricer.cpp
+version: 0.1
+Description:
+Implementation of the functions in NumaPricer.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "NumaPricer.hpp"
+#include "ParallelFor.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+static const size_t SMALL_PAGE = 4096;
+static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+static const size_t PARTITION_ALIGN = 8; //contracts, 8 results of 8 bytes per cache line
+
+/*Parses a sysfs CPU list such as "0-3,8-11"*/
+static bool ParseCpuList(const std::string& text, std::vector<int>& cpus) {
+	std::stringstream ss(text);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		if (range.empty() || range == "\n") {
+			continue;
+		}
+		int first = 0, last = 0;
+		size_t dash = range.find('-');
+		first = atoi(range.c_str());
+		last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+		if (first < 0 || last < first) {
+			return false;
+		}
+		for (int cpu = first; cpu <= last; cpu++) {
+			cpus.push_back(cpu);
+		}
+	}
+	return !cpus.empty();
+}
+
+/*NumaTopology implementation*/
+NumaTopology::NumaTopology() {
+	std::vector<int> allowed = AllowedCpus(); //sorted
+#if defined(__linux__)
+	for (int id = 0; id < 1024; id++) { //at most 1024 nodes (CONFIG_NODES_SHIFT = 10)
+		std::stringstream path;
+		path << "/sys/devices/system/node/node" << id << "/cpulist";
+		std::ifstream file(path.str().c_str());
+		if (!file) { //node ids can have holes
+			continue;
+		}
+		std::string text;
+		std::getline(file, text);
+		NumaNode node;
+		node.id = id;
+		std::vector<int> cpus;
+		if (ParseCpuList(text, cpus)) { //memory only nodes have no CPU
+			std::sort(cpus.begin(), cpus.end());
+			std::set_intersection(cpus.begin(), cpus.end(), allowed.begin(), allowed.end(), std::back_inserter(node.cpus));
+		}
+		if (!node.cpus.empty()) { //nor do nodes outside the affinity mask of the process
+			nodes.push_back(node);
+		}
+	}
+#endif
+	if (nodes.empty()) {
+		NumaNode node;
+		node.id = 0;
+		node.cpus = allowed;
+		nodes.push_back(node);
+	}
+}
+
+NumaTopology::~NumaTopology() {
+
+}
+
+size_t NumaTopology::NodeCount() const {
+	return nodes.size();
+}
+
+const NumaNode& NumaTopology::Node(size_t index) const {
+	return nodes[index];
+}
+
+int NumaTopology::NodeOfCpu(int cpu) const {
+	for (size_t n = 0; n < nodes.size(); n++) {
+		if (std::find(nodes[n].cpus.begin(), nodes[n].cpus.end(), cpu) != nodes[n].cpus.end()) {
+			return nodes[n].id;
+		}
+	}
+	return -1;
+}
+
+std::string NumaTopology::ToString() const {
+	std::stringstream ss;
+	for (size_t n = 0; n < nodes.size(); n++) {
+		ss << "Node " << nodes[n].id << ": " << nodes[n].cpus.size() << " CPUs (";
+		for (size_t c = 0; c < nodes[n].cpus.size(); c++) {
+			ss << (c ? " " : "") << nodes[n].cpus[c];
+		}
+		ss << ")" << endl;
+	}
+	return ss.str();
+}
+
+/*NumaConfig implementation*/
+NumaConfig::NumaConfig() : pin(true), first_touch(true), huge_pages(HUGE_PAGES_TRANSPARENT), workers_per_node(0) {
+
+}
+
+std::vector<int> NumaConfig::Cpus(const NumaTopology& topology) const {
+	std::vector<int> cpus;
+	for (size_t n = 0; n < topology.NodeCount(); n++) {
+		const NumaNode& node = topology.Node(n);
+		size_t count = (workers_per_node > 0) ? std::min((size_t)workers_per_node, node.cpus.size()) : node.cpus.size();
+		cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.begin() + count);
+	}
+	return cpus;
+}
+
+/*LargeBuffer implementation*/
+LargeBuffer::LargeBuffer() : data(0), length(0), pages(HUGE_PAGES_NONE) {
+
+}
+
+LargeBuffer::~LargeBuffer() {
+	Release();
+}
+
+bool LargeBuffer::Allocate(size_t bytes, int huge_pages) {
+	Release();
+	if (bytes == 0) {
+		return true;
+	}
+#if defined(__linux__)
+	//anonymous mappings get their pages on the first write, on the node of the writing thread
+	size_t huge_length = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+	if (huge_pages == HUGE_PAGES_EXPLICIT) {
+		void* p = mmap(0, huge_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			data = p;
+			length = huge_length;
+			pages = HUGE_PAGES_EXPLICIT;
+			return true;
+		}
+	}
+	size_t map_length = (huge_pages != HUGE_PAGES_NONE) ? huge_length : (bytes + SMALL_PAGE - 1) / SMALL_PAGE * SMALL_PAGE;
+	void* p = mmap(0, map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	data = p;
+	length = map_length;
+	pages = HUGE_PAGES_NONE;
+#ifdef MADV_HUGEPAGE
+	if (huge_pages != HUGE_PAGES_NONE && madvise(p, map_length, MADV_HUGEPAGE) == 0) {
+		pages = HUGE_PAGES_TRANSPARENT;
+	}
+#endif
+	return true;
+#else
+	(void)huge_pages; //huge pages are only requested on Linux
+	size_t page_length = (bytes + SMALL_PAGE - 1) / SMALL_PAGE * SMALL_PAGE;
+	void* p = 0;
+#ifdef _WIN32
+	p = _aligned_malloc(page_length, SMALL_PAGE);
+#else
+	if (posix_memalign(&p, SMALL_PAGE, page_length) != 0) {
+		p = 0;
+	}
+#endif
+	if (p == 0) {
+		return false;
+	}
+	data = p;
+	length = page_length;
+	pages = HUGE_PAGES_NONE;
+	return true;
+#endif
+}
+
+void LargeBuffer::Release() {
+	if (data == 0) {
+		return;
+	}
+#if defined(__linux__)
+	munmap(data, length);
+#elif defined(_WIN32)
+	_aligned_free(data);
+#else
+	free(data);
+#endif
+	data = 0;
+	length = 0;
+	pages = HUGE_PAGES_NONE;
+}
+
+void* LargeBuffer::Data() const {
+	return data;
+}
+
+size_t LargeBuffer::size() const {
+	return length;
+}
+
+int LargeBuffer::Pages() const {
+	return pages;
+}
+
+/*NodeStats implementation*/
+std::string NodeStats::ToString() const {
+	std::stringstream ss;
+	ss << "Node " << node << ": " << workers << " workers, " << contracts << " contracts in " << seconds * 1000.0 << " ms ("
+		<< throughput / 1e6 << " M contracts/s)";
+	return ss.str();
+}
+
+/*Constructor and destructor implementation*/
+NumaPricer::NumaPricer(const NumaConfig& p_config) : config(p_config), m_size(0), unpinned(0) {
+	cpus = config.Cpus(topology);
+}
+
+NumaPricer::~NumaPricer() {
+	Clear();
+}
+
+void NumaPricer::Clear() {
+	for (size_t p = 0; p < partitions.size(); p++) {
+		delete partitions[p];
+	}
+	partitions.clear();
+	stats.clear();
+	m_size = 0;
+	unpinned = 0;
+}
+
+std::vector<int> NumaPricer::Placement() const {
+	std::vector<int> placement(partitions.size());
+	for (size_t w = 0; w < partitions.size(); w++) {
+		placement[w] = partitions[w]->cpu;
+	}
+	return placement;
+}
+
+/*Loading implementation*/
+bool NumaPricer::Load(const OptionBook& book) {
+	PRICER_PROBE("NumaPricer::Load");
+	Clear();
+	m_size = book.size();
+	size_t workers = std::max(std::min(cpus.size(), (m_size + PARTITION_ALIGN - 1) / PARTITION_ALIGN), (size_t)1);
+	size_t share = (m_size + workers - 1) / workers;
+	share = (share + PARTITION_ALIGN - 1) / PARTITION_ALIGN * PARTITION_ALIGN;
+	bool ok = true;
+	for (size_t w = 0; w < workers; w++) {
+		Partition* part = new Partition();
+		part->cpu = cpus.empty() ? 0 : cpus[w];
+		part->node = topology.NodeOfCpu(part->cpu);
+		part->begin = std::min(w * share, m_size);
+		part->count = std::min(share, m_size - part->begin);
+		part->seconds = 0.0;
+		ok = part->contracts.Allocate(part->count * sizeof(OptionContract), config.huge_pages) && ok;
+		partitions.push_back(part);
+	}
+	if (!ok) {
+		cout << "Out of memory while allocating the partitions of the NUMA pricer" << endl;
+		Clear();
+		return false;
+	}
+	//the thread writing a page first decides its node
+	std::vector<int> placement = Placement();
+	auto copy = [&](size_t w) {
+		Partition& part = *partitions[w];
+		OptionContract* dst = static_cast<OptionContract*>(part.contracts.Data());
+		for (size_t i = 0; i < part.count; i++) {
+			dst[i] = book[part.begin + i];
+		}
+	};
+	if (config.first_touch) {
+		unpinned = RunOnCpus(placement, config.pin, copy);
+	}
+	else {
+		for (size_t w = 0; w < partitions.size(); w++) {
+			copy(w);
+		}
+	}
+	return true;
+}
+
+/*Pricing implementation*/
+void NumaPricer::Price(std::vector<double>& prices) {
+	PRICER_PROBE("NumaPricer::Price");
+	prices.resize(m_size);
+	std::vector<int> placement = Placement();
+	unpinned = RunOnCpus(placement, config.pin, [&](size_t w) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		Partition& part = *partitions[w];
+		const OptionContract* c = static_cast<const OptionContract*>(part.contracts.Data());
+		double* out = prices.empty() ? 0 : &prices[part.begin];
+		for (size_t i = 0; i < part.count; i++) {
+			out[i] = PriceKernel<double>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, c[i].rf, c[i].b);
+		}
+		part.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	});
+	CollectStats();
+}
+
+void NumaPricer::PriceGreeks(unsigned int mask, GreekColumns& columns) {
+	PRICER_PROBE("NumaPricer::PriceGreeks");
+	columns.Resize(mask, m_size);
+	std::vector<int> placement = Placement();
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		unpinned = RunOnCpus(placement, config.pin, [&](size_t w) {
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			Partition& part = *partitions[w];
+			const OptionContract* c = static_cast<const OptionContract*>(part.contracts.Data());
+			OptionOutputs<double> out = OptionOutputs<double>();
+			for (size_t i = 0; i < part.count; i++) {
+				GreeksKernel<Mask>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, c[i].rf, c[i].b, mask, out);
+				columns.Store<Mask>(part.begin + i, out);
+			}
+			part.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		});
+	});
+	CollectStats();
+}
+
+void NumaPricer::CollectStats() {
+	stats.clear();
+	for (size_t n = 0; n < topology.NodeCount(); n++) {
+		NodeStats node = { topology.Node(n).id, 0, 0, 0.0, 0.0 };
+		for (size_t w = 0; w < partitions.size(); w++) {
+			if (partitions[w]->node == node.node) {
+				node.workers++;
+				node.contracts += partitions[w]->count;
+				node.seconds = std::max(node.seconds, partitions[w]->seconds);
+			}
+		}
+		if (node.workers > 0) {
+			node.throughput = (node.seconds > 0.0) ? node.contracts / node.seconds : 0.0;
+			stats.push_back(node);
+		}
+	}
+}
+
+/*Placement and statistics implementation*/
+size_t NumaPricer::size() const {
+	return m_size;
+}
+
+size_t NumaPricer::PartitionCount() const {
+	return partitions.size();
+}
+
+int NumaPricer::PartitionNode(size_t partition) const {
+	return partitions[partition]->node;
+}
+
+int NumaPricer::HugePages() const {
+	int pages = partitions.empty() ? HUGE_PAGES_NONE : HUGE_PAGES_EXPLICIT;
+	for (size_t w = 0; w < partitions.size(); w++) {
+		if (partitions[w]->count > 0) {
+			pages = std::min(pages, partitions[w]->contracts.Pages());
+		}
+	}
+	return pages;
+}
+
+const NumaTopology& NumaPricer::Topology() const {
+	return topology;
+}
+
+const std::vector<NodeStats>& NumaPricer::Stats() const {
+	return stats;
+}
+
+std::string NumaPricer::Report() const {
+	const char* pages[3] = { "small pages", "transparent huge pages", "explicit huge pages" };
+	std::stringstream ss;
+	ss << m_size << " contracts in " << partitions.size() << " partitions on " << pages[HugePages()] << (config.pin ? ", pinned" : ", not pinned");
+	if (config.pin && unpinned > 0) {
+		ss << " (" << unpinned << " workers could not be)";
+	}
+	ss << (config.first_touch ? ", first touch by the workers" : ", copied by the caller") << endl;
+	for (size_t n = 0; n < stats.size(); n++) {
+		ss << stats[n].ToString() << endl;
+	}
+	return ss.str();
+}
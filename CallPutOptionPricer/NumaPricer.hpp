@@ -0,0 +1,160 @@
+/* NUMA aware batch pricing */
+/*****************************************************
+Name: NumaPricer.hpp
+version: 0.1
+Description:
+Placement of large batch runs on multi-socket machines, where a worker streaming contracts out of the memory of
+another socket runs at a fraction of its local bandwidth.
+
+NumaTopology reads the NUMA nodes and their CPUs from /sys/devices/system/node (Linux); elsewhere, or when the
+directory is missing, the machine is one node holding every CPU. Only the CPUs of the process affinity mask
+(AllowedCpus of ParallelFor.hpp) are listed, and nodes left without CPUs are dropped.
+NumaConfig is the runtime configuration of a run:
+	pin: every worker is pinned to one CPU, the workers of a node on the CPUs of that node
+	first_touch: every worker copies its own partition of the contracts, so that the kernel places the pages of
+		the partition on the node of the worker (default local allocation policy); otherwise the calling thread
+		copies every partition and they all land on its node
+	huge_pages: the partitions are backed by transparent huge pages (madvise) or by explicit huge pages
+		(MAP_HUGETLB, which needs pages reserved in /proc/sys/vm/nr_hugepages, falling back to transparent ones),
+		cutting the TLB misses of the streaming loops
+	workers_per_node: 0 uses every CPU of every node
+LargeBuffer is the page-aligned allocation behind the partitions (plain aligned allocation outside Linux).
+
+NumaPricer cuts an OptionBook into one contiguous partition per worker (a multiple of 8 contracts, so that no two
+workers write the same cache line of results), copies each partition into node local memory once in Load, and
+prices or computes the Greeks of every partition on the worker that owns it (RunOnCpus of ParallelFor.hpp).
+Results are written in book order. Every run records the time of each worker; Stats() reports per node the
+contracts priced, the time of its slowest worker and its throughput, so that a node starved by remote memory shows.
+PortfolioAggregator::Placement runs the portfolio aggregation on the pinned workers of a NumaConfig.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef NUMAPRICER_HPP
+#define NUMAPRICER_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "OptionBook.hpp"
+#include "PricingKernels.hpp"
+using namespace std;
+
+enum HugePages {
+	HUGE_PAGES_NONE = 0,
+	HUGE_PAGES_TRANSPARENT = 1,
+	HUGE_PAGES_EXPLICIT = 2
+};
+
+/*Nodes and their CPUs*/
+struct NumaNode {
+	int id;
+	std::vector<int> cpus;
+};
+
+class NumaTopology {
+private:
+	std::vector<NumaNode> nodes;
+
+public:
+	NumaTopology(); //detects the topology of the machine
+	virtual ~NumaTopology();
+
+	size_t NodeCount() const;
+	const NumaNode& Node(size_t index) const;
+	int NodeOfCpu(int cpu) const; //id of the node holding cpu, -1 if unknown
+	std::string ToString() const;
+};
+
+/*Runtime configuration of a run*/
+struct NumaConfig {
+	bool pin;
+	bool first_touch;
+	int huge_pages; //HugePages
+	int workers_per_node; //0: one worker per CPU
+
+	NumaConfig();
+	std::vector<int> Cpus(const NumaTopology& topology) const; //CPUs of the workers, node by node
+};
+
+/*Page aligned buffer, optionally on huge pages. The pages are only placed when first written*/
+class LargeBuffer {
+private:
+	void* data;
+	size_t length; //bytes allocated (rounded up to the page size)
+	int pages; //HugePages obtained
+
+	LargeBuffer(const LargeBuffer& source);
+	LargeBuffer& operator = (const LargeBuffer& source);
+
+public:
+	LargeBuffer();
+	virtual ~LargeBuffer();
+
+	bool Allocate(size_t bytes, int huge_pages); //frees the previous allocation
+	void Release();
+	void* Data() const;
+	size_t size() const;
+	int Pages() const;
+};
+
+/*Throughput of the workers of one node in the last run*/
+struct NodeStats {
+	int node;
+	size_t workers;
+	size_t contracts;
+	double seconds; //slowest worker of the node
+	double throughput; //contracts per second
+
+	std::string ToString() const;
+};
+
+class NumaPricer {
+private:
+	struct Partition {
+		int cpu, node;
+		size_t begin, count; //book range
+		LargeBuffer contracts;
+		double seconds; //last run
+	};
+
+	NumaConfig config;
+	NumaTopology topology;
+	std::vector<int> cpus;
+	std::vector<Partition*> partitions;
+	size_t m_size;
+	size_t unpinned; //workers of the last run that could not be pinned
+	std::vector<NodeStats> stats;
+
+	NumaPricer(const NumaPricer& source);
+	NumaPricer& operator = (const NumaPricer& source);
+
+	void Clear();
+	std::vector<int> Placement() const; //CPU of the worker of every partition
+	void CollectStats();
+
+public:
+	/*Constructor and destructor*/
+	NumaPricer(const NumaConfig& p_config = NumaConfig());
+	virtual ~NumaPricer();
+
+	/*Copies the contracts of the book into the partitions. Must be called again when the book changes*/
+	bool Load(const OptionBook& book);
+
+	/*Runs, results in book order*/
+	void Price(std::vector<double>& prices);
+	void PriceGreeks(unsigned int mask, GreekColumns& columns);
+
+	/*Placement and statistics*/
+	size_t size() const;
+	size_t PartitionCount() const;
+	int PartitionNode(size_t partition) const;
+	int HugePages() const; //huge pages obtained by every partition (the weakest of them)
+	const NumaTopology& Topology() const;
+	const std::vector<NodeStats>& Stats() const; //last run
+	std::string Report() const;
+};
+
+#endif
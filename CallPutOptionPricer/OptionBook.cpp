@@ -0,0 +1,216 @@
+/* Option book implementation */
+/*****************************************************
+Name: OptionBook.cpp
+version: 0.1
+Description:
+Implementation of the functions in OptionBook.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "OptionBook.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static_assert(std::is_trivially_copyable<OptionContract>::value, "OptionContract must stay a plain record");
+static_assert(sizeof(OptionContract) == 64, "OptionContract is meant to fill exactly one cache line");
+
+/*Cache line aligned block allocation*/
+static OptionContract* AllocateBlock(size_t count) {
+	void* p = 0;
+#ifdef _WIN32
+	p = _aligned_malloc(count * sizeof(OptionContract), 64);
+#else
+	if (posix_memalign(&p, 64, count * sizeof(OptionContract)) != 0) {
+		p = 0;
+	}
+#endif
+	return static_cast<OptionContract*>(p);
+}
+
+static void FreeBlock(OptionContract* p) {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+/*Constructor and destructor implementation*/
+OptionBook::OptionBook(size_t p_block_shift) : block_shift(p_block_shift), block_mask(((size_t)1 << p_block_shift) - 1), m_size(0), m_version(0) {
+
+}
+
+OptionBook::~OptionBook() {
+	Release();
+}
+
+/*Adding contracts implementation*/
+OptionContract* OptionBook::Slot() {
+	size_t block = m_size >> block_shift;
+	if (block == blocks.size()) {
+		OptionContract* p = AllocateBlock(block_mask + 1);
+		if (p == 0) {
+			cout << "Out of memory while allocating a block of the option book" << endl;
+			return 0;
+		}
+		blocks.push_back(p);
+	}
+	return &blocks[block][m_size & block_mask];
+}
+
+size_t OptionBook::Add(const OptionContract& contract) {
+	OptionContract* slot = Slot();
+	if (slot == 0) {
+		return m_size;
+	}
+	*slot = contract;
+	m_version++;
+	return m_size++;
+}
+
+size_t OptionBook::Add(const EuOptCall& option, double S, double qty) {
+	OptionContract c;
+	c.S = S;
+	c.K = option.strike();
+	c.T = option.maturity();
+	c.sig = option.sigma();
+	c.rf = option.rate();
+	c.b = option.CostOfCarry();
+	c.qty = qty;
+	c.underlying = UnderlyingIndex(option.Underlying());
+	c.type = EU_CALL;
+	return Add(c);
+}
+
+size_t OptionBook::Add(const EuOptPut& option, double S, double qty) {
+	OptionContract c;
+	c.S = S;
+	c.K = option.strike();
+	c.T = option.maturity();
+	c.sig = option.sigma();
+	c.rf = option.rate();
+	c.b = option.CostOfCarry();
+	c.qty = qty;
+	c.underlying = UnderlyingIndex(option.Underlying());
+	c.type = EU_PUT;
+	return Add(c);
+}
+
+bool OptionBook::Load(const OptionContract* contracts, size_t count) {
+	if (count > (size_t)-1 / sizeof(OptionContract) - m_size) {
+		cout << "Too many contracts to load into the option book: " << count << endl;
+		return false; //nothing appended
+	}
+	if (!Reserve(m_size + count)) {
+		return false; //nothing appended
+	}
+	while (count > 0) {
+		size_t offset = m_size & block_mask;
+		size_t chunk = block_mask + 1 - offset; //room left in the current block
+		if (chunk > count) {
+			chunk = count;
+		}
+		memcpy(&blocks[m_size >> block_shift][offset], contracts, chunk * sizeof(OptionContract));
+		contracts += chunk;
+		count -= chunk;
+		m_size += chunk;
+	}
+	m_version++;
+	return true;
+}
+
+bool OptionBook::Reserve(size_t count) {
+	size_t needed = (count + block_mask) >> block_shift;
+	while (blocks.size() < needed) {
+		OptionContract* p = AllocateBlock(block_mask + 1);
+		if (p == 0) {
+			cout << "Out of memory while allocating a block of the option book" << endl;
+			return false;
+		}
+		blocks.push_back(p);
+	}
+	return true;
+}
+
+/*Releasing contracts implementation*/
+void OptionBook::Clear() {
+	m_size = 0;
+	m_version++;
+}
+
+void OptionBook::Release() {
+	for (size_t i = 0; i < blocks.size(); i++) {
+		FreeBlock(blocks[i]);
+	}
+	blocks.clear();
+	m_size = 0;
+	m_version++;
+}
+
+/*Underlying names implementation*/
+unsigned int OptionBook::UnderlyingIndex(const std::string& name) {
+	std::unordered_map<std::string, unsigned int>::const_iterator it = name_index.find(name);
+	if (it != name_index.end()) {
+		return it->second;
+	}
+	unsigned int index = (unsigned int)names.size();
+	names.push_back(name);
+	name_index[name] = index;
+	return index;
+}
+
+const std::string& OptionBook::UnderlyingName(unsigned int index) const {
+	return names[index];
+}
+
+size_t OptionBook::UnderlyingCount() const {
+	return names.size();
+}
+
+/*Access to the contracts implementation*/
+size_t OptionBook::size() const {
+	return m_size;
+}
+
+OptionContract& OptionBook::operator [] (size_t i) {
+	m_version++; //the caller may write the record
+	return blocks[i >> block_shift][i & block_mask];
+}
+
+const OptionContract& OptionBook::operator [] (size_t i) const {
+	return blocks[i >> block_shift][i & block_mask];
+}
+
+size_t OptionBook::BlockCount() const {
+	return (m_size + block_mask) >> block_shift;
+}
+
+size_t OptionBook::BlockLength(size_t block) const {
+	size_t start = block << block_shift;
+	return (m_size - start > block_mask) ? block_mask + 1 : m_size - start;
+}
+
+const OptionContract* OptionBook::Block(size_t block) const {
+	return blocks[block];
+}
+
+OptionContract* OptionBook::Block(size_t block) {
+	m_version++; //the caller may write the records
+	return blocks[block];
+}
+
+size_t OptionBook::MemoryUsage() const {
+	return blocks.size() * (block_mask + 1) * sizeof(OptionContract);
+}
+
+unsigned long long OptionBook::Version() const {
+	return m_version;
+}
@@ -0,0 +1,84 @@
+/* Option book */
+/*****************************************************
+Name: OptionBook.hpp
+version: 0.1
+Description:
+Container for large books of contracts stored as compact OptionContract records (see OptionData.hpp).
+
+The records live in a few large, cache line aligned blocks handed out by an arena: adding a contract
+never allocates except when a block is full, Clear() drops every contract in O(1) and keeps the blocks
+for the next load, and batch pricers stream through the blocks without pointer chasing.
+Underlying names are stored once in the book and the records only keep their index.
+Version() is bumped by every call that may change the contracts (Add, Load, Clear, Release and the non-const
+operator [] and Block, which hand out writable records), so that engines keeping a copy of the contracts
+(PortfolioAggregator placed workers) can tell when it is stale.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef OPTIONBOOK_HPP
+#define OPTIONBOOK_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "OptionData.hpp"
+#include "EUOptionCall.hpp"
+#include "EUOptionPut.hpp"
+using namespace std;
+
+class OptionBook {
+private:
+	/*Arena of fixed size blocks: contract i lives in blocks[i >> block_shift][i & block_mask]*/
+	std::vector<OptionContract*> blocks;
+	size_t block_shift; //log2 of the number of contracts per block
+	size_t block_mask;
+	size_t m_size; //number of contracts in the book
+	unsigned long long m_version; //bumped by every mutation
+
+	/*Underlying names and their index*/
+	std::vector<std::string> names;
+	std::unordered_map<std::string, unsigned int> name_index;
+
+	/*The book owns its blocks, copies are not allowed*/
+	OptionBook(const OptionBook& source);
+	OptionBook& operator = (const OptionBook& source);
+
+	OptionContract* Slot(); //returns the next free record, allocating a block if needed
+
+public:
+	/*Constructor and destructor*/
+	OptionBook(size_t block_shift = 14); //2^14 contracts (1 MB) per block by default
+	virtual ~OptionBook();
+
+	/*Adding contracts*/
+	size_t Add(const OptionContract& contract);
+	size_t Add(const EuOptCall& option, double S, double qty = 1.0);
+	size_t Add(const EuOptPut& option, double S, double qty = 1.0);
+	bool Load(const OptionContract* contracts, size_t count); //bulk append with one copy per block, false and nothing appended if the blocks cannot be allocated
+	bool Reserve(size_t count); //allocates the blocks for count contracts up front, false if out of memory
+
+	/*Releasing contracts*/
+	void Clear(); //O(1): empties the book but keeps the blocks and the underlying names
+	void Release(); //frees every block
+
+	/*Underlying names*/
+	unsigned int UnderlyingIndex(const std::string& name); //returns the index of name, adding it if needed
+	const std::string& UnderlyingName(unsigned int index) const;
+	size_t UnderlyingCount() const;
+
+	/*Access to the contracts*/
+	size_t size() const;
+	OptionContract& operator [] (size_t i);
+	const OptionContract& operator [] (size_t i) const;
+	size_t BlockCount() const; //number of blocks holding contracts
+	size_t BlockLength(size_t block) const; //number of contracts in a block
+	const OptionContract* Block(size_t block) const;
+	OptionContract* Block(size_t block);
+	size_t MemoryUsage() const; //bytes held by the blocks
+	unsigned long long Version() const; //changes whenever the contracts may have changed
+};
+
+#endif
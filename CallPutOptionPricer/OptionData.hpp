@@ -1,6 +1,9 @@
 //OptionData.hpp
 //This header file contains the structure definition for options parameters
 
+#ifndef OPTIONDATA_HPP
+#define OPTIONDATA_HPP
+
 #ifdef __cplusplus
 extern "C" { // Declare as extern "C" if used from C++
 #endif
@@ -13,6 +16,35 @@ typedef struct __OptionData {
 	double b; //cost of carry that will equal rf for stock options
 } OptionData;
 
+typedef struct __OptionDataF { //single precision copy of OptionData used by the float pricing path
+	float rf; //risk-free interest rate
+	float sig; //volatility
+	float K; //strike price
+	float T; //expiry time/maturity expressed in years
+	float b; //cost of carry that will equal rf for stock options
+} OptionDataF;
+
+typedef enum __OptionType {
+	EU_CALL = 0, //European call
+	EU_PUT = 1, //European put
+	US_CALL = 2, //perpetual American call (T is ignored)
+	US_PUT = 3 //perpetual American put (T is ignored)
+} OptionType;
+
+typedef struct __OptionContract { //compact, trivially copyable contract record stored by OptionBook (64 bytes, one cache line)
+	double S; //current price of the underlying
+	double K; //strike price
+	double T; //expiry time/maturity expressed in years
+	double sig; //volatility
+	double rf; //risk-free interest rate
+	double b; //cost of carry
+	double qty; //position quantity (negative for short positions)
+	unsigned int underlying; //index of the underlying name in the book
+	int type; //OptionType
+} OptionContract;
+
 #ifdef __cplusplus
 }
 #endif
+
+#endif
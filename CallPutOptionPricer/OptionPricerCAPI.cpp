@@ -0,0 +1,216 @@
+/* C interface of the pricer implementation */
+/*****************************************************
+Name: OptionPricerCAPI.cpp
+version: 0.3
+Description:
+Implementation of the functions in OptionPricerCAPI.h
+
+Change history:
+0.1 Initial version
+0.2 op_greeks computes the requested Greeks in one pass through GreeksKernel
+0.3 Implied vols solved on the time value, NaN when the vol cannot be identified
+
+******************************************************/
+
+#define OPTIONPRICER_BUILD
+#include "OptionPricerCAPI.h"
+#include "OptionData.hpp"
+#include "PricingKernels.hpp"
+#include "ParallelFor.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+static const size_t CAPI_BLOCK = 4096; //contracts per task handed to ParallelFor
+static const double CAPI_NAN = std::numeric_limits<double>::quiet_NaN();
+static const double US_BUMP = 1e-4; //relative bump of the perpetual finite differences
+static const double IV_TOLERANCE = 1e-12; //implied vol price tolerance, relative to the time value
+static const double IV_ROUNDING = 4.0 * std::numeric_limits<double>::epsilon(); //rounding of a price, relative to max(S, K)
+static const double IV_VOL_RESOLUTION = 1e-8; //largest vol error the price tolerance may leave
+
+/*Runs body(begin, end) over [0, n) in blocks, on the calling thread for small batches*/
+template <typename Body>
+static void ForBlocks(size_t n, int threads, Body body) {
+	if (threads == 1 || n < 2 * CAPI_BLOCK) {
+		body(0, n);
+		return;
+	}
+	size_t blocks = (n + CAPI_BLOCK - 1) / CAPI_BLOCK;
+	ParallelFor(blocks, threads, [&](size_t block) {
+		body(block * CAPI_BLOCK, std::min(n, (block + 1) * CAPI_BLOCK));
+	});
+}
+
+static bool KnownType(int type) {
+	return type >= EU_CALL && type <= US_PUT;
+}
+
+/*Vega of one contract: closed form for the European types, central difference for the perpetual ones*/
+static double VegaKernel(int type, double S, double K, double T, double sig, double rf, double b) {
+	if (type == EU_CALL || type == EU_PUT) {
+		double d1 = (log(S / K) + (b + (sig*sig)*0.5) * T) / (sig * sqrt(T));
+		return S * sqrt(T) * exp((b - rf)*T) * NormPdf(d1);
+	}
+	double h = US_BUMP * sig;
+	return (PriceKernel(type, S, K, T, sig + h, rf, b) - PriceKernel(type, S, K, T, sig - h, rf, b)) / (2.0 * h);
+}
+
+/*Safeguarded Newton: Newton steps on the vega, falling back to bisection when a step leaves the bracket.
+An in the money European option is inverted on the out of the money side through put-call parity
+(C - P = S e^((b-r)T) - K e^(-rT)), so that the solve works on the time value instead of a price dominated by the
+intrinsic value. The price tolerance is relative to the time value with a floor at the rounding of the price; a vol
+that this tolerance cannot pin down to IV_VOL_RESOLUTION (vega too small: deep in or out of the money, or a
+perpetual option in its exercise region) is NaN, as is a solve that does not converge*/
+static double ImpliedVolKernel(int type, double price, double S, double K, double T, double rf, double b) {
+	double intrinsic, scale;
+	if (type == EU_CALL || type == EU_PUT) {
+		double forward = S * exp((b - rf) * T); //discounted forward
+		double strike = K * exp(-rf * T); //discounted strike
+		if ((type == EU_CALL) ? forward > strike : strike > forward) {
+			price -= fabs(forward - strike);
+			type = (type == EU_CALL) ? EU_PUT : EU_CALL;
+		}
+		intrinsic = 0.0;
+		scale = std::max(forward, strike);
+	}
+	else {
+		intrinsic = std::max((type == US_CALL) ? S - K : K - S, 0.0);
+		scale = std::max(S, K);
+	}
+	double lo = OP_MIN_VOL, hi = OP_MAX_VOL;
+	double f_lo = PriceKernel(type, S, K, T, lo, rf, b) - price;
+	double f_hi = PriceKernel(type, S, K, T, hi, rf, b) - price;
+	if (!(f_lo <= 0.0 && f_hi >= 0.0)) { //the price is monotone increasing in sig
+		return CAPI_NAN;
+	}
+	double tol = std::max(IV_TOLERANCE * (price - intrinsic), IV_ROUNDING * scale);
+	double sig = 0.5 * (lo + hi);
+	if (type == EU_CALL || type == EU_PUT) { //start from the at-the-money-forward inflexion point
+		sig = std::min(std::max(sqrt(2.0 * fabs(log(S / K) + b * T) / T), 0.1), hi);
+	}
+	for (int it = 0; it < 100; it++) {
+		double f = PriceKernel(type, S, K, T, sig, rf, b) - price;
+		double vega = VegaKernel(type, S, K, T, sig, rf, b);
+		if (fabs(f) <= tol) {
+			return (tol <= IV_VOL_RESOLUTION * vega) ? sig : CAPI_NAN;
+		}
+		if (f < 0.0) {
+			lo = sig;
+		}
+		else {
+			hi = sig;
+		}
+		double next = (vega > 0.0) ? sig - f / vega : lo - 1.0;
+		sig = (next > lo && next < hi) ? next : 0.5 * (lo + hi);
+		if (hi - lo < 1e-15) { //the bracket collapsed without reaching the tolerance
+			return CAPI_NAN;
+		}
+	}
+	return CAPI_NAN;
+}
+
+/*C interface*/
+extern "C" {
+
+int op_api_version(void) {
+	return OP_API_VERSION;
+}
+
+int op_price(size_t n, const int* type, const double* S, const double* K, const double* T,
+	const double* sig, const double* rf, const double* b, double* out, int threads) {
+	PRICER_PROBE("op_price");
+	if (n == 0) {
+		return OP_OK;
+	}
+	if (!type || !S || !K || !T || !sig || !rf || !b || !out) {
+		return OP_ERROR_NULL_POINTER;
+	}
+	std::atomic<bool> bad_type(false);
+	ForBlocks(n, threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (!KnownType(type[i])) {
+				out[i] = CAPI_NAN;
+				bad_type = true;
+				continue;
+			}
+			out[i] = PriceKernel(type[i], S[i], K[i], T[i], sig[i], rf[i], b[i]);
+		}
+	});
+	return bad_type ? OP_ERROR_BAD_TYPE : OP_OK;
+}
+
+int op_greeks(size_t n, const int* type, const double* S, const double* K, const double* T,
+	const double* sig, const double* rf, const double* b,
+	double* delta, double* gamma, double* vega, double* theta, double* rho, int threads) {
+	PRICER_PROBE("op_greeks");
+	if (n == 0) {
+		return OP_OK;
+	}
+	if (!type || !S || !K || !T || !sig || !rf || !b) {
+		return OP_ERROR_NULL_POINTER;
+	}
+	//only the Greeks with an output array are computed, in one pass per contract
+	unsigned int mask = (delta ? OUT_DELTA : 0) | (gamma ? OUT_GAMMA : 0) | (vega ? OUT_VEGA : 0) | (theta ? OUT_THETA : 0) | (rho ? OUT_RHO : 0);
+	std::atomic<bool> bad_type(false);
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		ForBlocks(n, threads, [&](size_t begin, size_t end) {
+			OptionOutputs<double> out = OptionOutputs<double>();
+			for (size_t i = begin; i < end; i++) {
+				if (!KnownType(type[i])) {
+					out.delta = out.gamma = out.vega = out.theta = out.rho = CAPI_NAN;
+					bad_type = true;
+				}
+				else {
+					GreeksKernel<Mask>(type[i], S[i], K[i], T[i], sig[i], rf[i], b[i], mask, out);
+				}
+				if (Mask & mask & OUT_DELTA) delta[i] = out.delta;
+				if (Mask & mask & OUT_GAMMA) gamma[i] = out.gamma;
+				if (Mask & mask & OUT_VEGA) vega[i] = out.vega;
+				if (Mask & mask & OUT_THETA) theta[i] = out.theta;
+				if (Mask & mask & OUT_RHO) rho[i] = out.rho;
+			}
+		});
+	});
+	return bad_type ? OP_ERROR_BAD_TYPE : OP_OK;
+}
+
+int op_implied_vol(size_t n, const int* type, const double* price, const double* S, const double* K,
+	const double* T, const double* rf, const double* b, double* vol, size_t* failures, int threads) {
+	PRICER_PROBE("op_implied_vol");
+	if (failures) {
+		*failures = 0;
+	}
+	if (n == 0) {
+		return OP_OK;
+	}
+	if (!type || !price || !S || !K || !T || !rf || !b || !vol) {
+		return OP_ERROR_NULL_POINTER;
+	}
+	std::atomic<bool> bad_type(false);
+	std::atomic<size_t> failed(0);
+	ForBlocks(n, threads, [&](size_t begin, size_t end) {
+		size_t local = 0;
+		for (size_t i = begin; i < end; i++) {
+			if (!KnownType(type[i])) {
+				vol[i] = CAPI_NAN;
+				bad_type = true;
+				local++;
+				continue;
+			}
+			vol[i] = ImpliedVolKernel(type[i], price[i], S[i], K[i], T[i], rf[i], b[i]);
+			if (vol[i] != vol[i]) {
+				local++;
+			}
+		}
+		failed += local;
+	});
+	if (failures) {
+		*failures = failed;
+	}
+	return bad_type ? OP_ERROR_BAD_TYPE : OP_OK;
+}
+
+}
@@ -0,0 +1,83 @@
+/* C interface of the pricer */
+/*****************************************************
+Name: OptionPricerCAPI.h
+version: 0.3
+Description:
+Stable C ABI over the pricing kernels (PricingKernels.hpp) for callers outside C++: a shared library built from
+OptionPricerCAPI.cpp can be loaded from C, from Python through ctypes (python/option_pricer.py) or from any
+language with a C foreign function interface.
+
+Every function works on caller owned arrays of n elements, one array per parameter (structure of arrays), so a
+NumPy column or a C buffer is used in place without any copy or per element call. Parameters follow OptionData:
+	type: OptionType (EU_CALL, EU_PUT, US_CALL, US_PUT), T is ignored for the perpetual types
+	S: spot, K: strike, T: maturity in years, sig: volatility, rf: risk-free rate, b: cost of carry
+threads is the number of threads used for the batch: 1 prices on the calling thread, <= 0 uses the hardware
+concurrency. Small batches are always priced on the calling thread.
+
+The functions return OP_OK or a negative OP_ERROR_ code and never throw. The header is plain C89 and does not
+depend on any C++ header.
+
+Change history:
+0.1 Initial version
+0.2 op_greeks only computes the requested Greeks
+0.3 op_implied_vol returns NaN when the price does not identify the vol
+
+******************************************************/
+
+#ifndef OPTIONPRICERCAPI_H
+#define OPTIONPRICERCAPI_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(OPTIONPRICER_BUILD)
+#define OPTIONPRICER_API __declspec(dllexport)
+#else
+#define OPTIONPRICER_API __declspec(dllimport)
+#endif
+#else
+#define OPTIONPRICER_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OP_API_VERSION 1
+
+/*Status codes*/
+#define OP_OK 0
+#define OP_ERROR_NULL_POINTER -1 /*a required array is NULL*/
+#define OP_ERROR_BAD_TYPE -2 /*an element has an unknown option type, its outputs are set to NaN*/
+
+/*Version of the ABI the library was built with (OP_API_VERSION)*/
+OPTIONPRICER_API int op_api_version(void);
+
+/*Prices: out[i] = price of contract i*/
+OPTIONPRICER_API int op_price(size_t n, const int* type, const double* S, const double* K, const double* T,
+	const double* sig, const double* rf, const double* b, double* out, int threads);
+
+/*Greeks of contract i. Any output array may be NULL when that Greek is not needed.
+delta, gamma: first and second derivatives in S
+vega: derivative in sig
+theta: minus the derivative in T (0 for the perpetual types)
+rho: derivative in rf with rf - b kept fixed (the carry moves with the rate, as for a stock with a dividend yield)
+Only the Greeks with an output array are computed, in one pass (GreeksKernel of PricingKernels.hpp).*/
+OPTIONPRICER_API int op_greeks(size_t n, const int* type, const double* S, const double* K, const double* T,
+	const double* sig, const double* rf, const double* b,
+	double* delta, double* gamma, double* vega, double* theta, double* rho, int threads);
+
+/*Implied volatilities: vol[i] reprices price[i]. Elements without a solution in [OP_MIN_VOL, OP_MAX_VOL] (price
+outside the no-arbitrage bounds), or whose price does not identify the vol to 1e-8 (vega too small for the rounding of
+the price: deep in or out of the money, perpetual contracts in their exercise region), are set to NaN and counted in
+*failures when failures is not NULL.*/
+#define OP_MIN_VOL 1e-4
+#define OP_MAX_VOL 5.0
+OPTIONPRICER_API int op_implied_vol(size_t n, const int* type, const double* price, const double* S, const double* K,
+	const double* T, const double* rf, const double* b, double* vol, size_t* failures, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
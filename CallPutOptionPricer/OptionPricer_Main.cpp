@@ -11,12 +11,13 @@
 #include "Batch2.hpp"
 #include "Batch3.hpp"
 #include "Batch4.hpp"
+#include "Demos.hpp"
 #define NL cout << endl;
 
 int main() {
 	
 	int batch_number;
-	cout << "Please, input the number of batch you would like to test...\n> ";
+	cout << "Please, input the number of batch you would like to test (1-4) or of a demo:\n5. Float/mixed precision pricing\n6. Option book\n7. Instrumentation\n8. Scenario VaR\n9. Chebyshev tables\n10. Grouped pricing\n11. Fourier chain pricing\n12. Volatility surface\n13. Rate and carry curves\n14. Smile calibration\n15. Pricing service\n16. Market data feed\n17. Selective Greeks\n18. Portfolio aggregation\n19. Asynchronous pricing\n20. NUMA placement\n21. Asian and lookback options\n22. Multilevel Monte Carlo\n23. Delta hedging backtest\n24. Exotic options\n> ";
 	cin >> batch_number;
 	NL;
 	switch (batch_number) {
@@ -32,8 +33,68 @@ int main() {
 	case 4:
 		Batch4();
 		break;
+	case 5:
+		PrecisionDemo();
+		break;
+	case 6:
+		BookDemo();
+		break;
+	case 7:
+		InstrumentationDemo();
+		break;
+	case 8:
+		ScenarioDemo();
+		break;
+	case 9:
+		ChebyshevDemo();
+		break;
+	case 10:
+		GroupedDemo();
+		break;
+	case 11:
+		FourierDemo();
+		break;
+	case 12:
+		VolSurfaceDemo();
+		break;
+	case 13:
+		TermCurveDemo();
+		break;
+	case 14:
+		CalibrationDemo();
+		break;
+	case 15:
+		ServiceDemo();
+		break;
+	case 16:
+		MarketDataDemo();
+		break;
+	case 17:
+		SelectiveGreeksDemo();
+		break;
+	case 18:
+		AggregationDemo();
+		break;
+	case 19:
+		AsyncPricingDemo();
+		break;
+	case 20:
+		NumaDemo();
+		break;
+	case 21:
+		PathDependentDemo();
+		break;
+	case 22:
+		MultilevelDemo();
+		break;
+	case 23:
+		HedgingDemo();
+		break;
+	case 24:
+		ExoticDemo();
+		break;
 	default:
-		cout << "Invalid input. Enter an integer 1 through 4..." << endl;
+		cout << "Invalid input. Enter an integer 1 through 24..." << endl;
 	}
 
 	//S = 105, T = 0.5, r = 0.1, b = 0 and sig = 0.36 (exact delta call = 0.5946, delta put = -0.3566).
@@ -78,6 +139,13 @@ int main() {
 	for (int i = 0; i <= 5; i++) {
 		cout << "Call delta @t" << i << ": " << mesh_call[i] << endl;
 	}
+	NL;
+	cout << "Computing call delta and gamma ladders from a shared price grid (h = mesh size)..." << endl;
+	std::vector<double> ladder_delta, ladder_gamma;
+	GreeksCall.GreeksLadderDDM(incr, 3, S, end_S, ladder_delta, ladder_gamma); //(120-105)/5 = 3, so S-h and S+h are grid nodes
+	for (int i = 0; i <= 5; i++) {
+		cout << "Call delta/gamma @t" << i << ": " << ladder_delta[i] << " / " << ladder_gamma[i] << endl;
+	}
 
 	return 0;
 }
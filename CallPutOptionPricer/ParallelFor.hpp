@@ -0,0 +1,134 @@
+/* Parallel loop helper */
+/*****************************************************
+Name: ParallelFor.hpp
+version: 0.4
+Description:
+Minimal fork-join loop shared by the multithreaded engines. ParallelFor(count, threads, body) runs body(i) for
+every i in [0, count) on up to threads workers (the hardware concurrency when threads <= 0), the calling thread
+being one of them. Indices are handed out one at a time with an atomic counter, so uneven work items balance
+themselves; body must be safe to call concurrently for different indices.
+AllowedCpus() lists the CPUs of the process affinity mask (sched_getaffinity on Linux, 0 to the hardware concurrency
+- 1 elsewhere); ids can be sparse when CPUs are offline or the process runs under taskset or a cpuset.
+PinThread(cpu) binds the calling thread to a CPU and returns false, leaving the thread where it was, when cpu is not
+in the affinity mask or the call fails (always false outside Linux). AllowedCpu(i) is the i-th allowed CPU, wrapping
+around the mask, for callers that number their threads.
+RunOnCpus(cpus, body) starts one worker per entry of cpus, pins worker w to cpus[w] (when pin is set) and runs
+body(w) on it: unlike ParallelFor the work of a worker is fixed, so the data a worker first touches is the data it
+works on in every later call (NumaPricer.hpp). It returns the number of workers that could not be pinned.
+
+Change history:
+0.1 Initial version (moved out of ScenarioEngine.cpp)
+0.2 PinThread (moved out of PricingService.cpp)
+0.3 RunOnCpus
+0.4 PinThread checks the CPU against the affinity mask and reports failure (AllowedCpus, AllowedCpu)
+
+******************************************************/
+
+#ifndef PARALLELFOR_HPP
+#define PARALLELFOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+/*Runs body(i) for i in [0, count) on the worker threads, handing out indices with an atomic counter*/
+template <typename Body>
+inline void ParallelFor(size_t count, int threads, Body body) {
+	int n = (threads > 0) ? threads : (int)std::thread::hardware_concurrency();
+	if (n < 1) {
+		n = 1;
+	}
+	if ((size_t)n > count) {
+		n = (int)count;
+	}
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (int t = 1; t < n; t++) {
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				body(i);
+			}
+		}));
+	}
+	for (size_t i = next++; i < count; i = next++) {
+		body(i);
+	}
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+}
+
+/*CPUs the process may run on, in increasing order*/
+inline std::vector<int> AllowedCpus() {
+	std::vector<int> cpus;
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(getpid(), sizeof(set), &set) == 0) { //mask of the process, not of a thread pinned earlier
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &set)) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+#endif
+	if (cpus.empty()) {
+		int n = std::max((int)std::thread::hardware_concurrency(), 1);
+		for (int cpu = 0; cpu < n; cpu++) {
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+/*The index-th allowed CPU, wrapping around the affinity mask*/
+inline int AllowedCpu(size_t index) {
+	std::vector<int> cpus = AllowedCpus();
+	return cpus[index % cpus.size()];
+}
+
+/*Pins the calling thread to a CPU, false if the CPU is not in the affinity mask of the process*/
+inline bool PinThread(int cpu) {
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (cpu < 0 || cpu >= CPU_SETSIZE || sched_getaffinity(getpid(), sizeof(set), &set) != 0 || !CPU_ISSET(cpu, &set)) {
+		return false;
+	}
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)cpu; //affinity is only set on Linux
+	return false;
+#endif
+}
+
+/*Runs body(w) for every worker w on its own thread, pinned to cpus[w] if pin, and waits for all of them.
+Returns the number of workers left unpinned because their CPU was not allowed*/
+template <typename Body>
+inline size_t RunOnCpus(const std::vector<int>& cpus, bool pin, Body body) {
+	std::atomic<size_t> unpinned(0);
+	std::vector<std::thread> workers;
+	for (size_t w = 0; w < cpus.size(); w++) {
+		workers.push_back(std::thread([&, w]() {
+			if (pin && !PinThread(cpus[w])) {
+				unpinned++;
+			}
+			body(w);
+		}));
+	}
+	for (size_t w = 0; w < workers.size(); w++) {
+		workers[w].join();
+	}
+	return unpinned;
+}
+
+#endif
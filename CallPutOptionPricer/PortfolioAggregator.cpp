@@ -0,0 +1,371 @@
+/* Portfolio aggregation implementation */
+/*****************************************************
+Name: PortfolioAggregator.cpp
+version: 0.3
+Description:
+Implementation of the functions in PortfolioAggregator.hpp
+
+Change history:
+0.1 Initial version
+0.2 Worker placement (Placement)
+0.3 Fixed, first touched task ranges per placed worker
+
+******************************************************/
+
+#include "PortfolioAggregator.hpp"
+#include "Instrumentation.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <utility>
+
+/*Cell key: book (16 bits), underlying (32 bits), bucket (16 bits), so that sorting the keys sorts the cells*/
+static unsigned long long CellKey(unsigned int book, unsigned int underlying, unsigned int bucket) {
+	return ((unsigned long long)book << 48) | ((unsigned long long)underlying << 16) | bucket;
+}
+
+/*Exposure implementation*/
+void Exposure::Add(const Exposure& other) {
+	value += other.value;
+	delta += other.delta;
+	gamma += other.gamma;
+	vega += other.vega;
+	theta += other.theta;
+	rho += other.rho;
+	positions += other.positions;
+}
+
+std::string Exposure::ToString() const {
+	std::stringstream ss;
+	ss << "value " << value << ", delta " << delta << ", gamma " << gamma << ", vega " << vega << ", theta " << theta << ", rho " << rho
+		<< " (" << positions << " positions)";
+	return ss.str();
+}
+
+/*Constructor and destructor implementation*/
+PortfolioAggregator::PortfolioAggregator(unsigned int p_mask, int p_threads)
+	: mask(p_mask | OUT_PRICE), m_threads(p_threads), pin(false), first_touch(false), huge_pages(HUGE_PAGES_NONE) {
+	const double default_edges[] = { 0.25, 0.5, 1.0, 2.0, 5.0, 10.0 };
+	edges.assign(default_edges, default_edges + 6);
+	total = Exposure();
+}
+
+PortfolioAggregator::PortfolioAggregator(const std::vector<double>& bucket_edges, unsigned int p_mask, int p_threads)
+	: edges(bucket_edges), mask(p_mask | OUT_PRICE), m_threads(p_threads), pin(false), first_touch(false), huge_pages(HUGE_PAGES_NONE) {
+	std::sort(edges.begin(), edges.end());
+	total = Exposure();
+}
+
+PortfolioAggregator::~PortfolioAggregator() {
+	ClearPartitions();
+}
+
+/*Books implementation*/
+unsigned int PortfolioAggregator::AddBook(const std::string& name, const OptionBook& book) {
+	BookEntry entry;
+	entry.name = name;
+	entry.book = &book;
+	books.push_back(entry);
+	ClearPartitions(); //placed again by the next Run
+	return (unsigned int)(books.size() - 1);
+}
+
+size_t PortfolioAggregator::BookCount() const {
+	return books.size();
+}
+
+const std::string& PortfolioAggregator::BookName(unsigned int book) const {
+	return books[book].name;
+}
+
+int PortfolioAggregator::threads() const {
+	return m_threads;
+}
+
+void PortfolioAggregator::threads(int new_threads) {
+	m_threads = new_threads;
+	cpus.clear();
+	ClearPartitions();
+}
+
+void PortfolioAggregator::Placement(const NumaConfig& config) {
+	NumaTopology topology;
+	cpus = config.Cpus(topology);
+	pin = config.pin;
+	first_touch = config.first_touch;
+	huge_pages = config.huge_pages;
+	ClearPartitions();
+}
+
+void PortfolioAggregator::ClearPartitions() {
+	for (size_t w = 0; w < partitions.size(); w++) {
+		delete partitions[w];
+	}
+	partitions.clear();
+}
+
+void PortfolioAggregator::Place(const std::vector<Task>& tasks) {
+	PRICER_PROBE("PortfolioAggregator::Place");
+	ClearPartitions();
+	size_t contracts = 0;
+	for (size_t t = 0; t < tasks.size(); t++) {
+		contracts += books[tasks[t].book].book->BlockLength(tasks[t].block);
+	}
+	//contiguous ranges of tasks holding about the same number of contracts
+	size_t workers = std::max(std::min(cpus.size(), tasks.size()), (size_t)1);
+	size_t t = 0, done = 0;
+	bool ok = true;
+	for (size_t w = 0; w < workers; w++) {
+		Partition* part = new Partition();
+		part->first_task = t;
+		size_t target = (w + 1 == workers) ? contracts : contracts * (w + 1) / workers;
+		size_t count = 0;
+		while (t < tasks.size()) {
+			size_t len = books[tasks[t].book].book->BlockLength(tasks[t].block);
+			if (w + 1 < workers && done + len / 2 >= target) { //cut at the block edge closest to the target
+				break;
+			}
+			part->offsets.push_back(count);
+			count += len;
+			done += len;
+			t++;
+		}
+		part->offsets.push_back(count);
+		part->end_task = t;
+		if (first_touch) {
+			ok = part->contracts.Allocate(count * sizeof(OptionContract), huge_pages) && ok;
+		}
+		partitions.push_back(part);
+	}
+	if (!ok) {
+		cout << "Out of memory while allocating the partitions of the portfolio aggregator, reading the books in place" << endl;
+		for (size_t w = 0; w < partitions.size(); w++) {
+			partitions[w]->contracts.Release();
+		}
+		return;
+	}
+	if (first_touch) { //the worker writing a page first decides its node
+		std::vector<int> placement(cpus.begin(), cpus.begin() + partitions.size());
+		RunOnCpus(placement, pin, [&](size_t w) {
+			Partition& part = *partitions[w];
+			OptionContract* dst = static_cast<OptionContract*>(part.contracts.Data());
+			for (size_t k = part.first_task; k < part.end_task; k++) {
+				const BookEntry& entry = books[tasks[k].book];
+				std::copy(entry.book->Block(tasks[k].block), entry.book->Block(tasks[k].block) + entry.book->BlockLength(tasks[k].block),
+					dst + part.offsets[k - part.first_task]);
+			}
+		});
+	}
+}
+
+unsigned int PortfolioAggregator::GlobalIndex(const std::string& name) {
+	std::unordered_map<std::string, unsigned int>::const_iterator it = name_index.find(name);
+	if (it != name_index.end()) {
+		return it->second;
+	}
+	unsigned int index = (unsigned int)names.size();
+	names.push_back(name);
+	name_index[name] = index;
+	return index;
+}
+
+unsigned int PortfolioAggregator::Bucket(const OptionContract& c) const {
+	if (c.type == US_CALL || c.type == US_PUT) {
+		return (unsigned int)edges.size() + 1;
+	}
+	return (unsigned int)(std::lower_bound(edges.begin(), edges.end(), c.T) - edges.begin()); //first edge >= T
+}
+
+/*Aggregation implementation*/
+void PortfolioAggregator::Run() {
+	PRICER_PROBE("PortfolioAggregator::Run");
+	//maps the underlyings of every book to the portfolio index (names may have been added since AddBook)
+	std::vector<Task> tasks;
+	std::vector<unsigned long long> versions(books.size());
+	for (unsigned int bk = 0; bk < books.size(); bk++) {
+		BookEntry& entry = books[bk];
+		entry.global.resize(entry.book->UnderlyingCount());
+		for (unsigned int u = 0; u < entry.global.size(); u++) {
+			entry.global[u] = GlobalIndex(entry.book->UnderlyingName(u));
+		}
+		for (size_t blk = 0; blk < entry.book->BlockCount(); blk++) {
+			Task task = { bk, blk };
+			tasks.push_back(task);
+		}
+		versions[bk] = entry.book->Version();
+	}
+
+	if (!cpus.empty() && (partitions.empty() || placed_versions != versions)) { //a book changed since the copies were taken
+		Place(tasks);
+		placed_versions = versions;
+	}
+
+	//fused pricing and reduction: every task accumulates into its own partial cells, in contract order
+	std::vector<std::vector<std::pair<unsigned long long, Exposure> > > partials(tasks.size());
+	DispatchOutputMask(mask, [&](auto tag) {
+		constexpr unsigned int Mask = decltype(tag)::value;
+		auto task = [&](size_t t, const OptionContract* c, size_t len) {
+			const BookEntry& entry = books[tasks[t].book];
+			std::vector<std::pair<unsigned long long, Exposure> >& cells_t = partials[t];
+			std::unordered_map<unsigned long long, size_t> index;
+			unsigned long long last_key = ~0ull;
+			size_t slot = 0;
+			OptionOutputs<double> out = OptionOutputs<double>();
+			for (size_t i = 0; i < len; i++) {
+				unsigned int underlying = (c[i].underlying < entry.global.size()) ? entry.global[c[i].underlying] : 0;
+				unsigned long long key = CellKey(tasks[t].book, underlying, Bucket(c[i]));
+				if (key != last_key) { //contracts of a cell are usually stored together
+					std::unordered_map<unsigned long long, size_t>::const_iterator it = index.find(key);
+					if (it == index.end()) {
+						slot = cells_t.size();
+						index[key] = slot;
+						cells_t.push_back(std::make_pair(key, Exposure()));
+					}
+					else {
+						slot = it->second;
+					}
+					last_key = key;
+				}
+				GreeksKernel<Mask>(c[i].type, c[i].S, c[i].K, c[i].T, c[i].sig, c[i].rf, c[i].b, mask, out);
+				Exposure& acc = cells_t[slot].second;
+				double qty = c[i].qty;
+				acc.value += qty * out.price;
+				if (Mask & mask & OUT_DELTA) acc.delta += qty * out.delta;
+				if (Mask & mask & OUT_GAMMA) acc.gamma += qty * out.gamma;
+				if (Mask & mask & OUT_VEGA) acc.vega += qty * out.vega;
+				if (Mask & mask & OUT_THETA) acc.theta += qty * out.theta;
+				if (Mask & mask & OUT_RHO) acc.rho += qty * out.rho;
+				acc.positions++;
+			}
+		};
+		if (cpus.empty()) {
+			ParallelFor(tasks.size(), m_threads, [&](size_t t) {
+				task(t, books[tasks[t].book].book->Block(tasks[t].block), books[tasks[t].book].book->BlockLength(tasks[t].block));
+			});
+		}
+		else { //pinned workers, each on its own range of tasks (and its own copy of their contracts)
+			std::vector<int> placement(cpus.begin(), cpus.begin() + partitions.size());
+			RunOnCpus(placement, pin, [&](size_t w) {
+				const Partition& part = *partitions[w];
+				const OptionContract* copy = static_cast<const OptionContract*>(part.contracts.Data());
+				for (size_t t = part.first_task; t < part.end_task; t++) {
+					size_t k = t - part.first_task;
+					if (copy) {
+						task(t, copy + part.offsets[k], part.offsets[k + 1] - part.offsets[k]);
+					}
+					else {
+						task(t, books[tasks[t].book].book->Block(tasks[t].block), books[tasks[t].book].book->BlockLength(tasks[t].block));
+					}
+				}
+			});
+		}
+	});
+
+	//deterministic merge: partial cells added in task order, then the cells sorted by key
+	std::unordered_map<unsigned long long, size_t> merged;
+	std::vector<std::pair<unsigned long long, Exposure> > all;
+	for (size_t t = 0; t < partials.size(); t++) {
+		for (size_t k = 0; k < partials[t].size(); k++) {
+			std::unordered_map<unsigned long long, size_t>::const_iterator it = merged.find(partials[t][k].first);
+			if (it == merged.end()) {
+				merged[partials[t][k].first] = all.size();
+				all.push_back(partials[t][k]);
+			}
+			else {
+				all[it->second].second.Add(partials[t][k].second);
+			}
+		}
+		std::vector<std::pair<unsigned long long, Exposure> >().swap(partials[t]);
+	}
+	std::sort(all.begin(), all.end(), [](const std::pair<unsigned long long, Exposure>& x, const std::pair<unsigned long long, Exposure>& y) {
+		return x.first < y.first;
+	});
+
+	//cells and rollups
+	cells.resize(all.size());
+	by_underlying.assign(names.size(), Exposure());
+	by_bucket.assign(BucketCount(), Exposure());
+	by_book.assign(books.size(), Exposure());
+	total = Exposure();
+	for (size_t k = 0; k < all.size(); k++) {
+		AggregateCell& cell = cells[k];
+		cell.book = (unsigned int)(all[k].first >> 48);
+		cell.underlying = (unsigned int)((all[k].first >> 16) & 0xFFFFFFFFull);
+		cell.bucket = (unsigned int)(all[k].first & 0xFFFFull);
+		cell.exposure = all[k].second;
+		by_underlying[cell.underlying].Add(cell.exposure);
+		by_bucket[cell.bucket].Add(cell.exposure);
+		by_book[cell.book].Add(cell.exposure);
+		total.Add(cell.exposure);
+	}
+}
+
+/*Results implementation*/
+const std::vector<AggregateCell>& PortfolioAggregator::Cells() const {
+	return cells;
+}
+
+const Exposure& PortfolioAggregator::Total() const {
+	return total;
+}
+
+const std::vector<Exposure>& PortfolioAggregator::ByUnderlying() const {
+	return by_underlying;
+}
+
+const std::vector<Exposure>& PortfolioAggregator::ByBucket() const {
+	return by_bucket;
+}
+
+const std::vector<Exposure>& PortfolioAggregator::ByBook() const {
+	return by_book;
+}
+
+bool PortfolioAggregator::Underlying(const std::string& name, Exposure& exposure) const {
+	std::unordered_map<std::string, unsigned int>::const_iterator it = name_index.find(name);
+	if (it == name_index.end() || it->second >= by_underlying.size()) {
+		return false;
+	}
+	exposure = by_underlying[it->second];
+	return true;
+}
+
+/*Names implementation*/
+size_t PortfolioAggregator::UnderlyingCount() const {
+	return names.size();
+}
+
+const std::string& PortfolioAggregator::UnderlyingName(unsigned int underlying) const {
+	return names[underlying];
+}
+
+size_t PortfolioAggregator::BucketCount() const {
+	return edges.size() + 2;
+}
+
+std::string PortfolioAggregator::BucketName(unsigned int bucket) const {
+	std::stringstream ss;
+	if (bucket == edges.size() + 1) {
+		ss << "perpetual";
+	}
+	else if (bucket == edges.size()) {
+		ss << "> " << (edges.empty() ? 0.0 : edges.back()) << "Y";
+	}
+	else {
+		ss << "<= " << edges[bucket] << "Y";
+	}
+	return ss.str();
+}
+
+std::string PortfolioAggregator::ToString() const {
+	std::stringstream ss;
+	ss << "Total: " << total.ToString() << endl;
+	for (unsigned int bk = 0; bk < by_book.size(); bk++) {
+		ss << "Book " << books[bk].name << ": " << by_book[bk].ToString() << endl;
+	}
+	for (unsigned int bu = 0; bu < by_bucket.size(); bu++) {
+		if (by_bucket[bu].positions > 0) {
+			ss << "Bucket " << BucketName(bu) << ": " << by_bucket[bu].ToString() << endl;
+		}
+	}
+	return ss.str();
+}
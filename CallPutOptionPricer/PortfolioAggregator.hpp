@@ -0,0 +1,142 @@
+/* Portfolio aggregation */
+/*****************************************************
+Name: PortfolioAggregator.hpp
+version: 0.3
+Description:
+Position weighted rollups of one or several OptionBooks: value and Greeks (sum of qty * output) per
+(book, underlying, expiry bucket) cell, and the totals per underlying, per bucket, per book and for the portfolio.
+
+Pricing and reduction are fused: every contract is priced with GreeksKernel (only the outputs of the mask) and
+added straight into the accumulator of its cell, so the per-contract results are never stored. The books are cut in
+tasks of one arena block each; a task accumulates its contracts in order into its own partial cells (a small hash
+table, with the last cell cached since contracts of a cell are usually stored together) and the partial cells are
+merged in task order once every task is done. The task boundaries do not depend on the number of threads, so the
+results are bit for bit the same whatever the threading.
+
+Underlying names are merged across the books with a hash index keyed on the name (the Underlying() of EuOpt /
+UsOpt positions stored by OptionBook::Add), so the same underlying held by two books rolls up into one line.
+Expiry buckets are given by their upper edges in years: bucket i holds edges[i-1] < T <= edges[i], one more bucket
+holds the expiries beyond the last edge and the last bucket the perpetual contracts.
+
+Placement(config) runs the tasks on the pinned workers of a NumaConfig (NumaPricer.hpp) instead of the threads of
+ParallelFor. As in NumaPricer, every worker owns a fixed contiguous range of tasks (about the same number of
+contracts each) and, with config.first_touch, copies the contracts of its range once into its own LargeBuffer, so
+that their pages are placed on its node and every later run streams them from local memory. The copies are taken
+by the first Run after Placement or AddBook, and again by the first Run after a book changed (OptionBook::Version
+moved on). Without first_touch the workers read the books in place (pinned only). The tasks are still merged in
+order, so the results do not change.
+
+Change history:
+0.1 Initial version
+0.2 Worker placement (Placement)
+0.3 Fixed, first touched task ranges per placed worker
+
+******************************************************/
+
+#ifndef PORTFOLIOAGGREGATOR_HPP
+#define PORTFOLIOAGGREGATOR_HPP
+
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include "OptionBook.hpp"
+#include "PricingKernels.hpp"
+#include "NumaPricer.hpp"
+using namespace std;
+
+/*Position weighted sums of a set of contracts. Greeks outside the mask of the aggregator stay 0*/
+struct Exposure {
+	double value; //sum of qty * price
+	double delta, gamma, vega, theta, rho; //sums of qty * Greek
+	size_t positions;
+
+	void Add(const Exposure& other);
+	std::string ToString() const;
+};
+
+/*One (book, underlying, expiry bucket) cell*/
+struct AggregateCell {
+	unsigned int book;
+	unsigned int underlying; //portfolio index of the underlying name
+	unsigned int bucket;
+	Exposure exposure;
+};
+
+class PortfolioAggregator {
+private:
+	struct BookEntry {
+		std::string name;
+		const OptionBook* book;
+		std::vector<unsigned int> global; //book underlying index -> portfolio underlying index
+	};
+	struct Task {
+		unsigned int book;
+		size_t block;
+	};
+	struct Partition { //tasks of one placed worker and, with first touch, the copy of their contracts
+		size_t first_task, end_task;
+		std::vector<size_t> offsets; //first contract of every task of the range in contracts, and the end
+		LargeBuffer contracts; //empty when the worker reads the books in place
+	};
+
+	std::vector<BookEntry> books;
+	std::vector<std::string> names; //portfolio underlying names
+	std::unordered_map<std::string, unsigned int> name_index;
+	std::vector<double> edges; //upper edges of the expiry buckets
+	unsigned int mask; //outputs accumulated (OutputFlag), always with OUT_PRICE
+	int m_threads;
+	std::vector<int> cpus; //pinned workers set by Placement, empty for ParallelFor
+	bool pin;
+	bool first_touch;
+	int huge_pages;
+	std::vector<Partition*> partitions; //one per placed worker, empty until the first placed Run
+	std::vector<unsigned long long> placed_versions; //Version() of every book when the partitions were cut
+
+	/*Results of the last Run*/
+	std::vector<AggregateCell> cells; //sorted by book, underlying, bucket
+	std::vector<Exposure> by_underlying, by_bucket, by_book;
+	Exposure total;
+
+	PortfolioAggregator(const PortfolioAggregator& source);
+	PortfolioAggregator& operator = (const PortfolioAggregator& source);
+
+	unsigned int Bucket(const OptionContract& c) const;
+	unsigned int GlobalIndex(const std::string& name);
+	void Place(const std::vector<Task>& tasks); //cuts the tasks into the ranges of the workers and copies them
+	void ClearPartitions();
+
+public:
+	/*Constructor and destructor*/
+	PortfolioAggregator(unsigned int p_mask = OUT_FIRST_ORDER, int p_threads = 0); //default buckets: 3M, 6M, 1Y, 2Y, 5Y, 10Y
+	PortfolioAggregator(const std::vector<double>& bucket_edges, unsigned int p_mask = OUT_FIRST_ORDER, int p_threads = 0);
+	virtual ~PortfolioAggregator();
+
+	/*Books of the portfolio. The books are read by Run and must outlive the aggregator*/
+	unsigned int AddBook(const std::string& name, const OptionBook& book);
+	size_t BookCount() const;
+	const std::string& BookName(unsigned int book) const;
+	int threads() const;
+	void threads(int new_threads);
+	void Placement(const NumaConfig& config); //workers placed as in config, replaces threads (copies the books on the next Run)
+
+	/*Prices and aggregates every position of every book*/
+	void Run();
+
+	/*Results of the last Run*/
+	const std::vector<AggregateCell>& Cells() const;
+	const Exposure& Total() const;
+	const std::vector<Exposure>& ByUnderlying() const; //indexed by portfolio underlying index
+	const std::vector<Exposure>& ByBucket() const;
+	const std::vector<Exposure>& ByBook() const;
+	bool Underlying(const std::string& name, Exposure& exposure) const; //false if no book holds the underlying
+
+	/*Names*/
+	size_t UnderlyingCount() const;
+	const std::string& UnderlyingName(unsigned int underlying) const;
+	size_t BucketCount() const;
+	std::string BucketName(unsigned int bucket) const;
+	std::string ToString() const; //totals per book and per bucket
+};
+
+#endif
@@ -0,0 +1,290 @@
+/* Inline pricing kernels */
+/*****************************************************
+Name: PricingKernels.hpp
+version: 0.6
+Description:
+Stateless pricing kernels templated on the floating point type (float or double).
+They implement the same formulas as EuOptCall::Price, EuOptPut::Price, UsOptCall::Price and UsOptPut::Price
+but work on plain numbers so that batch pricers can call them in tight loops without objects.
+The normal CDF is computed from erfc, so the float instantiation only uses float-accurate erfc/exp/log/pow.
+
+GreeksKernel<Mask> computes the outputs selected by a bitmask of OutputFlag in one pass, sharing d1, d2, the
+discount and carry factors and n(d1) between them. Mask is a template parameter so that the instantiations for the
+common masks (OUT_PRICE, OUT_HEDGE, OUT_HEDGE | OUT_GAMMA, OUT_FIRST_ORDER and, for the Greeks only requests of
+op_greeks, OUT_DELTA, OUT_DELTA | OUT_GAMMA, OUT_FIRST_ORDER & ~OUT_PRICE) compile the unrequested outputs away;
+DispatchOutputMask picks the instantiation once per batch and falls back to OUT_ALL with a runtime test of the
+mask for the other combinations. The perpetual Greeks are the closed forms of UsOptCall / UsOptPut.
+BsFactors holds d1, d2, sig*sqrt(T) and the discount and carry factors of a contract, shared by GreeksKernel and
+the exotic kernels of ExoticKernels.hpp.
+
+Change history:
+0.1 Initial version
+0.2 Greeks selected by an output mask (GreeksKernel, DispatchOutputMask)
+0.3 Closed form perpetual vega, rho, vanna and volga in GreeksKernel (were central differences)
+0.4 Shared Black-Scholes intermediates (BsFactors)
+0.5 Greeks only masks in DispatchOutputMask
+0.6 Perpetual prices and Greeks at their intrinsic value in the exercise region
+
+Parameters:
+S (current stock price), K (strike price), T (expiry time), sig (volatility),
+rf (risk-free interest rate), b (cost of carry).
+
+******************************************************/
+
+#ifndef PRICINGKERNELS_HPP
+#define PRICINGKERNELS_HPP
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+#include "OptionData.hpp"
+
+/*Gaussian functions*/
+template <typename Real>
+inline Real NormPdf(Real x) {
+	return Real(0.39894228040143267794) * std::exp(Real(-0.5) * x * x); //1/sqrt(2*pi) * e^(-x^2/2)
+}
+
+template <typename Real>
+inline Real NormCdf(Real x) {
+	return Real(0.5) * std::erfc(-x * Real(0.70710678118654752440)); //N(x) = erfc(-x/sqrt(2))/2
+}
+
+/*Generalized Black-Scholes kernels*/
+template <typename Real>
+inline Real EuCallKernel(Real S, Real K, Real T, Real sig, Real rf, Real b) {
+	Real denominator = sig * std::sqrt(T);
+	Real d1 = (std::log(S / K) + (b + (sig*sig)*Real(0.5)) * T) / denominator;
+	Real d2 = d1 - denominator;
+
+	return (S * std::exp((b - rf)*T) * NormCdf(d1)) - (K * std::exp(-rf * T) * NormCdf(d2));
+}
+
+template <typename Real>
+inline Real EuPutKernel(Real S, Real K, Real T, Real sig, Real rf, Real b) {
+	Real denominator = sig * std::sqrt(T);
+	Real d1 = (std::log(S / K) + (b + (sig*sig)*Real(0.5)) * T) / denominator;
+	Real d2 = d1 - denominator;
+
+	return (K * std::exp(-rf * T) * NormCdf(-d2)) - (S * std::exp((b - rf)*T) * NormCdf(-d1));
+}
+
+/*Perpetual American kernels*/
+template <typename Real>
+inline Real UsCallKernel(Real S, Real K, Real sig, Real rf, Real b) {
+	Real sig2 = sig * sig;
+	Real y1 = Real(0.5) - b / sig2 + std::sqrt((b / sig2 - Real(0.5))*(b / sig2 - Real(0.5)) + Real(2.0)*rf / sig2);
+	if (y1 <= Real(1.0)) { //b >= rf: early exercise is never optimal and the call is worth S (y1 = 1 up to rounding)
+		return S;
+	}
+	if (S >= K * y1 / (y1 - Real(1.0))) { //exercise region S >= S*: worth the intrinsic value
+		return S - K;
+	}
+	return (K / (y1 - Real(1.0))) * std::pow(((y1 - Real(1.0)) / y1 * S / K), y1);
+}
+
+template <typename Real>
+inline Real UsPutKernel(Real S, Real K, Real sig, Real rf, Real b) {
+	Real sig2 = sig * sig;
+	Real y2 = Real(0.5) - b / sig2 - std::sqrt((b / sig2 - Real(0.5))*(b / sig2 - Real(0.5)) + Real(2.0)*rf / sig2);
+	if (S <= K * y2 / (y2 - Real(1.0))) { //exercise region S <= S*: worth the intrinsic value
+		return K - S;
+	}
+	return (K / (Real(1.0) - y2)) * std::pow(((y2 - Real(1.0)) / y2 * S / K), y2);
+}
+
+/*Intermediates of the generalized Black-Scholes formula*/
+template <typename Real>
+struct BsFactors {
+	Real sqrtT; //sqrt(T)
+	Real den; //sig*sqrt(T)
+	Real d1, d2;
+	Real carry; //e^((b-rf)*T)
+	Real df; //e^(-rf*T)
+};
+
+template <typename Real>
+inline BsFactors<Real> BsFactorsAt(Real S, Real K, Real T, Real sig, Real rf, Real b) {
+	BsFactors<Real> f;
+	f.sqrtT = std::sqrt(T);
+	f.den = sig * f.sqrtT;
+	f.d1 = (std::log(S / K) + (b + (sig*sig)*Real(0.5)) * T) / f.den;
+	f.d2 = f.d1 - f.den;
+	f.carry = std::exp((b - rf)*T);
+	f.df = std::exp(-rf * T);
+	return f;
+}
+
+/*Dispatch on the contract type (see OptionType in OptionData.hpp)*/
+template <typename Real>
+inline Real PriceKernel(int type, Real S, Real K, Real T, Real sig, Real rf, Real b) {
+	switch (type) {
+	case EU_CALL:
+		return EuCallKernel(S, K, T, sig, rf, b);
+	case EU_PUT:
+		return EuPutKernel(S, K, T, sig, rf, b);
+	case US_CALL:
+		return UsCallKernel(S, K, sig, rf, b);
+	case US_PUT:
+		return UsPutKernel(S, K, sig, rf, b);
+	default:
+		return Real(0.0);
+	}
+}
+
+
+/*Outputs requested from GreeksKernel (bitmask)*/
+enum OutputFlag {
+	OUT_PRICE = 1 << 0,
+	OUT_DELTA = 1 << 1, //dV/dS
+	OUT_GAMMA = 1 << 2, //d2V/dS2
+	OUT_VEGA = 1 << 3, //dV/dsig
+	OUT_THETA = 1 << 4, //-dV/dT (0 for perpetual contracts)
+	OUT_RHO = 1 << 5, //dV/drf with rf - b fixed (the carry moves with the rate)
+	OUT_VANNA = 1 << 6, //d2V/dS dsig
+	OUT_VOLGA = 1 << 7, //d2V/dsig2
+	OUT_HEDGE = OUT_PRICE | OUT_DELTA,
+	OUT_FIRST_ORDER = OUT_PRICE | OUT_DELTA | OUT_GAMMA | OUT_VEGA | OUT_THETA | OUT_RHO,
+	OUT_ALL = OUT_FIRST_ORDER | OUT_VANNA | OUT_VOLGA
+};
+
+template <typename Real>
+struct OptionOutputs {
+	Real price, delta, gamma, vega, theta, rho, vanna, volga; //only the requested members are written
+};
+
+/*Columns of outputs for a batch: only the vectors of the requested outputs are filled*/
+struct GreekColumns {
+	unsigned int mask; //outputs held
+	std::vector<double> price, delta, gamma, vega, theta, rho, vanna, volga;
+
+	void Resize(unsigned int p_mask, size_t n) { //sizes the requested columns, empties the others
+		mask = p_mask;
+		std::vector<double>* columns[8] = { &price, &delta, &gamma, &vega, &theta, &rho, &vanna, &volga };
+		for (unsigned int bit = 0; bit < 8; bit++) {
+			columns[bit]->resize((mask & (1u << bit)) ? n : 0);
+		}
+	}
+	template <unsigned int Mask>
+	void Store(size_t i, const OptionOutputs<double>& out) { //Mask as in GreeksKernel
+		const unsigned int want = Mask & mask;
+		if (want & OUT_PRICE) price[i] = out.price;
+		if (want & OUT_DELTA) delta[i] = out.delta;
+		if (want & OUT_GAMMA) gamma[i] = out.gamma;
+		if (want & OUT_VEGA) vega[i] = out.vega;
+		if (want & OUT_THETA) theta[i] = out.theta;
+		if (want & OUT_RHO) rho[i] = out.rho;
+		if (want & OUT_VANNA) vanna[i] = out.vanna;
+		if (want & OUT_VOLGA) volga[i] = out.volga;
+	}
+};
+
+/*Outputs of one contract in one pass. Mask selects the outputs at compile time, mask at run time: the specialised
+instantiations are called with mask == Mask, the generic one with Mask = OUT_ALL*/
+template <unsigned int Mask, typename Real>
+inline void GreeksKernel(int type, Real S, Real K, Real T, Real sig, Real rf, Real b, unsigned int mask, OptionOutputs<Real>& out) {
+	const unsigned int want = Mask & mask;
+	if (type == EU_CALL || type == EU_PUT) {
+		const bool call = (type == EU_CALL);
+		const BsFactors<Real> f = BsFactorsAt(S, K, T, sig, rf, b);
+		Real sqrtT = f.sqrtT;
+		Real den = f.den;
+		Real d1 = f.d1;
+		Real d2 = f.d2;
+		Real carry = f.carry;
+		Real df = f.df;
+		Real Nd1 = NormCdf(call ? d1 : -d1); //N(d1) for a call, N(-d1) for a put
+		Real Nd2 = (want & (OUT_PRICE | OUT_THETA | OUT_RHO)) ? NormCdf(call ? d2 : -d2) : Real(0.0);
+		Real sign = call ? Real(1.0) : Real(-1.0);
+		Real pdf = (want & (OUT_GAMMA | OUT_VEGA | OUT_THETA | OUT_VANNA | OUT_VOLGA)) ? NormPdf(d1) : Real(0.0);
+		Real vega = S * sqrtT * carry * pdf;
+		if (want & OUT_PRICE) out.price = sign * (S * carry * Nd1 - K * df * Nd2);
+		if (want & OUT_DELTA) out.delta = sign * carry * Nd1;
+		if (want & OUT_GAMMA) out.gamma = carry * pdf / (S * den);
+		if (want & OUT_VEGA) out.vega = vega;
+		if (want & OUT_THETA) out.theta = -S * carry * pdf * sig / (Real(2.0) * sqrtT) - sign * ((b - rf) * S * carry * Nd1 + rf * K * df * Nd2);
+		if (want & OUT_RHO) out.rho = sign * T * K * df * Nd2;
+		if (want & OUT_VANNA) out.vanna = -carry * pdf * d2 / sig;
+		if (want & OUT_VOLGA) out.volga = vega * d1 * d2 / sig;
+		return;
+	}
+	if (type != US_CALL && type != US_PUT) {
+		out.price = out.delta = out.gamma = out.vega = out.theta = out.rho = out.vanna = out.volga = Real(0.0);
+		return;
+	}
+	//perpetual (UsOpt::Factors): V = premium * (S/S*)^y with S* = K y / (y - 1), so delta = y V / S,
+	//gamma = y (y - 1) V / S^2 and, S* being optimal, dV/dy = V ln(S/S*)
+	Real price = PriceKernel(type, S, K, T, sig, rf, b);
+	Real s = (type == US_CALL) ? Real(1.0) : Real(-1.0);
+	Real u = Real(1.0) / (sig * sig);
+	Real q = b * u - Real(0.5);
+	Real root = std::sqrt(q * q + Real(2.0) * rf * u);
+	Real y = -q + s * root;
+	bool exercised = !(type == US_CALL && y <= Real(1.0));
+	if (!exercised) { //never exercised, worth S
+		y = Real(1.0);
+	}
+	else if (s * S >= s * K * y / (y - Real(1.0))) { //exercise region (S >= S* for the call, S <= S* for the put): intrinsic value
+		if (want & OUT_PRICE) out.price = price;
+		if (want & OUT_DELTA) out.delta = s;
+		if (want & OUT_GAMMA) out.gamma = Real(0.0);
+		if (want & OUT_VEGA) out.vega = Real(0.0);
+		if (want & OUT_THETA) out.theta = Real(0.0);
+		if (want & OUT_RHO) out.rho = Real(0.0);
+		if (want & OUT_VANNA) out.vanna = Real(0.0);
+		if (want & OUT_VOLGA) out.volga = Real(0.0);
+		return;
+	}
+	if (want & OUT_PRICE) out.price = price;
+	if (want & OUT_DELTA) out.delta = y * price / S;
+	if (want & OUT_GAMMA) out.gamma = y * (y - Real(1.0)) * price / (S * S);
+	if (want & OUT_THETA) out.theta = Real(0.0);
+	if (want & (OUT_VEGA | OUT_RHO | OUT_VANNA | OUT_VOLGA)) {
+		Real L = exercised ? std::log(S * (y - Real(1.0)) / (K * y)) : Real(0.0); //ln(S/S*)
+		Real dy_du = -b + s * (q * b + rf) / root;
+		Real sig3 = sig * sig * sig;
+		Real dy_dsig = exercised ? Real(-2.0) * dy_du / sig3 : Real(0.0);
+		if (want & OUT_VEGA) out.vega = price * L * dy_dsig;
+		if (want & OUT_RHO) out.rho = exercised ? price * L * (s * u / root + u * (s * q / root - Real(1.0))) : Real(0.0);
+		if (want & OUT_VANNA) out.vanna = price / S * dy_dsig * (Real(1.0) + y * L);
+		if (want & OUT_VOLGA) {
+			Real d2y_du2 = s * (b * b * root * root - (q * b + rf) * (q * b + rf)) / (root * root * root);
+			Real d2y_dsig2 = d2y_du2 * Real(4.0) / (sig3 * sig3) + dy_du * Real(6.0) / (sig3 * sig);
+			out.volga = exercised ? price * (dy_dsig * dy_dsig * (L * L + Real(1.0) / (y * (y - Real(1.0)))) + L * d2y_dsig2) : Real(0.0);
+		}
+	}
+}
+
+/*Calls body(std::integral_constant<unsigned int, Mask>()) with the instantiation mask for a runtime mask. body is
+a generic lambda that passes decltype(tag)::value as the Mask of GreeksKernel and mask as its runtime mask*/
+template <typename Body>
+inline void DispatchOutputMask(unsigned int mask, Body body) {
+	switch (mask) {
+	case OUT_PRICE:
+		body(std::integral_constant<unsigned int, OUT_PRICE>());
+		break;
+	case OUT_HEDGE:
+		body(std::integral_constant<unsigned int, OUT_HEDGE>());
+		break;
+	case OUT_HEDGE | OUT_GAMMA:
+		body(std::integral_constant<unsigned int, OUT_HEDGE | OUT_GAMMA>());
+		break;
+	case OUT_FIRST_ORDER:
+		body(std::integral_constant<unsigned int, OUT_FIRST_ORDER>());
+		break;
+	case OUT_DELTA:
+		body(std::integral_constant<unsigned int, OUT_DELTA>());
+		break;
+	case OUT_DELTA | OUT_GAMMA:
+		body(std::integral_constant<unsigned int, OUT_DELTA | OUT_GAMMA>());
+		break;
+	case OUT_FIRST_ORDER & ~OUT_PRICE:
+		body(std::integral_constant<unsigned int, OUT_FIRST_ORDER & ~OUT_PRICE>());
+		break;
+	default:
+		body(std::integral_constant<unsigned int, OUT_ALL>());
+		break;
+	}
+}
+
+#endif
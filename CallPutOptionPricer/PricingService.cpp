@@ -0,0 +1,616 @@
+/* Local pricing service implementation */
+/*****************************************************
+Name: PricingService.cpp
+version: 0.1
+Description:
+Implementation of the functions in PricingService.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "PricingService.hpp"
+#include "PricingKernels.hpp"
+#include "Instrumentation.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(PricingMessageHeader) == 16, "PricingMessageHeader is part of the wire format");
+static_assert(sizeof(PricingRequestItem) == 56, "PricingRequestItem is part of the wire format");
+
+static const unsigned int CHUNK_ITEMS = 256; //items per work unit of the pool
+static const int IDLE_SPINS = 20000; //empty passes before the I/O thread blocks in poll
+
+/*ServiceConfig and ServiceStats implementation*/
+ServiceConfig::ServiceConfig() : threads(-1), pin(true), max_connections(64), parallel_threshold(1024) {
+
+}
+
+std::string ServiceStats::ToString() const {
+	std::stringstream ss;
+	ss << "Requests: " << requests << "\nItems: " << items << "\nBatches: " << batches << "\nRejected: " << rejected << endl;
+	return ss.str();
+}
+
+#ifndef _WIN32
+/*Reads or writes exactly len bytes on a blocking socket (client side), false on error or end of stream*/
+static bool ReadAll(int fd, void* buffer, size_t len) {
+	char* p = (char*)buffer;
+	while (len > 0) {
+		ssize_t got = recv(fd, p, len, 0);
+		if (got <= 0) {
+			if (got < 0 && errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += got;
+		len -= (size_t)got;
+	}
+	return true;
+}
+
+static bool WriteAll(int fd, const void* buffer, size_t len) {
+	const char* p = (const char*)buffer;
+	while (len > 0) {
+#ifdef MSG_NOSIGNAL
+		ssize_t sent = send(fd, p, len, MSG_NOSIGNAL);
+#else
+		ssize_t sent = send(fd, p, len, 0);
+#endif
+		if (sent <= 0) {
+			if (sent < 0 && errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += sent;
+		len -= (size_t)sent;
+	}
+	return true;
+}
+#endif
+
+/*Constructor and destructor*/
+PricingService::PricingService(const ServiceConfig& p_config) : config(p_config), running(false), listen_fd(-1), region(0),
+	n_requests(0), n_items(0), n_batches(0), n_rejected(0), generation(0), stopping(false), chunk_count(0), next_chunk(0), busy_workers(0) {
+
+}
+
+PricingService::~PricingService() {
+	Stop();
+}
+
+/*Control*/
+bool PricingService::Start() {
+#ifdef _WIN32
+	cout << "The pricing service needs Unix domain sockets and POSIX shared memory" << endl;
+	return false;
+#else
+	if (running) {
+		return true;
+	}
+	//tables used by the I/O thread, sized once
+	connections.resize(config.max_connections);
+	for (size_t i = 0; i < connections.size(); i++) {
+		connections[i].fd = -1;
+	}
+	batch.resize(config.max_connections + SERVICE_SLOTS);
+	chunks.resize(config.max_connections * (SERVICE_MAX_ITEMS / CHUNK_ITEMS) + SERVICE_SLOTS);
+
+	if (!config.socket_path.empty()) {
+		listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, config.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+		unlink(config.socket_path.c_str());
+		if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0
+			|| fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK) != 0) {
+			cout << "Cannot listen on " << config.socket_path << endl;
+			Stop();
+			return false;
+		}
+	}
+	if (!config.shm_name.empty()) {
+		shm_unlink(config.shm_name.c_str());
+		int fd = shm_open(config.shm_name.c_str(), O_CREAT | O_RDWR, 0600);
+		if (fd < 0 || ftruncate(fd, sizeof(ServiceRegion)) != 0) {
+			cout << "Cannot create the shared memory region " << config.shm_name << endl;
+			if (fd >= 0) {
+				close(fd);
+			}
+			Stop();
+			return false;
+		}
+		void* base = mmap(0, sizeof(ServiceRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED) {
+			Stop();
+			return false;
+		}
+		region = (ServiceRegion*)base;
+		for (unsigned int i = 0; i < SERVICE_SLOTS; i++) {
+			region->slot[i].state.store(SLOT_FREE, std::memory_order_relaxed);
+		}
+		region->slots = SERVICE_SLOTS;
+		std::atomic_thread_fence(std::memory_order_release);
+		region->magic = SERVICE_MAGIC; //published last: clients wait for it
+	}
+
+	int n = config.threads;
+	if (n < 0) {
+		n = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+	}
+	unsigned long long first_seen;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		stopping = false;
+		first_seen = generation; //read before any worker runs: a worker still starting up must not miss the next batch
+	}
+	running = true;
+	for (int t = 0; t < n; t++) {
+		workers.push_back(std::thread(&PricingService::WorkerLoop, this, t, first_seen));
+	}
+	io_thread = std::thread(&PricingService::IOLoop, this);
+	return true;
+#endif
+}
+
+void PricingService::Stop() {
+	running = false;
+	if (io_thread.joinable()) {
+		io_thread.join();
+	}
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		stopping = true;
+	}
+	pool_cv.notify_all();
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	workers.clear();
+#ifndef _WIN32
+	for (size_t i = 0; i < connections.size(); i++) {
+		CloseConnection(connections[i]);
+	}
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		unlink(config.socket_path.c_str());
+	}
+	if (region != 0) {
+		munmap(region, sizeof(ServiceRegion));
+		region = 0;
+		shm_unlink(config.shm_name.c_str());
+	}
+#endif
+}
+
+bool PricingService::Running() const {
+	return running;
+}
+
+ServiceStats PricingService::Stats() const {
+	ServiceStats s;
+	s.requests = n_requests;
+	s.items = n_items;
+	s.batches = n_batches;
+	s.rejected = n_rejected;
+	return s;
+}
+
+/*Pricing*/
+void PricingService::PriceChunks() {
+	for (size_t c = next_chunk++; c < chunk_count; c = next_chunk++) {
+		const Chunk& chunk = chunks[c];
+		for (unsigned int i = 0; i < chunk.count; i++) {
+			const PricingRequestItem& it = chunk.items[i];
+			chunk.results[i] = PriceKernel<double>(it.type, it.S, it.data.K, it.data.T, it.data.sig, it.data.rf, it.data.b);
+		}
+	}
+}
+
+void PricingService::WorkerLoop(int index, unsigned long long first_seen) {
+	if (config.pin && !PinThread(AllowedCpu(index + 1))) {
+		cout << "Pricing service worker " << index << " could not be pinned" << endl;
+	}
+	unsigned long long seen = first_seen;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(pool_mutex);
+			pool_cv.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+		PriceChunks();
+		busy_workers--;
+	}
+}
+
+void PricingService::PriceBatch(size_t entries) {
+	PRICER_PROBE("PricingService::PriceBatch");
+	//cuts the requests of the batch in chunks
+	size_t total = 0;
+	chunk_count = 0;
+	for (size_t e = 0; e < entries; e++) {
+		for (unsigned int begin = 0; begin < batch[e].count; begin += CHUNK_ITEMS) {
+			Chunk& c = chunks[chunk_count++];
+			c.items = batch[e].items + begin;
+			c.results = batch[e].results + begin;
+			c.count = std::min(CHUNK_ITEMS, batch[e].count - begin);
+		}
+		total += batch[e].count;
+	}
+	next_chunk = 0;
+	if (workers.empty() || total < config.parallel_threshold) {
+		PriceChunks();
+		return;
+	}
+	busy_workers = (int)workers.size();
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		generation++;
+	}
+	pool_cv.notify_all();
+	PriceChunks();
+	while (busy_workers.load(std::memory_order_acquire) > 0) {
+		std::this_thread::yield();
+	}
+}
+
+/*I/O*/
+void PricingService::CloseConnection(Connection& c) {
+#ifndef _WIN32
+	if (c.fd >= 0) {
+		close(c.fd);
+		c.fd = -1;
+	}
+#endif
+	c.received = 0;
+	c.reply_size = c.reply_sent = 0;
+	c.closing = false;
+}
+
+bool PricingService::ReadRequest(Connection& c, BatchEntry& entry, bool& complete) {
+	complete = false;
+#ifdef _WIN32
+	return false;
+#else
+	//receives what the socket holds, up to the end of one request
+	const size_t header_size = sizeof(PricingMessageHeader);
+	while (true) {
+		size_t wanted = header_size;
+		char* target = (char*)&c.header + c.received;
+		if (c.received >= header_size) {
+			wanted = header_size + c.header.count * sizeof(PricingRequestItem);
+			target = (char*)&c.request[0] + (c.received - header_size);
+		}
+		if (c.received == wanted) {
+			break;
+		}
+		ssize_t got = recv(c.fd, target, wanted - c.received, 0);
+		if (got <= 0) {
+			if (got < 0 && errno == EINTR) {
+				continue;
+			}
+			return got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK); //no more data for now, or closed / failed
+		}
+		c.received += (size_t)got;
+		if (c.received == header_size) {
+			if (c.header.magic != SERVICE_MAGIC) {
+				return false;
+			}
+			if (c.header.count > SERVICE_MAX_ITEMS) { //too large: rejected with an empty reply, then the connection is dropped
+				PricingMessageHeader reply = { SERVICE_MAGIC, 0, c.header.id };
+				memcpy(&c.reply[0], &reply, sizeof(reply));
+				c.reply_size = sizeof(reply);
+				c.reply_sent = 0;
+				c.closing = true;
+				n_rejected++;
+				return FlushReply(c);
+			}
+		}
+	}
+	c.received = 0;
+	complete = true;
+	entry.slot = 0;
+	entry.items = &c.request[0];
+	entry.results = &c.reply[sizeof(PricingMessageHeader) / sizeof(double)];
+	entry.count = c.header.count;
+	entry.id = c.header.id;
+	return true;
+#endif
+}
+
+bool PricingService::FlushReply(Connection& c) {
+#ifdef _WIN32
+	return false;
+#else
+	const char* p = (const char*)&c.reply[0];
+	while (c.reply_sent < c.reply_size) {
+#ifdef MSG_NOSIGNAL
+		ssize_t sent = send(c.fd, p + c.reply_sent, c.reply_size - c.reply_sent, MSG_NOSIGNAL);
+#else
+		ssize_t sent = send(c.fd, p + c.reply_sent, c.reply_size - c.reply_sent, 0);
+#endif
+		if (sent <= 0) {
+			if (sent < 0 && errno == EINTR) {
+				continue;
+			}
+			return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK); //the rest goes when the socket is writable
+		}
+		c.reply_sent += (size_t)sent;
+	}
+	c.reply_size = c.reply_sent = 0;
+	return !c.closing;
+#endif
+}
+
+void PricingService::Reply(const BatchEntry& entry) {
+#ifndef _WIN32
+	if (entry.slot != 0) {
+		entry.slot->state.store(SLOT_DONE, std::memory_order_release);
+		return;
+	}
+	//the results are already in the reply buffer, behind the header
+	Connection& c = connections[entry.connection];
+	PricingMessageHeader header = { SERVICE_MAGIC, entry.count, entry.id };
+	memcpy(&c.reply[0], &header, sizeof(header));
+	c.reply_size = sizeof(header) + entry.count * sizeof(double);
+	c.reply_sent = 0;
+	if (!FlushReply(c)) {
+		CloseConnection(c);
+	}
+#endif
+}
+
+void PricingService::IOLoop() {
+#ifndef _WIN32
+	if (config.pin && !PinThread(AllowedCpu(0))) {
+		cout << "Pricing service I/O thread could not be pinned" << endl;
+	}
+	std::vector<pollfd> fds(1 + config.max_connections);
+	std::vector<int> fd_owner(fds.size(), -1); //connection index of every polled descriptor
+	int idle = 0;
+	while (running) {
+		//descriptors to poll: the listening socket and the open connections
+		size_t nfds = 0;
+		if (listen_fd >= 0) {
+			fds[nfds].fd = listen_fd;
+			fds[nfds].events = POLLIN;
+			fds[nfds].revents = 0;
+			fd_owner[nfds++] = -1;
+		}
+		for (size_t i = 0; i < connections.size(); i++) {
+			if (connections[i].fd >= 0) {
+				fds[nfds].fd = connections[i].fd;
+				fds[nfds].events = (connections[i].reply_sent < connections[i].reply_size) ? POLLOUT : POLLIN; //no new request before the reply is out
+				fds[nfds].revents = 0;
+				fd_owner[nfds++] = (int)i;
+			}
+		}
+		int timeout = (idle >= IDLE_SPINS) ? 1 : 0;
+		if (nfds > 0) {
+			poll(&fds[0], nfds, timeout);
+		}
+		else if (timeout > 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		size_t entries = 0;
+		for (size_t f = 0; f < nfds; f++) {
+			if (fds[f].revents == 0) {
+				continue;
+			}
+			if (fd_owner[f] < 0) { //new connection
+				int fd = accept(listen_fd, 0, 0);
+				if (fd < 0) {
+					continue;
+				}
+				if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+					close(fd);
+					continue;
+				}
+				size_t i = 0;
+				while (i < connections.size() && connections[i].fd >= 0) {
+					i++;
+				}
+				if (i == connections.size()) { //no room: refused
+					close(fd);
+					n_rejected++;
+					continue;
+				}
+				Connection& c = connections[i];
+				c.fd = fd;
+				c.received = 0;
+				c.reply_size = c.reply_sent = 0;
+				c.closing = false;
+				c.request.resize(SERVICE_MAX_ITEMS); //allocated once per connection
+				c.reply.resize(sizeof(PricingMessageHeader) / sizeof(double) + SERVICE_MAX_ITEMS);
+				continue;
+			}
+			Connection& c = connections[fd_owner[f]];
+			if (c.reply_sent < c.reply_size) { //writable again: rest of the reply
+				if (!FlushReply(c)) {
+					CloseConnection(c);
+				}
+				continue;
+			}
+			BatchEntry& entry = batch[entries];
+			entry.connection = fd_owner[f];
+			bool complete = false;
+			if (!ReadRequest(c, entry, complete)) {
+				CloseConnection(c);
+			}
+			else if (complete) {
+				entries++;
+			}
+		}
+		if (region != 0) {
+			for (unsigned int s = 0; s < SERVICE_SLOTS; s++) {
+				ServiceSlot& slot = region->slot[s];
+				if (slot.state.load(std::memory_order_acquire) != SLOT_READY) {
+					continue;
+				}
+				slot.state.store(SLOT_BUSY, std::memory_order_relaxed);
+				BatchEntry& entry = batch[entries++];
+				entry.connection = -1;
+				entry.slot = &slot;
+				entry.items = slot.items;
+				entry.results = slot.results;
+				entry.count = std::min(slot.count, SERVICE_SLOT_ITEMS);
+				entry.id = slot.id;
+			}
+		}
+		if (entries == 0) {
+			if (idle < IDLE_SPINS) {
+				idle++;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+		idle = 0;
+		PriceBatch(entries);
+		size_t items = 0;
+		for (size_t e = 0; e < entries; e++) {
+			items += batch[e].count;
+			Reply(batch[e]);
+		}
+		n_requests += entries;
+		n_items += items;
+		n_batches++;
+	}
+#endif
+}
+
+/*PricingClient implementation*/
+PricingClient::PricingClient() : fd(-1), region(0), slot_hint(0), next_id(1) {
+
+}
+
+PricingClient::~PricingClient() {
+	Close();
+}
+
+bool PricingClient::Connect(const std::string& socket_path) {
+#ifdef _WIN32
+	return false;
+#else
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+	if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		fd = -1;
+		return false;
+	}
+	return true;
+#endif
+}
+
+bool PricingClient::Attach(const std::string& shm_name) {
+#ifdef _WIN32
+	return false;
+#else
+	int shm = shm_open(shm_name.c_str(), O_RDWR, 0600);
+	if (shm < 0) {
+		return false;
+	}
+	void* base = mmap(0, sizeof(ServiceRegion), PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+	close(shm);
+	if (base == MAP_FAILED) {
+		return false;
+	}
+	region = (ServiceRegion*)base;
+	if (region->magic != SERVICE_MAGIC) {
+		munmap(base, sizeof(ServiceRegion));
+		region = 0;
+		return false;
+	}
+	return true;
+#endif
+}
+
+void PricingClient::Close() {
+#ifndef _WIN32
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+	if (region != 0) {
+		munmap(region, sizeof(ServiceRegion));
+		region = 0;
+	}
+#endif
+}
+
+bool PricingClient::Price(const PricingRequestItem* items, unsigned int count, double* results) {
+#ifdef _WIN32
+	return false;
+#else
+	if (fd < 0 || count > SERVICE_MAX_ITEMS) {
+		return false;
+	}
+	PricingMessageHeader header = { SERVICE_MAGIC, count, next_id++ };
+	if (!WriteAll(fd, &header, sizeof(header)) || !WriteAll(fd, items, count * sizeof(PricingRequestItem))) {
+		return false;
+	}
+	PricingMessageHeader reply;
+	if (!ReadAll(fd, &reply, sizeof(reply)) || reply.magic != SERVICE_MAGIC || reply.id != header.id || reply.count != count) {
+		return false;
+	}
+	return ReadAll(fd, results, count * sizeof(double));
+#endif
+}
+
+bool PricingClient::PriceShared(const PricingRequestItem* items, unsigned int count, double* results) {
+	if (region == 0 || count > SERVICE_SLOT_ITEMS) {
+		return false;
+	}
+	//claims the next free slot of the ring
+	ServiceSlot* slot = 0;
+	for (unsigned int tries = 0; slot == 0; tries++) {
+		ServiceSlot& candidate = region->slot[(slot_hint + tries) % SERVICE_SLOTS];
+		unsigned int expected = SLOT_FREE;
+		if (candidate.state.compare_exchange_strong(expected, SLOT_CLAIMED, std::memory_order_acquire)) {
+			slot = &candidate;
+			slot_hint = (slot_hint + tries + 1) % SERVICE_SLOTS;
+		}
+		else if (tries > 0 && tries % SERVICE_SLOTS == 0) {
+			std::this_thread::yield(); //ring full
+		}
+	}
+	memcpy(slot->items, items, count * sizeof(PricingRequestItem));
+	slot->count = count;
+	slot->id = next_id++;
+	slot->state.store(SLOT_READY, std::memory_order_release);
+	for (unsigned int spins = 0; slot->state.load(std::memory_order_acquire) != SLOT_DONE; spins++) {
+		if (spins >= 64) {
+			std::this_thread::yield(); //gives the CPU to the service when they share one
+		}
+	}
+	memcpy(results, slot->results, count * sizeof(double));
+	slot->state.store(SLOT_FREE, std::memory_order_release);
+	return true;
+}
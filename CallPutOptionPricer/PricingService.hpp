@@ -0,0 +1,204 @@
+/* Local pricing service */
+/*****************************************************
+Name: PricingService.hpp
+version: 0.1
+Description:
+Long running pricing service for other processes on the same machine, so that they do not pay the process
+startup of the pricer on every call. Two transports share one pricing loop:
+
+Unix domain socket: a request is a PricingMessageHeader followed by count PricingRequestItem records, the reply
+is a PricingMessageHeader (same id and count) followed by count doubles. Several requests can be pipelined on one
+connection.
+Shared memory: a named region of SERVICE_SLOTS slots used as a ring. A client claims a free slot, writes the items
+and publishes it (state READY), the service prices it in place and marks it DONE, the client reads the results and
+frees the slot. Nothing is copied nor any system call made on the request path.
+
+The I/O thread polls the socket and the shared memory slots and gathers every request that arrived since the
+last pass into one batch. Small batches are priced by the I/O thread itself, larger ones are cut in chunks and
+shared with the worker pool (the I/O thread pinned to the first CPU of the affinity mask and the workers to the next
+ones when pinning is on). The I/O thread spins while traffic is flowing and falls back to a 1 ms poll when idle.
+Connection buffers are allocated once per connection and the batch tables when the service starts, so serving a
+request allocates nothing.
+The sockets are non-blocking: every connection keeps the part of a request received so far and the part of its
+reply not yet sent, and is polled for reading or, while a reply is pending, for writing. A slow or stalled client
+only delays its own requests, never the other connections nor the shared memory ring.
+
+All records use the native byte order and natural alignment, the sizes are checked at compile time.
+The transports are POSIX (Linux, macOS); on Windows Start() and the client calls return false.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef PRICINGSERVICE_HPP
+#define PRICINGSERVICE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "OptionData.hpp"
+using namespace std;
+
+/*Wire format*/
+const unsigned int SERVICE_MAGIC = 0x50525643; //"PRVC"
+const unsigned int SERVICE_MAX_ITEMS = 4096; //items per socket request
+const unsigned int SERVICE_SLOT_ITEMS = 256; //items per shared memory slot
+const unsigned int SERVICE_SLOTS = 64; //slots of the shared memory ring
+
+struct PricingMessageHeader {
+	unsigned int magic; //SERVICE_MAGIC
+	unsigned int count; //number of items (0 in a reply means the request was rejected)
+	unsigned long long id; //request id chosen by the client and echoed in the reply
+};
+
+struct PricingRequestItem {
+	OptionData data; //rf, sig, K, T, b
+	double S; //spot of the underlying
+	int type; //OptionType
+	int reserved;
+};
+
+/*Shared memory slot states*/
+enum SlotState {
+	SLOT_FREE = 0,
+	SLOT_CLAIMED = 1, //a client is writing the request
+	SLOT_READY = 2, //request published
+	SLOT_BUSY = 3, //taken by the service
+	SLOT_DONE = 4 //results published
+};
+
+struct ServiceSlot {
+	std::atomic<unsigned int> state;
+	unsigned int count;
+	unsigned long long id;
+	PricingRequestItem items[SERVICE_SLOT_ITEMS];
+	double results[SERVICE_SLOT_ITEMS];
+};
+
+struct ServiceRegion {
+	unsigned int magic;
+	unsigned int slots;
+	ServiceSlot slot[SERVICE_SLOTS];
+};
+
+/*Configuration and statistics*/
+struct ServiceConfig {
+	std::string socket_path; //empty: no socket transport
+	std::string shm_name; //empty: no shared memory transport (POSIX name, e.g. "/option_pricer")
+	int threads; //workers besides the I/O thread, <0 uses the hardware concurrency - 1
+	bool pin; //pins the I/O thread and the workers to CPUs
+	unsigned int max_connections;
+	unsigned int parallel_threshold; //batches with fewer items are priced by the I/O thread alone
+
+	ServiceConfig();
+};
+
+struct ServiceStats {
+	unsigned long long requests;
+	unsigned long long items;
+	unsigned long long batches;
+	unsigned long long rejected;
+
+	std::string ToString() const;
+};
+
+class PricingService {
+private:
+	/*Requests gathered in one pass of the I/O thread*/
+	struct BatchEntry {
+		int connection; //-1 for a shared memory slot
+		ServiceSlot* slot;
+		const PricingRequestItem* items;
+		double* results;
+		unsigned int count;
+		unsigned long long id;
+	};
+	struct Chunk {
+		const PricingRequestItem* items;
+		double* results;
+		unsigned int count;
+	};
+	/*Non-blocking connection: the request being received and the reply being sent survive between passes*/
+	struct Connection {
+		int fd; //-1 when unused
+		PricingMessageHeader header; //header of the request being received
+		size_t received; //bytes of the request received so far, header included
+		std::vector<PricingRequestItem> request;
+		std::vector<double> reply; //reply header (first 16 bytes) followed by the results, sent from here
+		size_t reply_size, reply_sent; //bytes of the pending reply, reply_sent == reply_size when none
+		bool closing; //closed once the pending reply is sent (rejected request)
+	};
+
+	ServiceConfig config;
+	std::atomic<bool> running;
+	std::thread io_thread;
+	int listen_fd;
+	ServiceRegion* region;
+	std::vector<Connection> connections;
+	std::vector<BatchEntry> batch;
+	std::vector<Chunk> chunks;
+	std::atomic<unsigned long long> n_requests, n_items, n_batches, n_rejected; //written by the I/O thread only
+
+	/*Worker pool*/
+	std::vector<std::thread> workers;
+	std::mutex pool_mutex;
+	std::condition_variable pool_cv;
+	unsigned long long generation; //incremented for every batch handed to the pool
+	bool stopping;
+	size_t chunk_count;
+	std::atomic<size_t> next_chunk;
+	std::atomic<int> busy_workers;
+
+	PricingService(const PricingService& source);
+	PricingService& operator = (const PricingService& source);
+
+	void IOLoop();
+	void WorkerLoop(int index, unsigned long long first_seen); //first_seen: generation when Start spawned the worker
+	void PriceChunks(); //takes chunks until none is left
+	void PriceBatch(size_t entries);
+	bool ReadRequest(Connection& c, BatchEntry& entry, bool& complete); //false: the connection must be closed
+	bool FlushReply(Connection& c); //sends what the socket accepts, false: the connection must be closed
+	void Reply(const BatchEntry& entry);
+	void CloseConnection(Connection& c);
+
+public:
+	/*Constructor and destructor*/
+	PricingService(const ServiceConfig& p_config);
+	virtual ~PricingService();
+
+	/*Control*/
+	bool Start();
+	void Stop();
+	bool Running() const;
+	ServiceStats Stats() const;
+};
+
+/*Client side of both transports*/
+class PricingClient {
+private:
+	int fd;
+	ServiceRegion* region;
+	unsigned int slot_hint;
+	unsigned long long next_id;
+
+	PricingClient(const PricingClient& source);
+	PricingClient& operator = (const PricingClient& source);
+
+public:
+	PricingClient();
+	virtual ~PricingClient();
+
+	bool Connect(const std::string& socket_path);
+	bool Attach(const std::string& shm_name);
+	void Close();
+
+	bool Price(const PricingRequestItem* items, unsigned int count, double* results); //socket, count <= SERVICE_MAX_ITEMS
+	bool PriceShared(const PricingRequestItem* items, unsigned int count, double* results); //shared memory, count <= SERVICE_SLOT_ITEMS
+};
+
+#endif
@@ -0,0 +1,159 @@
+/* Lock-free ring buffers */
+/*****************************************************
+Name: RingBuffer.hpp
+version: 0.1
+Description:
+Bounded lock-free queues for handing messages between threads without locks nor allocation after construction.
+The capacity is rounded up to a power of two. TryPush returns false when the queue is full and TryPop when it is
+empty, so the caller decides whether to spin, yield or drop.
+
+SpscRing<T>: one producer thread and one consumer thread. The head and the tail are padded onto their own cache lines (padding rather
+than alignas, so the queues can be allocated with plain new before C++17) and
+each side keeps a cached copy of the other side's index, so the shared lines are only touched when the cached
+copy says the queue looks full (producer) or empty (consumer).
+MpscRing<T>: any number of producer threads and one consumer thread (bounded queue of D. Vyukov: every cell
+carries a sequence number telling whether it is free for the producer of a given ticket or filled for the consumer).
+
+T must be copy assignable; the queues copy the values in and out.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+const size_t RING_CACHE_LINE = 64;
+
+inline size_t RingCapacity(size_t requested) {
+	size_t capacity = 2;
+	while (capacity < requested) {
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+template <typename T>
+class SpscRing {
+private:
+	std::vector<T> cells;
+	size_t mask;
+	char pad0[RING_CACHE_LINE];
+	std::atomic<size_t> head; //next cell to read, written by the consumer
+	size_t cached_tail; //consumer's copy of tail
+	char pad1[RING_CACHE_LINE];
+	std::atomic<size_t> tail; //next cell to write, written by the producer
+	size_t cached_head; //producer's copy of head
+	char pad2[RING_CACHE_LINE];
+
+	SpscRing(const SpscRing& source);
+	SpscRing& operator = (const SpscRing& source);
+
+public:
+	SpscRing(size_t capacity) : cells(RingCapacity(capacity)), mask(RingCapacity(capacity) - 1), head(0), cached_tail(0), tail(0), cached_head(0) {}
+
+	bool TryPush(const T& value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - cached_head > mask) {
+			cached_head = head.load(std::memory_order_acquire);
+			if (t - cached_head > mask) {
+				return false;
+			}
+		}
+		cells[t & mask] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(T& value) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == cached_tail) {
+			cached_tail = tail.load(std::memory_order_acquire);
+			if (h == cached_tail) {
+				return false;
+			}
+		}
+		value = cells[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t capacity() const {
+		return mask + 1;
+	}
+
+	size_t size() const { //approximate when both sides are running
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+};
+
+template <typename T>
+class MpscRing {
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+	std::vector<Cell> cells;
+	size_t mask;
+	char pad0[RING_CACHE_LINE];
+	std::atomic<size_t> tail; //next ticket for the producers
+	char pad1[RING_CACHE_LINE];
+	size_t head; //next cell to read, consumer only
+	char pad2[RING_CACHE_LINE];
+
+	MpscRing(const MpscRing& source);
+	MpscRing& operator = (const MpscRing& source);
+
+public:
+	MpscRing(size_t capacity) : cells(RingCapacity(capacity)), mask(RingCapacity(capacity) - 1), tail(0), head(0) {
+		for (size_t i = 0; i < cells.size(); i++) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	bool TryPush(const T& value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = cells[t & mask];
+			size_t seq = cell.sequence.load(std::memory_order_acquire);
+			std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)t;
+			if (diff == 0) { //free for ticket t
+				if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+					cell.value = value;
+					cell.sequence.store(t + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) { //still holds a value from the previous lap: full
+				return false;
+			}
+			else {
+				t = tail.load(std::memory_order_relaxed); //another producer took the ticket
+			}
+		}
+	}
+
+	bool TryPop(T& value) {
+		Cell& cell = cells[head & mask];
+		size_t seq = cell.sequence.load(std::memory_order_acquire);
+		if (seq != head + 1) { //not written yet
+			return false;
+		}
+		value = cell.value;
+		cell.sequence.store(head + mask + 1, std::memory_order_release); //free for the ticket of the next lap
+		head++;
+		return true;
+	}
+
+	size_t capacity() const {
+		return mask + 1;
+	}
+};
+
+#endif
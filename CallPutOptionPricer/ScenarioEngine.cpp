@@ -0,0 +1,166 @@
+/* Scenario revaluation and VaR engine implementation */
+/*****************************************************
+Name: ScenarioEngine.cpp
+version: 0.2
+Description:
+Implementation of the functions in ScenarioEngine.hpp
+
+Change history:
+0.1 Initial version
+0.2 ParallelFor moved to ParallelFor.hpp
+
+******************************************************/
+
+#include "ScenarioEngine.hpp"
+#include "PricingKernels.hpp"
+#include "Instrumentation.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "boost/random.hpp"
+
+static const double MIN_VOL = 1e-4; //floor of the shocked volatility
+
+/*RiskReport implementation*/
+std::string RiskReport::ToString() const {
+	std::stringstream ss;
+	ss << "VaR (" << confidence * 100.0 << "%): " << var << "\nExpected shortfall: " << es << "\nMean P&L: " << mean << "\nWorst P&L: " << worst << endl;
+	return ss.str();
+}
+
+/*Constructor and destructor implementation*/
+ScenarioEngine::ScenarioEngine(const OptionBook& p_book, int p_threads) : book(p_book), m_threads(p_threads), tile_contracts(2048), tile_scenarios(32) {
+
+}
+
+ScenarioEngine::~ScenarioEngine() {
+
+}
+
+/*Parallel layout member functions implementation*/
+int ScenarioEngine::threads() const {
+	return m_threads;
+}
+
+void ScenarioEngine::threads(int new_threads) {
+	m_threads = new_threads;
+}
+
+void ScenarioEngine::TileSize(size_t contracts, size_t scenarios) {
+	tile_contracts = (contracts > 0) ? contracts : 1;
+	tile_scenarios = (scenarios > 0) ? scenarios : 1;
+}
+
+/*Revaluation implementation*/
+std::vector<double> ScenarioEngine::Run(const std::vector<MarketScenario>& scenarios) const {
+	PRICER_PROBE("ScenarioEngine::Run");
+	size_t num_contracts = book.size();
+	size_t num_scenarios = scenarios.size();
+	std::vector<double> pnl(num_scenarios, 0.0);
+	if (num_contracts == 0 || num_scenarios == 0) {
+		return pnl;
+	}
+
+	//base values, one pass over the book
+	std::vector<double> base(num_contracts);
+	size_t contract_tiles = (num_contracts + tile_contracts - 1) / tile_contracts;
+	ParallelFor(contract_tiles, m_threads, [&](size_t ct) {
+		size_t end = std::min(num_contracts, (ct + 1) * tile_contracts);
+		for (size_t i = ct * tile_contracts; i < end; i++) {
+			const OptionContract& c = book[i];
+			base[i] = PriceKernel<double>(c.type, c.S, c.K, c.T, c.sig, c.rf, c.b);
+		}
+	});
+
+	//partial P&L of every (contract tile, scenario): each tile owns its slots, so no locking is needed
+	size_t scenario_tiles = (num_scenarios + tile_scenarios - 1) / tile_scenarios;
+	std::vector<double> partial(contract_tiles * num_scenarios, 0.0);
+	ParallelFor(contract_tiles * scenario_tiles, m_threads, [&](size_t tile) {
+		size_t ct = tile / scenario_tiles;
+		size_t st = tile % scenario_tiles;
+		size_t c_end = std::min(num_contracts, (ct + 1) * tile_contracts);
+		size_t s_begin = st * tile_scenarios;
+		size_t s_end = std::min(num_scenarios, s_begin + tile_scenarios);
+		double* out = &partial[ct * num_scenarios];
+		for (size_t i = ct * tile_contracts; i < c_end; i++) {
+			const OptionContract& c = book[i];
+			for (size_t s = s_begin; s < s_end; s++) {
+				const MarketScenario& m = scenarios[s];
+				double value = PriceKernel<double>(c.type, c.S * (1.0 + m.spot_shock), c.K, c.T, std::max(c.sig + m.vol_shock, MIN_VOL), c.rf + m.rate_shock, c.b + m.rate_shock);
+				out[s] += c.qty * (value - base[i]);
+			}
+		}
+	});
+
+	//deterministic reduction: partial sums of a scenario are always added in contract tile order
+	ParallelFor(num_scenarios, m_threads, [&](size_t s) {
+		double sum = 0.0;
+		for (size_t ct = 0; ct < contract_tiles; ct++) {
+			sum += partial[ct * num_scenarios + s];
+		}
+		pnl[s] = sum;
+	});
+	return pnl;
+}
+
+/*Scenario generation implementation*/
+std::vector<MarketScenario> ScenarioEngine::HistoricalScenarios(const std::vector<double>& spots, const std::vector<double>& vols, const std::vector<double>& rates) {
+	std::vector<MarketScenario> vec;
+	if (spots.size() != vols.size() || spots.size() != rates.size() || spots.size() < 2) {
+		cout << "Invalid input. Spot, vol and rate histories must have the same size (at least 2 observations)" << endl;
+		return vec;
+	}
+	vec.resize(spots.size() - 1); //one scenario per observed change
+	for (size_t i = 1; i < spots.size(); i++) {
+		vec[i - 1].spot_shock = spots[i] / spots[i - 1] - 1.0;
+		vec[i - 1].vol_shock = vols[i] - vols[i - 1];
+		vec[i - 1].rate_shock = rates[i] - rates[i - 1];
+	}
+	return vec;
+}
+
+std::vector<MarketScenario> ScenarioEngine::ParametricScenarios(int num, double spot_vol, double vol_vol, double rate_vol, unsigned int seed) {
+	std::vector<MarketScenario> vec;
+	if (num <= 0) {
+		cout << "Invalid input. The number of scenarios must be positive" << endl;
+		return vec;
+	}
+	boost::mt19937 gen(seed);
+	boost::normal_distribution<double> norm(0.0, 1.0);
+	boost::variate_generator< boost::mt19937&, boost::normal_distribution<double> > z(gen, norm);
+	vec.resize(num);
+	for (int i = 0; i < num; i++) {
+		vec[i].spot_shock = exp(spot_vol * z() - 0.5 * spot_vol * spot_vol) - 1.0; //lognormal spot move with zero mean
+		vec[i].vol_shock = vol_vol * z();
+		vec[i].rate_shock = rate_vol * z();
+	}
+	return vec;
+}
+
+/*Risk measures implementation*/
+RiskReport ScenarioEngine::Risk(const std::vector<double>& pnl, double confidence) {
+	RiskReport report = { confidence, 0.0, 0.0, 0.0, 0.0 };
+	if (pnl.empty()) {
+		return report;
+	}
+	std::vector<double> sorted(pnl);
+	std::sort(sorted.begin(), sorted.end()); //worst P&L first
+	size_t tail = (size_t)floor((1.0 - confidence) * sorted.size() + 1e-9); //number of scenarios beyond the VaR (0.05 * 100 is 5, not 4)
+	if (tail >= sorted.size()) {
+		tail = sorted.size() - 1;
+	}
+	report.var = -sorted[tail];
+	double tail_sum = 0.0;
+	for (size_t i = 0; i <= tail; i++) {
+		tail_sum += sorted[i];
+	}
+	report.es = -tail_sum / (double)(tail + 1);
+	double sum = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++) {
+		sum += sorted[i];
+	}
+	report.mean = sum / sorted.size();
+	report.worst = sorted[0];
+	return report;
+}
@@ -0,0 +1,84 @@
+/* Scenario revaluation and VaR engine */
+/*****************************************************
+Name: ScenarioEngine.hpp
+version: 0.1
+Description:
+Revalues an OptionBook under a set of market scenarios and computes P&L vectors, Value at Risk and expected shortfall.
+
+A scenario shocks every contract of the book:
+S' = S * (1 + spot_shock), sig' = max(sig + vol_shock, 1e-4), rf' = rf + rate_shock and b' = b + rate_shock
+(a parallel shift of the rates, so that b - rf, i.e. the dividend yield, is unchanged).
+The P&L of a scenario is the sum over the contracts of qty * (V(shocked) - V(base)).
+
+The contracts x scenarios matrix is cut in tiles of tile_contracts x tile_scenarios: a tile is priced by one worker
+thread with the contracts of the tile kept in cache while the scenarios are applied to them. Every tile writes its partial
+sums to its own slot, and the partial sums of a scenario are added in contract order at the end, so the P&L vector is
+bit for bit the same whatever the number of threads.
+
+Scenarios can be historical (relative changes of observed spot, vol and rate series) or parametric
+(independent normal shocks drawn from a seeded generator).
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef SCENARIOENGINE_HPP
+#define SCENARIOENGINE_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "OptionBook.hpp"
+using namespace std;
+
+/*Market shocks applied to the whole book*/
+struct MarketScenario {
+	double spot_shock; //relative change of the underlying price
+	double vol_shock; //absolute change of the volatility
+	double rate_shock; //absolute change of rf and b
+};
+
+/*Risk figures computed from a P&L vector. Losses are reported as positive numbers*/
+struct RiskReport {
+	double confidence;
+	double var; //value at risk: loss not exceeded with probability confidence
+	double es; //expected shortfall: mean loss beyond the VaR
+	double mean; //mean P&L
+	double worst; //worst P&L
+
+	std::string ToString() const;
+};
+
+class ScenarioEngine {
+private:
+	const OptionBook& book;
+	int m_threads; //worker threads (0 = hardware concurrency)
+	size_t tile_contracts; //contracts per tile
+	size_t tile_scenarios; //scenarios per tile
+
+	ScenarioEngine(const ScenarioEngine& source);
+	ScenarioEngine& operator = (const ScenarioEngine& source);
+
+public:
+	/*Constructor and destructor*/
+	ScenarioEngine(const OptionBook& p_book, int p_threads = 0);
+	virtual ~ScenarioEngine();
+
+	/*Member functions to retrieve and set the parallel layout*/
+	int threads() const;
+	void threads(int new_threads);
+	void TileSize(size_t contracts, size_t scenarios);
+
+	/*Revaluation*/
+	std::vector<double> Run(const std::vector<MarketScenario>& scenarios) const; //P&L per scenario
+
+	/*Scenario generation*/
+	static std::vector<MarketScenario> HistoricalScenarios(const std::vector<double>& spots, const std::vector<double>& vols, const std::vector<double>& rates);
+	static std::vector<MarketScenario> ParametricScenarios(int num, double spot_vol, double vol_vol, double rate_vol, unsigned int seed = 1);
+
+	/*Risk measures*/
+	static RiskReport Risk(const std::vector<double>& pnl, double confidence = 0.99);
+};
+
+#endif
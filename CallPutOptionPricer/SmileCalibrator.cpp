@@ -0,0 +1,420 @@
+/* Smile calibration implementation */
+/*****************************************************
+Name: SmileCalibrator.cpp
+version: 0.1
+Description:
+Implementation of the functions in SmileCalibrator.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "SmileCalibrator.hpp"
+#include "PricingKernels.hpp"
+#include "Instrumentation.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const int NP = 5; //SVI parameters: a, b, rho, m, s
+
+/*CalibrationResult implementation*/
+std::string CalibrationResult::ToString() const {
+	std::stringstream ss;
+	ss << underlying << " T = " << T << ": a = " << params.a << ", b = " << params.b << ", rho = " << params.rho << ", m = " << params.m
+		<< ", s = " << params.s << " | " << iterations << " iterations" << (warm_start ? " (warm start)" : "") << (converged ? "" : " (not converged)")
+		<< ", rms residual " << rms_residual << ", max residual " << max_residual << endl;
+	return ss.str();
+}
+
+/*Parameter vector helpers*/
+static void ToArray(const SVIParams& p, double* x) {
+	x[0] = p.a; x[1] = p.b; x[2] = p.rho; x[3] = p.m; x[4] = p.s;
+}
+
+static SVIParams FromArray(const double* x) {
+	SVIParams p = { x[0], x[1], x[2], x[3], x[4] };
+	return p;
+}
+
+/*Keeps the parameters in the domain of an arbitrage-free, well defined smile*/
+static double MinA(const double* x) { //minimum total variance a + b*s*sqrt(1 - rho^2) >= 0
+	return 1e-8 - x[1] * x[4] * sqrt(1.0 - x[2] * x[2]);
+}
+
+static void Project(double* x) {
+	x[1] = std::max(x[1], 0.0);
+	x[2] = std::min(std::max(x[2], -0.999), 0.999);
+	x[4] = std::max(x[4], 1e-4);
+	x[0] = std::max(x[0], MinA(x));
+}
+
+/*Parameters held by Project: at a bound with the descent direction -g pointing out of the domain*/
+static void Clamped(const double* x, const double* g, bool* clamped) {
+	clamped[0] = (x[0] <= MinA(x) && g[0] > 0.0);
+	clamped[1] = (x[1] <= 0.0 && g[1] > 0.0);
+	clamped[2] = (x[2] <= -0.999 && g[2] > 0.0) || (x[2] >= 0.999 && g[2] < 0.0);
+	clamped[3] = false;
+	clamped[4] = (x[4] <= 1e-4 && g[4] > 0.0);
+}
+
+/*Solves the NP x NP system A x = y by Gaussian elimination with partial pivoting (A and y are overwritten)*/
+static bool Solve(double A[NP][NP], double* y, double* x) {
+	for (int c = 0; c < NP; c++) {
+		int pivot = c;
+		for (int r = c + 1; r < NP; r++) {
+			if (fabs(A[r][c]) > fabs(A[pivot][c])) {
+				pivot = r;
+			}
+		}
+		if (fabs(A[pivot][c]) < 1e-300) {
+			return false;
+		}
+		for (int k = 0; k < NP; k++) {
+			std::swap(A[c][k], A[pivot][k]);
+		}
+		std::swap(y[c], y[pivot]);
+		for (int r = c + 1; r < NP; r++) {
+			double f = A[r][c] / A[c][c];
+			for (int k = c; k < NP; k++) {
+				A[r][k] -= f * A[c][k];
+			}
+			y[r] -= f * y[c];
+		}
+	}
+	for (int c = NP - 1; c >= 0; c--) {
+		double sum = y[c];
+		for (int k = c + 1; k < NP; k++) {
+			sum -= A[c][k] * x[k];
+		}
+		x[c] = sum / A[c][c];
+	}
+	return true;
+}
+
+/*Vega weighted residuals and Jacobian of one smile. Prices and vegas come from the stateless kernels, so
+objectives run on worker threads without building option objects*/
+class SmileObjective {
+private:
+	const SmileQuotes& q;
+	std::vector<double> k; //log forward moneyness
+	std::vector<double> scale; //1/vega at the starting parameters
+
+public:
+	SmileObjective(const SmileQuotes& quotes) : q(quotes) {
+		double F = q.S * exp(q.b * q.T);
+		k.resize(q.K.size());
+		for (size_t i = 0; i < k.size(); i++) {
+			k[i] = log(q.K[i] / F);
+		}
+		scale.assign(q.K.size(), 1.0);
+	}
+
+	size_t size() const {
+		return k.size();
+	}
+
+	/*Price and vega of quote i at volatility sig*/
+	void Value(size_t i, double sig, double& price, double& vega) const {
+		const unsigned int mask = OUT_PRICE | OUT_VEGA;
+		OptionOutputs<double> out = OptionOutputs<double>();
+		GreeksKernel<mask>((q.types[i] == EU_PUT) ? EU_PUT : EU_CALL, q.S, q.K[i], q.T, sig, q.rf, q.b, mask, out);
+		price = out.price;
+		vega = out.vega;
+	}
+
+	/*Weights the residuals by the inverse vega at x, floored at 1% of the largest vega*/
+	void Weights(const double* x) {
+		SVIParams p = FromArray(x);
+		std::vector<double> vegas(k.size());
+		double max_vega = 0.0;
+		for (size_t i = 0; i < k.size(); i++) {
+			double d = k[i] - p.m;
+			double w = std::max(p.a + p.b * (p.rho * d + sqrt(d * d + p.s * p.s)), 1e-10);
+			double price;
+			Value(i, sqrt(w / q.T), price, vegas[i]);
+			max_vega = std::max(max_vega, vegas[i]);
+		}
+		for (size_t i = 0; i < k.size(); i++) {
+			scale[i] = 1.0 / std::max(vegas[i], 0.01 * max_vega + 1e-12);
+		}
+	}
+
+	/*Residuals r (weighted) and, if J is not null, their Jacobian (size() rows of NP). Returns 0.5 * |r|^2.
+	Rows where the total variance is floored are 0: the floored price does not move with the parameters*/
+	double Evaluate(const double* x, double* r, double* J, double* raw = 0) const {
+		SVIParams p = FromArray(x);
+		double cost = 0.0;
+		for (size_t i = 0; i < k.size(); i++) {
+			double d = k[i] - p.m;
+			double R = sqrt(d * d + p.s * p.s);
+			double w_svi = p.a + p.b * (p.rho * d + R);
+			double w = std::max(w_svi, 1e-10);
+			double sig = sqrt(w / q.T);
+			double price, vega;
+			Value(i, sig, price, vega);
+			if (raw != 0) {
+				raw[i] = price - q.prices[i];
+			}
+			r[i] = (price - q.prices[i]) * scale[i];
+			cost += 0.5 * r[i] * r[i];
+			if (J != 0) {
+				//dV/dtheta = vega * dsig/dw * dw/dtheta
+				double f = (w_svi > 1e-10) ? vega / (2.0 * sig * q.T) * scale[i] : 0.0;
+				double* row = J + i * NP;
+				row[0] = f;
+				row[1] = f * (p.rho * d + R);
+				row[2] = f * p.b * d;
+				row[3] = f * p.b * (-p.rho - d / R);
+				row[4] = f * p.b * p.s / R;
+			}
+		}
+		return cost;
+	}
+};
+
+/*Constructor and destructor*/
+SmileCalibrator::SmileCalibrator(int p_threads) : m_threads(p_threads), max_iterations(100), tolerance(1e-10) {
+
+}
+
+SmileCalibrator::~SmileCalibrator() {
+
+}
+
+/*Settings*/
+void SmileCalibrator::Settings(int p_max_iterations, double p_tolerance) {
+	max_iterations = p_max_iterations;
+	tolerance = p_tolerance;
+}
+
+int SmileCalibrator::threads() const {
+	return m_threads;
+}
+
+void SmileCalibrator::threads(int new_threads) {
+	m_threads = new_threads;
+}
+
+/*Calibration*/
+SVIParams SmileCalibrator::InitialGuess(const SmileQuotes& q) const {
+	//implied volatility of the quote closest to the money, by Newton iterations on the pricers
+	double F = q.S * exp(q.b * q.T);
+	size_t atm = 0;
+	for (size_t i = 1; i < q.K.size(); i++) {
+		if (fabs(log(q.K[i] / F)) < fabs(log(q.K[atm] / F))) {
+			atm = i;
+		}
+	}
+	double sig = 0.2;
+	if (!q.K.empty()) {
+		SmileObjective objective(q);
+		for (int it = 0; it < 20; it++) {
+			double price, vega;
+			objective.Value(atm, sig, price, vega);
+			if (vega < 1e-12) {
+				break;
+			}
+			double next = std::min(std::max(sig - (price - q.prices[atm]) / vega, 1e-3), 5.0);
+			if (fabs(next - sig) < 1e-10) {
+				sig = next;
+				break;
+			}
+			sig = next;
+		}
+	}
+	double w_atm = sig * sig * q.T;
+	SVIParams p;
+	p.m = 0.0;
+	p.s = 0.1;
+	p.rho = -0.3;
+	p.b = 0.2 * sig * sqrt(q.T);
+	p.a = w_atm - p.b * p.s; //w(0) = a + b*s when m = 0
+	return p;
+}
+
+CalibrationResult SmileCalibrator::Fit(const SmileQuotes& quotes, const SVIParams* start) const {
+	PRICER_PROBE("SmileCalibrator::Fit");
+	CalibrationResult result;
+	result.underlying = quotes.underlying;
+	result.T = quotes.T;
+	result.warm_start = (start != 0);
+	result.converged = false;
+	result.iterations = 0;
+
+	double x[NP];
+	ToArray(start ? *start : InitialGuess(quotes), x);
+	Project(x);
+	SmileObjective objective(quotes);
+	size_t n = objective.size();
+	if (n == 0) {
+		result.params = FromArray(x);
+		result.converged = true;
+		result.rms_residual = result.max_residual = 0.0;
+		return result;
+	}
+	objective.Weights(x);
+
+	std::vector<double> r(n), J(n * NP), r_try(n);
+	double cost = objective.Evaluate(x, &r[0], &J[0]);
+	double lambda = 1e-3;
+	bool stalled = !std::isfinite(cost); //no usable step: solver failure or damping blow-up
+	for (int it = 0; it < max_iterations && !result.converged && !stalled; it++) {
+		result.iterations = it + 1;
+		//gradient, then the Jacobian columns of the parameters Project would clamp are zeroed: they stay put
+		double A[NP][NP], g[NP];
+		bool clamped[NP];
+		for (int a = 0; a < NP; a++) {
+			g[a] = 0.0;
+			for (int c = 0; c < NP; c++) {
+				A[a][c] = 0.0;
+			}
+		}
+		for (size_t i = 0; i < n; i++) {
+			for (int a = 0; a < NP; a++) {
+				g[a] += J[i * NP + a] * r[i];
+			}
+		}
+		Clamped(x, g, clamped);
+		for (int a = 0; a < NP; a++) {
+			if (clamped[a]) {
+				g[a] = 0.0;
+				for (size_t i = 0; i < n; i++) {
+					J[i * NP + a] = 0.0;
+				}
+			}
+		}
+		//normal equations of the damped Gauss-Newton step on the free parameters
+		for (size_t i = 0; i < n; i++) {
+			const double* row = &J[i * NP];
+			for (int a = 0; a < NP; a++) {
+				for (int c = 0; c <= a; c++) {
+					A[a][c] += row[a] * row[c];
+				}
+			}
+		}
+		for (int a = 0; a < NP; a++) {
+			for (int c = a + 1; c < NP; c++) {
+				A[a][c] = A[c][a];
+			}
+			if (clamped[a]) {
+				A[a][a] = 1.0; //keeps the system regular, the step of a clamped parameter is 0
+			}
+		}
+		//retries with a larger damping until the cost decreases
+		while (true) {
+			double M[NP][NP], y[NP], step[NP], trial[NP];
+			for (int a = 0; a < NP; a++) {
+				for (int c = 0; c < NP; c++) {
+					M[a][c] = A[a][c];
+				}
+				M[a][a] += lambda * (A[a][a] + 1e-12);
+				y[a] = -g[a];
+			}
+			if (!Solve(M, y, step)) {
+				lambda *= 10.0;
+				if (lambda > 1e12) {
+					stalled = true;
+					break;
+				}
+				continue;
+			}
+			double step_norm = 0.0, x_norm = 0.0;
+			for (int a = 0; a < NP; a++) {
+				trial[a] = x[a] + step[a];
+				step_norm += step[a] * step[a];
+				x_norm += x[a] * x[a];
+			}
+			Project(trial);
+			double trial_cost = objective.Evaluate(trial, &r_try[0], 0);
+			if (trial_cost < cost) {
+				double decrease = (cost - trial_cost) / std::max(cost, 1e-300);
+				for (int a = 0; a < NP; a++) {
+					x[a] = trial[a];
+				}
+				cost = objective.Evaluate(x, &r[0], &J[0]);
+				lambda = std::max(lambda * 0.1, 1e-12);
+				if (decrease < tolerance || step_norm < tolerance * tolerance * (x_norm + tolerance)) {
+					result.converged = true;
+				}
+				break;
+			}
+			lambda *= 10.0;
+			if (lambda > 1e12) { //no descent found: converged only if the residuals are already at round-off level
+				result.converged = (cost <= 0.5 * n * tolerance * tolerance);
+				stalled = !result.converged;
+				break;
+			}
+		}
+	}
+
+	//unweighted price residuals at the solution
+	std::vector<double> raw(n);
+	objective.Evaluate(x, &r[0], 0, &raw[0]);
+	double sum = 0.0, worst = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		sum += raw[i] * raw[i];
+		worst = std::max(worst, fabs(raw[i]));
+	}
+	result.params = FromArray(x);
+	result.rms_residual = sqrt(sum / n);
+	result.max_residual = worst;
+	return result;
+}
+
+std::vector<CalibrationResult> SmileCalibrator::Calibrate(const std::vector<SmileQuotes>& quotes) {
+	PRICER_PROBE("SmileCalibrator::Calibrate");
+	//the smiles of one underlying go to the same worker
+	std::map<std::string, std::vector<size_t> > by_underlying;
+	for (size_t i = 0; i < quotes.size(); i++) {
+		by_underlying[quotes[i].underlying].push_back(i);
+	}
+	std::vector<const std::vector<size_t>*> groups;
+	for (std::map<std::string, std::vector<size_t> >::const_iterator it = by_underlying.begin(); it != by_underlying.end(); ++it) {
+		groups.push_back(&it->second);
+	}
+
+	//the snapshot is only read while the workers run
+	std::vector<CalibrationResult> results(quotes.size());
+	ParallelFor(groups.size(), m_threads, [&](size_t g) {
+		const std::vector<size_t>& members = *groups[g];
+		for (size_t j = 0; j < members.size(); j++) {
+			const SmileQuotes& q = quotes[members[j]];
+			std::map<std::pair<std::string, double>, SVIParams>::const_iterator prev = snapshot.find(std::make_pair(q.underlying, q.T));
+			results[members[j]] = Fit(q, (prev != snapshot.end()) ? &prev->second : 0);
+		}
+	});
+
+	//only converged, finite fits become warm starts
+	for (size_t i = 0; i < results.size(); i++) {
+		const SVIParams& p = results[i].params;
+		if (results[i].converged && std::isfinite(p.a) && std::isfinite(p.b) && std::isfinite(p.rho) && std::isfinite(p.m) && std::isfinite(p.s)
+			&& std::isfinite(results[i].rms_residual)) {
+			snapshot[std::make_pair(results[i].underlying, results[i].T)] = p;
+		}
+	}
+	return results;
+}
+
+/*Snapshot*/
+bool SmileCalibrator::Snapshot(const std::string& underlying, double T, SVIParams& params) const {
+	std::map<std::pair<std::string, double>, SVIParams>::const_iterator it = snapshot.find(std::make_pair(underlying, T));
+	if (it == snapshot.end()) {
+		return false;
+	}
+	params = it->second;
+	return true;
+}
+
+void SmileCalibrator::Surface(const std::string& underlying, VolSurface& surface) const {
+	for (std::map<std::pair<std::string, double>, SVIParams>::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it) {
+		if (it->first.first == underlying) {
+			surface.AddSVI(it->first.second, it->second);
+		}
+	}
+}
+
+void SmileCalibrator::ClearSnapshot() {
+	snapshot.clear();
+}
@@ -0,0 +1,96 @@
+/* Smile calibration */
+/*****************************************************
+Name: SmileCalibrator.hpp
+version: 0.1
+Description:
+Fits a raw SVI smile (see VolSurface.hpp) to the quoted prices of one expiry of one underlying, and calibrates
+a whole universe of such smiles in parallel.
+
+Fit() is a Levenberg-Marquardt least squares on the vega weighted price residuals
+	r_i = (V(K_i; sig_i(theta)) - quote_i) / vega_i,	sig_i(theta) = sqrt(w(ln(K_i/F); theta) / T)
+where theta = (a, b, rho, m, s) and vega_i is the vega at the starting parameters (so r_i is close to a volatility
+residual). The Jacobian is analytic: dV/dtheta = Vega(S) * dsig/dw * dw/dtheta, with the price and vega taken from
+GreeksKernel (PricingKernels.hpp), which keeps no state and is safe on the worker threads. Steps are projected on
+b >= 0, |rho| < 1, s > 0 and a + b*s*sqrt(1 - rho^2) >= 0 (non-negative minimum variance). A parameter sitting on
+its bound with the descent direction pointing out of the domain has its Jacobian column zeroed for the iteration,
+and the Jacobian row of a quote whose total variance is floored is zero, so the damped step is computed for the
+model the projection actually prices. Iterations stop when the relative decrease of the cost or the step is below
+the tolerance, or after the maximum number of iterations. A fit that stops because no damping gives a descent step is
+reported as converged only if its vega weighted residuals are below the tolerance; a failed linear solve or a
+non-finite cost is never reported as converged.
+
+Calibrate() keeps a snapshot of the converged parameters per (underlying, expiry) and warm-starts from it on the next
+call, which typically needs a few iterations when the market moved a little. The smiles of different underlyings
+are independent and are fitted by the worker threads, the expiries of one underlying by the same thread.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef SMILECALIBRATOR_HPP
+#define SMILECALIBRATOR_HPP
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+#include "OptionData.hpp"
+#include "VolSurface.hpp"
+using namespace std;
+
+/*Quotes of one expiry of one underlying*/
+struct SmileQuotes {
+	std::string underlying;
+	double S; //spot of the underlying
+	double T; //expiry
+	double rf; //risk-free interest rate
+	double b; //cost of carry
+	std::vector<double> K; //strikes
+	std::vector<double> prices; //quoted prices
+	std::vector<int> types; //EU_CALL or EU_PUT per quote
+};
+
+struct CalibrationResult {
+	std::string underlying;
+	double T;
+	SVIParams params;
+	int iterations;
+	bool warm_start; //started from the previous snapshot
+	bool converged;
+	double rms_residual; //root mean square price residual
+	double max_residual; //largest absolute price residual
+
+	std::string ToString() const;
+};
+
+class SmileCalibrator {
+private:
+	std::map<std::pair<std::string, double>, SVIParams> snapshot; //last fitted parameters per (underlying, T)
+	int m_threads;
+	int max_iterations;
+	double tolerance;
+
+	SVIParams InitialGuess(const SmileQuotes& quotes) const;
+
+public:
+	/*Constructor and destructor*/
+	SmileCalibrator(int p_threads = 0); //0 uses the hardware concurrency
+	virtual ~SmileCalibrator();
+
+	/*Settings*/
+	void Settings(int p_max_iterations, double p_tolerance);
+	int threads() const;
+	void threads(int new_threads);
+
+	/*Calibration*/
+	CalibrationResult Fit(const SmileQuotes& quotes, const SVIParams* start = 0) const; //one smile, from start or from an initial guess
+	std::vector<CalibrationResult> Calibrate(const std::vector<SmileQuotes>& quotes); //results in the order of the quotes, updates the snapshot
+
+	/*Snapshot*/
+	bool Snapshot(const std::string& underlying, double T, SVIParams& params) const;
+	void Surface(const std::string& underlying, VolSurface& surface) const; //adds the snapshot smiles of the underlying to surface
+	void ClearSnapshot();
+};
+
+#endif
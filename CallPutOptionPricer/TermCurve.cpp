@@ -0,0 +1,137 @@
+/* Rate and carry term structures implementation */
+/*****************************************************
+Name: TermCurve.cpp
+version: 0.1
+Description:
+Implementation of the functions in TermCurve.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "TermCurve.hpp"
+#include <algorithm>
+#include <cmath>
+
+/*Constructors and destructor*/
+TermCurve::TermCurve() : interpolation(LINEAR_ZERO), flat(0.0) {}
+
+TermCurve::TermCurve(double p_flat) : interpolation(LINEAR_ZERO), flat(p_flat) {}
+
+TermCurve::TermCurve(const std::vector<double>& T, const std::vector<double>& rates, int p_interpolation)
+	: interpolation(p_interpolation), flat(0.0) {
+	for (size_t i = 0; i < T.size() && i < rates.size(); i++) {
+		AddPillar(T[i], rates[i]);
+	}
+}
+
+TermCurve::~TermCurve() {}
+
+/*Pillars*/
+void TermCurve::AddPillar(double T, double rate) {
+	std::vector<double>::iterator it = std::lower_bound(pillar_T.begin(), pillar_T.end(), T);
+	size_t i = it - pillar_T.begin();
+	if (it != pillar_T.end() && *it == T) {
+		pillar_r[i] = rate;
+	}
+	else {
+		pillar_T.insert(it, T);
+		pillar_r.insert(pillar_r.begin() + i, rate);
+	}
+	cache.clear();
+}
+
+void TermCurve::Interpolation(int p_interpolation) {
+	interpolation = p_interpolation;
+	cache.clear();
+}
+
+int TermCurve::Interpolation() const {
+	return interpolation;
+}
+
+size_t TermCurve::PillarCount() const {
+	return pillar_T.size();
+}
+
+/*Queries*/
+double TermCurve::Interpolate(double T) const {
+	size_t n = pillar_T.size();
+	if (n == 0) {
+		return flat;
+	}
+	if (T <= pillar_T[0]) {
+		return pillar_r[0];
+	}
+	if (T >= pillar_T[n - 1]) {
+		return pillar_r[n - 1];
+	}
+	size_t hi = std::upper_bound(pillar_T.begin(), pillar_T.end(), T) - pillar_T.begin();
+	size_t lo = hi - 1;
+	double w = (T - pillar_T[lo]) / (pillar_T[hi] - pillar_T[lo]);
+	if (interpolation == LOG_LINEAR_DF) { //linear in r*T
+		return ((1.0 - w) * pillar_r[lo] * pillar_T[lo] + w * pillar_r[hi] * pillar_T[hi]) / T;
+	}
+	return (1.0 - w) * pillar_r[lo] + w * pillar_r[hi];
+}
+
+const TermCurve::CacheEntry* TermCurve::Find(double T) const {
+	if (cache.empty()) {
+		return 0;
+	}
+	size_t lo = 0, hi = cache.size();
+	while (lo < hi) { //binary search on the cached expiries
+		size_t mid = (lo + hi) / 2;
+		if (cache[mid].T < T) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return (lo < cache.size() && cache[lo].T == T) ? &cache[lo] : 0;
+}
+
+double TermCurve::Rate(double T) const {
+	const CacheEntry* e = Find(T);
+	return e ? e->r : Interpolate(T);
+}
+
+double TermCurve::DiscountFactor(double T) const {
+	const CacheEntry* e = Find(T);
+	return e ? e->df : exp(-Interpolate(T) * T);
+}
+
+double TermCurve::Growth(double T) const {
+	const CacheEntry* e = Find(T);
+	return e ? 1.0 / e->df : exp(Interpolate(T) * T);
+}
+
+double TermCurve::LongRate() const {
+	return pillar_r.empty() ? flat : pillar_r.back();
+}
+
+/*Cache*/
+void TermCurve::CacheExpiries(const std::vector<double>& expiries) {
+	std::vector<double> T(expiries);
+	for (size_t i = 0; i < cache.size(); i++) {
+		T.push_back(cache[i].T);
+	}
+	std::sort(T.begin(), T.end());
+	T.erase(std::unique(T.begin(), T.end()), T.end());
+	cache.resize(T.size());
+	for (size_t i = 0; i < T.size(); i++) {
+		cache[i].T = T[i];
+		cache[i].r = Interpolate(T[i]);
+		cache[i].df = exp(-cache[i].r * T[i]);
+	}
+}
+
+void TermCurve::ClearCache() {
+	cache.clear();
+}
+
+size_t TermCurve::CacheSize() const {
+	return cache.size();
+}
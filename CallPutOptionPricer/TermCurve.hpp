@@ -0,0 +1,83 @@
+/* Rate and carry term structures */
+/*****************************************************
+Name: TermCurve.hpp
+version: 0.1
+Description:
+Term structure of a continuously compounded rate, used in place of the flat scalars rf (DiscountCurve) and
+b (CarryCurve, e.g. b = r - q for a dividend yield q or b = 0 for futures).
+
+The curve is given by pillars (T_i, r_i) of zero rates and is interpolated either
+LINEAR_ZERO: linearly in the zero rate r(T)
+LOG_LINEAR_DF: linearly in r(T) * T, i.e. log-linearly in the discount factor (piecewise flat forward rates)
+The rate is flat before the first and after the last pillar. A curve without pillars is a flat zero rate.
+
+DiscountFactor(T) = e^(-r(T) * T) and Growth(T) = e^(r(T) * T) cost one exp per call. CacheExpiries() stores
+the rates and factors of a set of expiries (e.g. every expiry of a book) so that later queries of these exact
+expiries are a table lookup. The cache is only written by CacheExpiries, so a cached curve can be shared by threads.
+
+Perpetual American options have no expiry and use the rate of the long end of the curve, LongRate().
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef TERMCURVE_HPP
+#define TERMCURVE_HPP
+
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+enum CurveInterpolation {
+	LINEAR_ZERO = 0,
+	LOG_LINEAR_DF = 1
+};
+
+class TermCurve {
+private:
+	std::vector<double> pillar_T; //increasing
+	std::vector<double> pillar_r; //zero rates
+	int interpolation; //CurveInterpolation
+	double flat; //rate of a curve without pillars
+
+	/*Per-expiry cache, sorted by T*/
+	struct CacheEntry {
+		double T;
+		double r;
+		double df; //e^(-rT)
+	};
+	std::vector<CacheEntry> cache;
+
+	double Interpolate(double T) const;
+	const CacheEntry* Find(double T) const;
+
+public:
+	/*Constructors and destructor*/
+	TermCurve();
+	TermCurve(double p_flat); //flat curve
+	TermCurve(const std::vector<double>& T, const std::vector<double>& rates, int p_interpolation = LINEAR_ZERO);
+	virtual ~TermCurve();
+
+	/*Pillars, adding a pillar clears the cache*/
+	void AddPillar(double T, double rate);
+	void Interpolation(int p_interpolation);
+	int Interpolation() const;
+	size_t PillarCount() const;
+
+	/*Queries*/
+	double Rate(double T) const; //zero rate r(T)
+	double DiscountFactor(double T) const; //e^(-r(T) * T)
+	double Growth(double T) const; //e^(r(T) * T)
+	double LongRate() const; //rate used by perpetual options
+
+	/*Cache*/
+	void CacheExpiries(const std::vector<double>& expiries);
+	void ClearCache();
+	size_t CacheSize() const;
+};
+
+typedef TermCurve DiscountCurve;
+typedef TermCurve CarryCurve;
+
+#endif
@@ -0,0 +1,216 @@
+/* Volatility surface implementation */
+/*****************************************************
+Name: VolSurface.cpp
+version: 0.1
+Description:
+Implementation of the functions in VolSurface.hpp
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#include "VolSurface.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const double MIN_VARIANCE = 1e-12; //floor of the total variance, keeps sqrt and the pricers finite
+
+/*Smile implementation*/
+double VolSurface::Smile::TotalVariance(double x) const {
+	if (svi) {
+		double d = x - p.m;
+		return std::max(p.a + p.b * (p.rho * d + sqrt(d * d + p.s * p.s)), MIN_VARIANCE);
+	}
+	size_t n = k.size();
+	if (n == 1) {
+		return w[0];
+	}
+	if (x <= k[0]) { //linear extrapolation with the end slopes of the spline
+		double h = k[1] - k[0];
+		double slope = (w[1] - w[0]) / h - h * (2.0 * w2[0] + w2[1]) / 6.0;
+		return std::max(w[0] + slope * (x - k[0]), MIN_VARIANCE);
+	}
+	if (x >= k[n - 1]) {
+		double h = k[n - 1] - k[n - 2];
+		double slope = (w[n - 1] - w[n - 2]) / h + h * (w2[n - 2] + 2.0 * w2[n - 1]) / 6.0;
+		return std::max(w[n - 1] + slope * (x - k[n - 1]), MIN_VARIANCE);
+	}
+	size_t j = std::upper_bound(k.begin(), k.end(), x) - k.begin() - 1;
+	double h = k[j + 1] - k[j];
+	double A = (k[j + 1] - x) / h;
+	double B = 1.0 - A;
+	double value = A * w[j] + B * w[j + 1] + ((A * A * A - A) * w2[j] + (B * B * B - B) * w2[j + 1]) * h * h / 6.0;
+	return std::max(value, MIN_VARIANCE);
+}
+
+void VolSurface::Smile::TotalVariance(size_t n, const double* x, double* out) const {
+	if (svi) {
+		//no branches nor calls besides sqrt so that the loop vectorizes
+		const double a = p.a, b = p.b, rho = p.rho, m = p.m, s2 = p.s * p.s;
+		for (size_t i = 0; i < n; i++) {
+			double d = x[i] - m;
+			double v = a + b * (rho * d + sqrt(d * d + s2));
+			out[i] = (v > MIN_VARIANCE) ? v : MIN_VARIANCE;
+		}
+		return;
+	}
+	for (size_t i = 0; i < n; i++) {
+		out[i] = TotalVariance(x[i]);
+	}
+}
+
+/*Constructor and destructor*/
+VolSurface::VolSurface() {}
+
+VolSurface::~VolSurface() {}
+
+/*Smiles*/
+void VolSurface::Insert(const Smile& smile) {
+	for (size_t i = 0; i < smiles.size(); i++) {
+		if (smiles[i].T == smile.T) {
+			smiles[i] = smile;
+			return;
+		}
+		if (smiles[i].T > smile.T) {
+			smiles.insert(smiles.begin() + i, smile);
+			return;
+		}
+	}
+	smiles.push_back(smile);
+}
+
+void VolSurface::AddSVI(double T, const SVIParams& params) {
+	Smile smile;
+	smile.T = T;
+	smile.svi = true;
+	smile.p = params;
+	Insert(smile);
+}
+
+void VolSurface::AddSpline(double T, const std::vector<double>& k, const std::vector<double>& vols) {
+	Smile smile;
+	smile.T = T;
+	smile.svi = false;
+	smile.p = SVIParams();
+	size_t n = std::min(k.size(), vols.size());
+	if (n == 0) {
+		return;
+	}
+	smile.k.assign(k.begin(), k.begin() + n);
+	smile.w.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		smile.w[i] = vols[i] * vols[i] * T;
+	}
+	//natural cubic spline second derivatives (tridiagonal system, Thomas algorithm)
+	smile.w2.assign(n, 0.0);
+	if (n > 2) {
+		std::vector<double> u(n, 0.0);
+		for (size_t i = 1; i + 1 < n; i++) {
+			double sigma = (k[i] - k[i - 1]) / (k[i + 1] - k[i - 1]);
+			double q = sigma * smile.w2[i - 1] + 2.0;
+			smile.w2[i] = (sigma - 1.0) / q;
+			double slope = (smile.w[i + 1] - smile.w[i]) / (k[i + 1] - k[i]) - (smile.w[i] - smile.w[i - 1]) / (k[i] - k[i - 1]);
+			u[i] = (6.0 * slope / (k[i + 1] - k[i - 1]) - sigma * u[i - 1]) / q;
+		}
+		smile.w2[n - 1] = 0.0;
+		for (size_t i = n - 1; i-- > 0;) {
+			smile.w2[i] = smile.w2[i] * smile.w2[i + 1] + u[i];
+		}
+	}
+	Insert(smile);
+}
+
+void VolSurface::Clear() {
+	smiles.clear();
+}
+
+size_t VolSurface::ExpiryCount() const {
+	return smiles.size();
+}
+
+double VolSurface::Expiry(size_t i) const {
+	return smiles[i].T;
+}
+
+/*Lookups*/
+void VolSurface::Bracket(double T, size_t& lo, size_t& hi, double& w_lo, double& w_hi) const {
+	size_t n = smiles.size();
+	if (T <= smiles[0].T) { //flat volatility before the first expiry
+		lo = hi = 0;
+		w_lo = T / smiles[0].T;
+		w_hi = 0.0;
+		return;
+	}
+	if (T >= smiles[n - 1].T) { //flat volatility after the last expiry
+		lo = hi = n - 1;
+		w_lo = T / smiles[n - 1].T;
+		w_hi = 0.0;
+		return;
+	}
+	hi = 1;
+	while (smiles[hi].T < T) {
+		hi++;
+	}
+	lo = hi - 1;
+	w_hi = (T - smiles[lo].T) / (smiles[hi].T - smiles[lo].T);
+	w_lo = 1.0 - w_hi;
+}
+
+double VolSurface::TotalVariance(double k, double T) const {
+	if (smiles.empty()) {
+		return 0.0;
+	}
+	size_t lo, hi;
+	double w_lo, w_hi;
+	Bracket(T, lo, hi, w_lo, w_hi);
+	double w = w_lo * smiles[lo].TotalVariance(k);
+	if (w_hi > 0.0) {
+		w += w_hi * smiles[hi].TotalVariance(k);
+	}
+	return w;
+}
+
+double VolSurface::Vol(double k, double T) const {
+	PRICER_PROBE("VolSurface::Vol");
+	if (smiles.empty() || T <= 0.0) {
+		return 0.0;
+	}
+	return sqrt(TotalVariance(k, T) / T);
+}
+
+double VolSurface::Vol(double F, double K, double T) const {
+	return Vol(log(K / F), T);
+}
+
+void VolSurface::Vols(double F, double T, size_t n, const double* K, double* out) const {
+	PRICER_PROBE("VolSurface::Vols");
+	if (n == 0) {
+		return;
+	}
+	if (smiles.empty() || T <= 0.0) {
+		std::fill(out, out + n, 0.0);
+		return;
+	}
+	size_t lo, hi;
+	double w_lo, w_hi;
+	Bracket(T, lo, hi, w_lo, w_hi);
+	std::vector<double> k(n), upper;
+	for (size_t i = 0; i < n; i++) {
+		k[i] = log(K[i] / F);
+	}
+	smiles[lo].TotalVariance(n, &k[0], out);
+	if (w_hi > 0.0) {
+		upper.resize(n);
+		smiles[hi].TotalVariance(n, &k[0], &upper[0]);
+		for (size_t i = 0; i < n; i++) {
+			out[i] = sqrt((w_lo * out[i] + w_hi * upper[i]) / T);
+		}
+	}
+	else {
+		for (size_t i = 0; i < n; i++) {
+			out[i] = sqrt(w_lo * out[i] / T);
+		}
+	}
+}
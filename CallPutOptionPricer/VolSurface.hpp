@@ -0,0 +1,75 @@
+/* Volatility surface */
+/*****************************************************
+Name: VolSurface.hpp
+version: 0.1
+Description:
+Implied volatility surface in log forward moneyness k = ln(K/F), F = S * e^(bT), and expiry T, so pricers can
+look the volatility of a contract up directly instead of being handed one constant sig.
+
+The surface is a set of smiles, one per expiry, each of them giving the total implied variance w(k) = sig^2 * T:
+SVI smile: w(k) = a + b * (rho * (k - m) + sqrt((k - m)^2 + s^2)) (raw SVI parametrization)
+Spline smile: natural cubic spline of w through implied vols quoted on log moneyness nodes, extrapolated linearly
+Between two expiries the total variance is interpolated linearly in T at fixed k (which keeps the surface free of
+calendar arbitrage when the smiles are). Before the first and after the last expiry the total variance is scaled
+with T, i.e. the volatility is extrapolated flat in T.
+
+Everything that only depends on the smile (the spline second derivatives) is computed once when the smile is
+added. The batch lookup Vols() locates the expiry bracket and the time weights once and then runs over the strikes
+with branch-free loops for SVI smiles.
+
+Change history:
+0.1 Initial version
+
+******************************************************/
+
+#ifndef VOLSURFACE_HPP
+#define VOLSURFACE_HPP
+
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+/*Raw SVI parameters*/
+struct SVIParams {
+	double a; //level of the total variance
+	double b; //slope of the wings
+	double rho; //skew, in (-1, 1)
+	double m; //horizontal shift
+	double s; //curvature at the money (sigma in the SVI literature)
+};
+
+class VolSurface {
+private:
+	struct Smile {
+		double T;
+		bool svi;
+		SVIParams p; //SVI smile
+		std::vector<double> k, w, w2; //spline smile: nodes, total variances and their second derivatives
+		double TotalVariance(double k) const;
+		void TotalVariance(size_t n, const double* k, double* out) const;
+	};
+	std::vector<Smile> smiles; //sorted by expiry
+
+	void Insert(const Smile& smile);
+	void Bracket(double T, size_t& lo, size_t& hi, double& w_lo, double& w_hi) const; //w(k, T) = w_lo * w_lo smile + w_hi * w_hi smile
+
+public:
+	/*Constructor and destructor*/
+	VolSurface();
+	virtual ~VolSurface();
+
+	/*Smiles, an existing smile with the same expiry is replaced*/
+	void AddSVI(double T, const SVIParams& params);
+	void AddSpline(double T, const std::vector<double>& k, const std::vector<double>& vols); //vols quoted on log moneyness nodes k (increasing)
+	void Clear();
+	size_t ExpiryCount() const;
+	double Expiry(size_t i) const;
+
+	/*Lookups*/
+	double TotalVariance(double k, double T) const;
+	double Vol(double k, double T) const;
+	double Vol(double F, double K, double T) const; //volatility of strike K for the forward F
+	void Vols(double F, double T, size_t n, const double* K, double* out) const; //batch lookup of n strikes of one expiry
+};
+
+#endif
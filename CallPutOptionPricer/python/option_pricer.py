@@ -0,0 +1,151 @@
+"""NumPy bindings of the C interface of the pricer (OptionPricerCAPI.h).
+
+The arrays are handed to the library in place: a one-dimensional, C contiguous array of the expected dtype
+(float64, int32 for the option types) is never copied, other inputs (lists, scalars, strided views, other dtypes)
+are converted once. Scalars are broadcast to the length of the batch. The library is called through ctypes.CDLL,
+which releases the GIL for the duration of each call, so other Python threads keep running while a batch prices.
+
+The shared library is looked up in OPTION_PRICER_LIB, then next to this file and in the working directory
+(liboptionpricer.so, liboptionpricer.dylib or optionpricer.dll). See README.md for the build.
+"""
+
+import ctypes
+import os
+import sys
+
+import numpy as np
+
+EU_CALL, EU_PUT, US_CALL, US_PUT = 0, 1, 2, 3
+API_VERSION = 1
+
+_OK = 0
+_ERRORS = {-1: "a required array is NULL", -2: "unknown option type (the outputs of those elements are NaN)"}
+
+_double_p = ctypes.POINTER(ctypes.c_double)
+_int_p = ctypes.POINTER(ctypes.c_int)
+_size_t_p = ctypes.POINTER(ctypes.c_size_t)
+
+
+def _library_names():
+    if sys.platform.startswith("win"):
+        return ["optionpricer.dll"]
+    if sys.platform == "darwin":
+        return ["liboptionpricer.dylib", "liboptionpricer.so"]
+    return ["liboptionpricer.so"]
+
+
+def _load():
+    candidates = []
+    if os.environ.get("OPTION_PRICER_LIB"):
+        candidates.append(os.environ["OPTION_PRICER_LIB"])
+    for folder in (os.path.dirname(os.path.abspath(__file__)), os.getcwd()):
+        candidates.extend(os.path.join(folder, name) for name in _library_names())
+    for path in candidates:
+        if os.path.exists(path):
+            return ctypes.CDLL(path)
+    raise OSError("option pricer library not found, tried: " + ", ".join(candidates))
+
+
+_lib = _load()
+_lib.op_api_version.restype = ctypes.c_int
+_lib.op_api_version.argtypes = []
+_lib.op_price.restype = ctypes.c_int
+_lib.op_price.argtypes = [ctypes.c_size_t, _int_p] + [_double_p] * 7 + [ctypes.c_int]
+_lib.op_greeks.restype = ctypes.c_int
+_lib.op_greeks.argtypes = [ctypes.c_size_t, _int_p] + [_double_p] * 11 + [ctypes.c_int]
+_lib.op_implied_vol.restype = ctypes.c_int
+_lib.op_implied_vol.argtypes = [ctypes.c_size_t, _int_p] + [_double_p] * 7 + [_size_t_p, ctypes.c_int]
+
+if _lib.op_api_version() != API_VERSION:
+    raise OSError("option pricer library has ABI version %d, expected %d" % (_lib.op_api_version(), API_VERSION))
+
+
+def _batch_length(*args):
+    n = 1
+    for a in args:
+        size = np.size(a)
+        if size != 1:
+            if n != 1 and size != n:
+                raise ValueError("inputs have different lengths (%d and %d)" % (n, size))
+            n = size
+    return n
+
+
+def _input(a, n, dtype):
+    """Returns a contiguous array of length n, the argument itself when it already is one."""
+    a = np.asarray(a)
+    if a.size == 1 and n != 1:
+        return np.full(n, a.reshape(-1)[0], dtype=dtype)
+    return np.ascontiguousarray(a.reshape(-1), dtype=dtype)
+
+
+def _output(out, n):
+    if out is None:
+        return np.empty(n, dtype=np.float64)
+    if out.dtype != np.float64 or out.ndim != 1 or out.size != n or not out.flags.c_contiguous:
+        raise ValueError("out must be a contiguous float64 array of length %d" % n)
+    return out
+
+
+def _pointer(a, kind=_double_p):
+    return a.ctypes.data_as(kind) if a is not None else None
+
+
+def _check(status):
+    if status != _OK:
+        raise ValueError(_ERRORS.get(status, "error %d" % status))
+
+
+def price(type, S, K, T, sig, rf, b, out=None, threads=0):
+    """Prices of the contracts. threads: 1 for the calling thread only, 0 for every core."""
+    n = _batch_length(type, S, K, T, sig, rf, b)
+    args = [_input(type, n, np.int32)] + [_input(x, n, np.float64) for x in (S, K, T, sig, rf, b)]
+    out = _output(out, n)
+    _check(_lib.op_price(n, _pointer(args[0], _int_p), *[_pointer(x) for x in args[1:]], _pointer(out), threads))
+    return out
+
+
+def greeks(type, S, K, T, sig, rf, b, which=("delta", "gamma", "vega", "theta", "rho"), threads=0):
+    """Dictionary of the requested Greeks; the ones not requested are not computed."""
+    n = _batch_length(type, S, K, T, sig, rf, b)
+    args = [_input(type, n, np.int32)] + [_input(x, n, np.float64) for x in (S, K, T, sig, rf, b)]
+    names = ("delta", "gamma", "vega", "theta", "rho")
+    outs = dict((name, np.empty(n, dtype=np.float64)) for name in names if name in which)
+    _check(_lib.op_greeks(n, _pointer(args[0], _int_p), *[_pointer(x) for x in args[1:]],
+                          *[_pointer(outs.get(name)) for name in names], threads))
+    return outs
+
+
+def implied_vol(type, price, S, K, T, rf, b, out=None, threads=0):
+    """Implied volatilities; NaN where the price is outside the no-arbitrage bounds or does not identify the vol.
+    Returns (vols, failures)."""
+    n = _batch_length(type, price, S, K, T, rf, b)
+    args = [_input(type, n, np.int32)] + [_input(x, n, np.float64) for x in (price, S, K, T, rf, b)]
+    out = _output(out, n)
+    failures = ctypes.c_size_t(0)
+    _check(_lib.op_implied_vol(n, _pointer(args[0], _int_p), *[_pointer(x) for x in args[1:]], _pointer(out),
+                               ctypes.byref(failures), threads))
+    return out, failures.value
+
+
+if __name__ == "__main__":
+    import time
+
+    n = 1000000
+    rng = np.random.default_rng(1)
+    types = rng.integers(0, 2, n).astype(np.int32)
+    S = rng.uniform(80.0, 120.0, n)
+    K = rng.uniform(80.0, 120.0, n)
+    T = rng.uniform(0.1, 2.0, n)
+    sig = rng.uniform(0.1, 0.5, n)
+    t0 = time.perf_counter()
+    prices = price(types, S, K, T, sig, 0.05, 0.03)
+    t1 = time.perf_counter()
+    vols, failures = implied_vol(types, prices, S, K, T, 0.05, 0.03)
+    t2 = time.perf_counter()
+    g = greeks(types, S, K, T, sig, 0.05, 0.03, which=("delta", "vega"))
+    t3 = time.perf_counter()
+    print("%d contracts: price %.1f ms, implied vol %.1f ms (%d failures, max error %.2e), delta and vega %.1f ms"
+          % (n, (t1 - t0) * 1e3, (t2 - t1) * 1e3, failures, np.nanmax(np.abs(vols - sig)), (t3 - t2) * 1e3))
+    print("Call at the money: price %.6f, delta %.6f" % (price(EU_CALL, 100.0, 100.0, 1.0, 0.2, 0.05, 0.05)[0],
+                                                         greeks(EU_CALL, 100.0, 100.0, 1.0, 0.2, 0.05, 0.05)["delta"][0]))
@@ -1,12 +1,16 @@
 /* Call and Put Options functions */
 /*****************************************************
 Name: AmericanOption.cpp
-version: 0.1
+version: 0.5
 Description:
 Implementation of the functions provided in AmericanOption.hpp for Perpetual American Options
 
 Change history:
 0.1 Initial version
+0.2 Closed form Greeks, exercise boundary and parameter sweeps shared by the call and the put
+0.3 Implied volatility and implied carry solvers
+0.4 Intrinsic value and Greeks in the exercise region
+0.5 Implied solvers fail when they do not converge
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -35,6 +39,11 @@ expiry price T tends to infinity. In general, American options are worth more th
 ******************************************************/
 
 #include "AmericanOption.hpp"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "../CallPutOptionPricer/Instrumentation.hpp"
+#include "../CallPutOptionPricer/ParallelFor.hpp"
 #include "boost/random.hpp"
 #include "boost/generator_iterator.hpp"
 
@@ -77,3 +86,190 @@ std::string UsOpt::Print() const {
 	print_info << ToString() << std::endl; //use ToString polymorphic function
 	return print_info.str();
 }
+
+/*Closed form shared by UsOptCall and UsOptPut*/
+PerpetualFactors UsOpt::Factors(bool call, double K, double sig, double rf, double b) {
+	//y = -q +/- R with u = 1/sig^2, q = b*u - 1/2 and R = sqrt(q^2 + 2*rf*u)
+	PerpetualFactors f;
+	f.call = call;
+	f.strike = K;
+	double s = call ? 1.0 : -1.0;
+	double u = 1.0 / (sig*sig);
+	double q = b*u - 0.5;
+	double R = sqrt(q*q + 2.0*rf*u);
+	f.y = -q + s*R;
+	f.exercised = !(call && f.y <= 1.0);
+	if (!f.exercised) { //b >= rf: the call is never exercised and is worth S
+		f.y = 1.0;
+		f.boundary = std::numeric_limits<double>::infinity();
+		f.premium = 0.0;
+		f.dy_dsig = f.d2y_dsig2 = f.dy_drf = f.dy_db = 0.0;
+		return f;
+	}
+	f.boundary = K * f.y / (f.y - 1.0);
+	f.premium = s * (f.boundary - K);
+	double dy_du = -b + s*(q*b + rf) / R;
+	double d2y_du2 = s*(b*b*R*R - (q*b + rf)*(q*b + rf)) / (R*R*R);
+	double sig3 = sig*sig*sig;
+	f.dy_dsig = -2.0 * dy_du / sig3; //du/dsig = -2/sig^3
+	f.d2y_dsig2 = d2y_du2 * 4.0 / (sig3*sig3) + dy_du * 6.0 / (sig3*sig);
+	f.dy_drf = s*u / R;
+	f.dy_db = u*(s*q / R - 1.0);
+	return f;
+}
+
+PerpetualGreeks UsOpt::Evaluate(const PerpetualFactors& f, double S) {
+	PerpetualGreeks g;
+	if (!f.exercised) {
+		g.price = S;
+		g.delta = 1.0;
+		g.gamma = g.vega = g.rho = 0.0;
+		return g;
+	}
+	if (f.call ? S >= f.boundary : S <= f.boundary) { //exercise region: worth the intrinsic value
+		g.price = f.call ? S - f.strike : f.strike - S;
+		g.delta = f.call ? 1.0 : -1.0;
+		g.gamma = g.vega = g.rho = 0.0;
+		return g;
+	}
+	double L = log(S / f.boundary);
+	g.price = f.premium * exp(f.y * L); //premium * (S/S*)^y
+	g.delta = f.y * g.price / S;
+	g.gamma = f.y * (f.y - 1.0) * g.price / (S*S);
+	g.vega = g.price * L * f.dy_dsig;
+	g.rho = g.price * L * (f.dy_drf + f.dy_db);
+	return g;
+}
+
+void UsOpt::Sweep(bool call, double K, double sig, double rf, double b, int num, double S, double start, double end, SweepParameter param, PerpetualSweep& out) {
+	//num equals the number of increments before reaching end
+	size_t n = (num > 0) ? (size_t)num + 1 : 1;
+	out.grid.resize(n);
+	out.price.resize(n);
+	out.delta.resize(n);
+	out.gamma.resize(n);
+	out.vega.resize(n);
+	out.rho.resize(n);
+	out.boundary.resize(n);
+	double mesh_size = (num > 0) ? (end - start) / num : 0.0; //increment size h
+	PerpetualFactors f = Factors(call, K, sig, rf, b); //the spot sweep computes the exponent once
+	for (size_t i = 0; i < n; i++) {
+		double x = start + i*mesh_size;
+		double spot = S;
+		switch (param) {
+		case SWEEP_SPOT:
+			spot = x;
+			break;
+		case SWEEP_SIGMA:
+			f = Factors(call, K, x, rf, b);
+			break;
+		case SWEEP_RATE:
+			f = Factors(call, K, sig, x, b);
+			break;
+		case SWEEP_CARRY:
+			f = Factors(call, K, sig, rf, x);
+			break;
+		}
+		PerpetualGreeks g = Evaluate(f, spot);
+		out.grid[i] = x;
+		out.price[i] = g.price;
+		out.delta[i] = g.delta;
+		out.gamma[i] = g.gamma;
+		out.vega[i] = g.vega;
+		out.rho[i] = g.rho;
+		out.boundary[i] = f.boundary;
+	}
+}
+
+/*Implied parameters*/
+bool UsOpt::Implied(bool call, double S, double price, double K, double sig, double rf, double b, SweepParameter param, double& result) {
+	result = std::numeric_limits<double>::quiet_NaN();
+	if (param != SWEEP_SIGMA && param != SWEEP_CARRY) {
+		return false;
+	}
+	double intrinsic = call ? S - K : K - S;
+	if (!(price > intrinsic && price > 0.0 && S > 0.0)) {
+		return false;
+	}
+	//price and slope in the unknown x, intrinsic value (zero slope) in the exercise region
+	double lo, hi, x, dir;
+	if (param == SWEEP_SIGMA) {
+		lo = IMPLIED_SIG_MIN;
+		hi = IMPLIED_SIG_MAX;
+		x = sig;
+		dir = 1.0;
+	}
+	else {
+		lo = IMPLIED_CARRY_MIN;
+		hi = call ? std::min(IMPLIED_CARRY_MAX, rf) : IMPLIED_CARRY_MAX;
+		x = b;
+		dir = call ? 1.0 : -1.0;
+	}
+	double tol = 1e-12 * std::max(1.0, price);
+	double value, slope;
+	for (int end = 0; end < 2; end++) { //the price must lie between the values at the two ends of the bracket
+		PerpetualFactors f = (param == SWEEP_SIGMA) ? Factors(call, K, end ? hi : lo, rf, b) : Factors(call, K, sig, rf, end ? hi : lo);
+		bool exercise = f.exercised && (call ? S >= f.boundary : S <= f.boundary);
+		value = exercise ? intrinsic : Evaluate(f, S).price;
+		double gap = dir * (value - price) * (end ? 1.0 : -1.0); //> 0 when the price is inside
+		if (gap < 0.0) {
+			return false;
+		}
+	}
+	if (!(x > lo && x < hi)) {
+		x = 0.5 * (lo + hi);
+	}
+	for (int it = 0; it < 100; it++) {
+		PerpetualFactors f = (param == SWEEP_SIGMA) ? Factors(call, K, x, rf, b) : Factors(call, K, sig, rf, x);
+		bool exercise = f.exercised && (call ? S >= f.boundary : S <= f.boundary);
+		if (exercise || !f.exercised) {
+			value = exercise ? intrinsic : S;
+			slope = 0.0;
+		}
+		else {
+			PerpetualGreeks g = Evaluate(f, S);
+			value = g.price;
+			slope = g.price * log(S / f.boundary) * ((param == SWEEP_SIGMA) ? f.dy_dsig : f.dy_db);
+		}
+		double diff = value - price;
+		if (fabs(diff) <= tol) {
+			result = x;
+			return true;
+		}
+		if (dir * diff < 0.0) {
+			lo = x;
+		}
+		else {
+			hi = x;
+		}
+		if (hi - lo <= 1e-15 * std::max(1.0, fabs(x))) { //the bracket collapsed: x is only a solution if it reprices
+			if (fabs(diff) <= IMPLIED_COLLAPSE_TOL * std::max(1.0, price)) {
+				result = x;
+				return true;
+			}
+			return false;
+		}
+		double next = (slope != 0.0) ? x - diff / slope : lo - 1.0;
+		x = (next > lo && next < hi) ? next : 0.5 * (lo + hi);
+	}
+	return false; //not converged in 100 iterations
+}
+
+size_t UsOpt::ImpliedBatch(const std::vector<PerpetualQuote>& quotes, SweepParameter param, std::vector<double>& out, int threads) {
+	PRICER_PROBE("UsOpt::ImpliedBatch");
+	out.resize(quotes.size());
+	const size_t block = 1024;
+	std::atomic<size_t> failures(0);
+	ParallelFor((quotes.size() + block - 1) / block, threads, [&](size_t blk) {
+		size_t failed = 0;
+		size_t end = std::min(quotes.size(), (blk + 1) * block);
+		for (size_t i = blk * block; i < end; i++) {
+			const PerpetualQuote& q = quotes[i];
+			if (!Implied(q.call, q.S, q.price, q.data.K, q.data.sig, q.data.rf, q.data.b, param, out[i])) {
+				failed++;
+			}
+		}
+		failures += failed;
+	});
+	return failures;
+}
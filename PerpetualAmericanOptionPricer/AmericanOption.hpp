@@ -1,12 +1,16 @@
 /* Call and Put Options functions */
 /*****************************************************
 Name: AmericanOption.hpp
-version: 0.1
+version: 0.5
 Description:
 These functions provide functionality for Perpetual American Options
 
 Change history:
 0.1 Initial version
+0.2 Closed form Greeks, exercise boundary and parameter sweeps shared by the call and the put
+0.3 Implied volatility and implied carry solvers
+0.4 Intrinsic value and Greeks in the exercise region
+0.5 Implied solvers fail when they do not converge
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -32,6 +36,26 @@ y2 = 1/2 - b/sig^2 - sqrt((b/sig^2 - 1/2)^2 + (2*r)/sig^2)
 In general, the perpetual price is the time-homogeneous price and is the same as the normal price when the
 expiry price T tends to infinity. In general, American options are worth more than European options.
 
+Greeks and exercise boundary. With y = y1 (call) or y2 (put), the optimal exercise level is S* = K*y/(y-1) and
+the price is V = (S* - K)*(S/S*)^y for the call and V = (K - S*)*(S/S*)^y for the put. Hence:
+delta = y*V/S, gamma = y*(y-1)*V/S^2,
+and since S* is optimal, dV/dy = V*ln(S/S*), so vega and rho follow from the derivatives of y in sig and rf:
+vega = V*ln(S/S*)*dy/dsig, rho = V*ln(S/S*)*(dy/drf + dy/db) (rf and b move together, rf - b fixed).
+The formulae hold in the continuation region (S < S* for the call, S > S* for the put); the call is exercised
+at S >= S*, the put at S <= S*, where the option is worth its intrinsic value S - K (resp. K - S) with delta 1
+(resp. -1) and zero gamma, vega and rho. A call with b >= rf is never exercised (S* infinite) and is worth S.
+UsOpt::Factors computes y, S* and the derivatives of y once; Evaluate and Sweep reuse them for every spot of a
+grid, and the sig, rf and b sweeps compute them once per grid point for all the outputs.
+
+Implied parameters. Taking the intrinsic value in the exercise region, the price is continuous and monotone in
+sig (increasing) and in b (increasing for the call, decreasing for the put), so an observed price above the
+intrinsic value has a single implied sig or b. The solvers take Newton steps on dV/dsig = V*ln(S/S*)*dy/dsig
+(resp. dy/db) inside a bracket that shrinks on every evaluation, and bisect when a step leaves the bracket or the
+trial point is in the exercise region (zero slope). Brackets: sig in [IMPLIED_SIG_MIN, IMPLIED_SIG_MAX], b in
+[IMPLIED_CARRY_MIN, IMPLIED_CARRY_MAX] (capped at rf for the call, which is worth S for b >= rf).
+A solve succeeds when the price is repriced to 1e-12 * max(1, price), or to IMPLIED_COLLAPSE_TOL * max(1, price)
+once the bracket has collapsed to rounding; it fails (NaN) otherwise, including after 100 iterations.
+
 ******************************************************/
 
 #ifndef USOPTION_HPP
@@ -45,6 +69,51 @@ expiry price T tends to infinity. In general, American options are worth more th
 #include <iterator>
 using namespace std;
 
+/*Exponent of a perpetual option and its derivatives, computed once and shared by the outputs*/
+struct PerpetualFactors {
+	bool call;
+	bool exercised; //false for a call that is never exercised (b >= rf): worth S
+	double strike;
+	double y; //y1 for a call, y2 for a put
+	double boundary; //optimal exercise level S*
+	double premium; //S* - K for a call, K - S* for a put
+	double dy_dsig, d2y_dsig2, dy_drf, dy_db;
+};
+
+/*Price and Greeks at one spot*/
+struct PerpetualGreeks {
+	double price, delta, gamma, vega, rho;
+};
+
+/*Parameter swept by Sweep*/
+enum SweepParameter {
+	SWEEP_SPOT = 0,
+	SWEEP_SIGMA = 1,
+	SWEEP_RATE = 2,
+	SWEEP_CARRY = 3
+};
+
+/*Results of a sweep, one entry per grid point*/
+struct PerpetualSweep {
+	std::vector<double> grid; //value of the swept parameter
+	std::vector<double> price, delta, gamma, vega, rho;
+	std::vector<double> boundary; //exercise level S* at the grid point
+};
+
+/*Observed price of a perpetual option, for the implied parameter solvers*/
+struct PerpetualQuote {
+	bool call;
+	double S; //spot
+	double price; //observed price
+	OptionData data; //rf, K and the known parameter; the sig (or b) being solved for is the starting point
+};
+
+const double IMPLIED_SIG_MIN = 1e-3;
+const double IMPLIED_SIG_MAX = 5.0;
+const double IMPLIED_CARRY_MIN = -1.0;
+const double IMPLIED_CARRY_MAX = 1.0;
+const double IMPLIED_COLLAPSE_TOL = 1e-9; //residual accepted, relative to max(1, price), when the bracket collapses
+
 class UsOpt {
 private:
 	/*Contract number and underlying stock*/
@@ -63,6 +132,18 @@ public:
 	/*Printing functions*/
 	virtual std::string ToString() const;
 	std::string Print() const;
+
+	/*Implied sig (param = SWEEP_SIGMA) or b (param = SWEEP_CARRY) of every quote, NaN when the price has no
+	solution in the bracket or the solve does not converge. Returns the number of failures. threads > 1 shares the
+	quotes between threads*/
+	static size_t ImpliedBatch(const std::vector<PerpetualQuote>& quotes, SweepParameter param, std::vector<double>& out, int threads = 1);
+
+protected:
+	/*Closed form shared by UsOptCall and UsOptPut*/
+	static PerpetualFactors Factors(bool call, double K, double sig, double rf, double b);
+	static PerpetualGreeks Evaluate(const PerpetualFactors& f, double S);
+	static void Sweep(bool call, double K, double sig, double rf, double b, int num, double S, double start, double end, SweepParameter param, PerpetualSweep& out);
+	static bool Implied(bool call, double S, double price, double K, double sig, double rf, double b, SweepParameter param, double& result);
 };
 
 #endif
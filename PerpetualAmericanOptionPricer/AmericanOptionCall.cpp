@@ -1,12 +1,17 @@
 /* Call Options functions */
 /*****************************************************
 Name: AmericanOptionCall.cpp
-version: 0.1
+version: 0.6
 Description:
 Implementation of the functions provided in AmericanOption.hpp for Perpetual American Options
 
 Change history:
 0.1 Initial version
+0.2 Shared-grid divided differences Greek ladders (GreeksLadderDDM)
+0.3 Pricing with rate and carry term structures (long end of the curves)
+0.4 Closed form Greeks, exercise boundary and parameter sweeps
+0.5 Implied volatility and implied carry
+0.6 Intrinsic value in the exercise region
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -36,6 +41,9 @@ expiry price T tends to infinity. In general, American options are worth more th
 
 #include "AmericanOptionCall.hpp"
 #include <cmath>
+#include "../CallPutOptionPricer/Instrumentation.hpp"
+#include "../CallPutOptionPricer/GreeksLadder.hpp"
+#include "../CallPutOptionPricer/TermCurve.hpp"
 #include <iostream>
 
 /*Default constructor, parameterized constructor, copy constructor, and destructor implementation*/
@@ -109,20 +117,35 @@ void UsOptCall::CostOfCarry(double new_b) {
 }
 
 /*Pricer functions implementation*/
-double UsOptCall::Price(double S) const {
+double UsOptCall::PriceAt(double S, double p_rf, double p_b) const {
 	double y1;
 	double C;
-	y1 = 0.5 - b/pow(sig,2) + sqrt((b/pow(sig,2) - 0.5)*(b / pow(sig, 2) - 0.5) + 2.0*rf/pow(sig, 2));
-	if (y1 == 1.0)
+	y1 = 0.5 - p_b/pow(sig,2) + sqrt((p_b/pow(sig,2) - 0.5)*(p_b / pow(sig, 2) - 0.5) + 2.0*p_rf/pow(sig, 2));
+	if (y1 <= 1.0) //b >= rf gives y1 = 1 up to rounding: the call is never exercised and is worth S
 	{
 		return S;
 	}
+	if (S >= K * y1 / (y1 - 1)) //exercise region S >= S*: worth the intrinsic value
+	{
+		return S - K;
+	}
 	C = (K / (y1 - 1)) * pow(((y1 - 1) / y1 * S / K), y1);
 	
 	return C;
 }
 
+double UsOptCall::Price(double S) const {
+	PRICER_PROBE("UsOptCall::Price");
+	return PriceAt(S, rf, b);
+}
+
+double UsOptCall::Price(double S, const TermCurve& rates, const TermCurve& carry) const {
+	PRICER_PROBE("UsOptCall::Price(curves)");
+	return PriceAt(S, rates.LongRate(), carry.LongRate()); //a perpetual option discounts at the long end
+}
+
 std::vector<double> UsOptCall::PriceRange(int num, double start_S, double end_S) { //num equals the number of increments before reaching the end price end_S
+	PRICER_PROBE("UsOptCall::PriceRange");
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
 	double mesh_size = (end_S - start_S) / num; //increment size h
@@ -134,6 +157,57 @@ std::vector<double> UsOptCall::PriceRange(int num, double start_S, double end_S)
 }
 
 
+void UsOptCall::GreeksLadderDDM(int num, double h, double start_S, double end_S, std::vector<double>& deltas, std::vector<double>& gammas) const {
+	PRICER_PROBE("UsOptCall::GreeksLadderDDM");
+	::GreeksLadderDDM(num, h, start_S, end_S, [this](double S) { return this->Price(S); }, deltas, gammas);
+}
+
+/*Sensitivities and optimal exercise implementation*/
+double UsOptCall::Delta(double S) const {
+	PRICER_PROBE("UsOptCall::Delta");
+	return Evaluate(Factors(true, K, sig, rf, b), S).delta; //y*V/S
+}
+
+double UsOptCall::Gamma(double S) const {
+	PRICER_PROBE("UsOptCall::Gamma");
+	return Evaluate(Factors(true, K, sig, rf, b), S).gamma; //y*(y-1)*V/S^2
+}
+
+double UsOptCall::Vega(double S) const {
+	PRICER_PROBE("UsOptCall::Vega");
+	return Evaluate(Factors(true, K, sig, rf, b), S).vega; //V*ln(S/S*)*dy/dsig
+}
+
+double UsOptCall::Rho(double S) const {
+	PRICER_PROBE("UsOptCall::Rho");
+	return Evaluate(Factors(true, K, sig, rf, b), S).rho; //V*ln(S/S*)*(dy/drf + dy/db)
+}
+
+PerpetualGreeks UsOptCall::Greeks(double S) const {
+	PRICER_PROBE("UsOptCall::Greeks");
+	return Evaluate(Factors(true, K, sig, rf, b), S);
+}
+
+double UsOptCall::ExerciseBoundary() const {
+	return Factors(true, K, sig, rf, b).boundary; //K*y/(y-1)
+}
+
+void UsOptCall::Sweep(int num, double S, double start, double end, SweepParameter param, PerpetualSweep& out) const {
+	PRICER_PROBE("UsOptCall::Sweep");
+	UsOpt::Sweep(true, K, sig, rf, b, num, S, start, end, param, out);
+}
+
+/*Implied parameters implementation*/
+bool UsOptCall::ImpliedVol(double S, double price, double& vol) const {
+	PRICER_PROBE("UsOptCall::ImpliedVol");
+	return Implied(true, S, price, K, sig, rf, b, SWEEP_SIGMA, vol);
+}
+
+bool UsOptCall::ImpliedCarry(double S, double price, double& carry) const {
+	PRICER_PROBE("UsOptCall::ImpliedCarry");
+	return Implied(true, S, price, K, sig, rf, b, SWEEP_CARRY, carry);
+}
+
 /*Print function implementation*/
 std::string UsOptCall::ToString() const {
 	std::string s = UsOpt::ToString();
@@ -1,12 +1,16 @@
 /* Call Options functions */
 /*****************************************************
 Name: AmericanOptionCall.hpp
-version: 0.1
+version: 0.5
 Description:
 These functions provide functionality for Perpetual American Options
 
 Change history:
 0.1 Initial version
+0.2 Shared-grid divided differences Greek ladders (GreeksLadderDDM)
+0.3 Pricing with rate and carry term structures (long end of the curves)
+0.4 Closed form Greeks, exercise boundary and parameter sweeps
+0.5 Implied volatility and implied carry
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -39,6 +43,8 @@ expiry price T tends to infinity. In general, American options are worth more th
 
 #include "AmericanOption.hpp"
 
+class TermCurve;
+
 class UsOptCall : public UsOpt {
 private:
 	/*Initialization of parameters for the option pricing model*/
@@ -47,6 +53,8 @@ private:
 	double K; //strike price
 	double b; //cost of carry that will equal rf for stock options
 
+	double PriceAt(double S, double p_rf, double p_b) const; //Price with the given rate and cost of carry
+
 public:
 	/*Default constructor, parameterized constructor, copy constructor, and destructor*/
 	UsOptCall();
@@ -72,7 +80,27 @@ public:
 
 	/*Pricer functions*/
 	double Price(double S) const;
+	double Price(double S, const TermCurve& rates, const TermCurve& carry) const; //uses the long end rates of the curves instead of rf and b
 	std::vector<double> PriceRange(int num, double start_S, double end_S);
+	//Divided differences ladder: prices the grid once and derives both the delta and the gamma ladder from the shared prices.
+	//If h is a multiple of the mesh size the offset points S-h and S+h are grid nodes and are not priced twice
+	void GreeksLadderDDM(int num, double h, double start_S, double end_S, std::vector<double>& deltas, std::vector<double>& gammas) const;
+
+	/*Sensitivities (closed form, see AmericanOption.hpp) and optimal exercise*/
+	double Delta(double S) const;
+	double Gamma(double S) const;
+	double Vega(double S) const;
+	double Rho(double S) const; //rf and b moved together
+	PerpetualGreeks Greeks(double S) const; //price and every Greek from one exponent computation
+	double ExerciseBoundary() const; //S*: exercise at S >= S* (infinite when never exercised)
+	//Price and Greeks over a grid of num + 1 points from start to end of the spot (S unused), sig, rf or b
+	void Sweep(int num, double S, double start, double end, SweepParameter param, PerpetualSweep& out) const;
+
+	/*Implied parameters (see AmericanOption.hpp): the sig or b that reprices price at S, the other parameters and the
+	current sig or b as the starting point. Return false when the price has no solution in the bracket or the solve
+	does not converge*/
+	bool ImpliedVol(double S, double price, double& vol) const;
+	bool ImpliedCarry(double S, double price, double& carry) const;
 
 	/*Printing functions*/
 	virtual std::string ToString() const;
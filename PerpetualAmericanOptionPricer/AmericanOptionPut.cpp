@@ -1,12 +1,17 @@
 /* Put Options functions */
 /*****************************************************
 Name: AmericanOptionPut.cpp
-version: 0.1
+version: 0.6
 Description:
 Implementation of the functions provided in AmericanOption.hpp for Perpetual American Options
 
 Change history:
 0.1 Initial version
+0.2 Shared-grid divided differences Greek ladders (GreeksLadderDDM)
+0.3 Pricing with rate and carry term structures (long end of the curves)
+0.4 Closed form Greeks, exercise boundary and parameter sweeps
+0.5 Implied volatility and implied carry
+0.6 Intrinsic value in the exercise region
 
 Parameters:
 T (expiry time/maturity). This is a number, e.g. T = 1 means one year.
@@ -36,6 +41,9 @@ expiry price T tends to infinity. In general, American options are worth more th
 
 #include "AmericanOptionPut.hpp"
 #include <cmath>
+#include "../CallPutOptionPricer/Instrumentation.hpp"
+#include "../CallPutOptionPricer/GreeksLadder.hpp"
+#include "../CallPutOptionPricer/TermCurve.hpp"
 #include <iostream>
 
 /*Default constructor, parameterized constructor, copy constructor, and destructor implementation*/
@@ -109,20 +117,31 @@ void UsOptPut::CostOfCarry(double new_b) {
 }
 
 /*Pricer functions implementation*/
-double UsOptPut::Price(double S) const {
+double UsOptPut::PriceAt(double S, double p_rf, double p_b) const {
 	double y2;
 	double P;
-	y2 = 0.5 - b / pow(sig, 2) - sqrt((b / pow(sig, 2) - 0.5)*(b / pow(sig, 2) - 0.5) + 2.0*rf / pow(sig, 2));
-	if (y2 == 1.0)
+	y2 = 0.5 - p_b / pow(sig, 2) - sqrt((p_b / pow(sig, 2) - 0.5)*(p_b / pow(sig, 2) - 0.5) + 2.0*p_rf / pow(sig, 2));
+	if (S <= K * y2 / (y2 - 1)) //exercise region S <= S*: worth the intrinsic value
 	{
-		return S;
+		return K - S;
 	}
 	P = (K / (1 - y2))* pow(((y2 - 1) / y2 * S / K), y2);
 
 	return P;
 }
 
+double UsOptPut::Price(double S) const {
+	PRICER_PROBE("UsOptPut::Price");
+	return PriceAt(S, rf, b);
+}
+
+double UsOptPut::Price(double S, const TermCurve& rates, const TermCurve& carry) const {
+	PRICER_PROBE("UsOptPut::Price(curves)");
+	return PriceAt(S, rates.LongRate(), carry.LongRate()); //a perpetual option discounts at the long end
+}
+
 std::vector<double> UsOptPut::PriceRange(int num, double start_S, double end_S) { //num equals the number of increments before reaching the end price end_S
+	PRICER_PROBE("UsOptPut::PriceRange");
 	std::vector<double> vec;
 	vec.resize(num + 1); //allocates space
 	double mesh_size = (end_S - start_S) / num; //increment size h
@@ -134,6 +153,57 @@ std::vector<double> UsOptPut::PriceRange(int num, double start_S, double end_S)
 }
 
 
+void UsOptPut::GreeksLadderDDM(int num, double h, double start_S, double end_S, std::vector<double>& deltas, std::vector<double>& gammas) const {
+	PRICER_PROBE("UsOptPut::GreeksLadderDDM");
+	::GreeksLadderDDM(num, h, start_S, end_S, [this](double S) { return this->Price(S); }, deltas, gammas);
+}
+
+/*Sensitivities and optimal exercise implementation*/
+double UsOptPut::Delta(double S) const {
+	PRICER_PROBE("UsOptPut::Delta");
+	return Evaluate(Factors(false, K, sig, rf, b), S).delta; //y*V/S
+}
+
+double UsOptPut::Gamma(double S) const {
+	PRICER_PROBE("UsOptPut::Gamma");
+	return Evaluate(Factors(false, K, sig, rf, b), S).gamma; //y*(y-1)*V/S^2
+}
+
+double UsOptPut::Vega(double S) const {
+	PRICER_PROBE("UsOptPut::Vega");
+	return Evaluate(Factors(false, K, sig, rf, b), S).vega; //V*ln(S/S*)*dy/dsig
+}
+
+double UsOptPut::Rho(double S) const {
+	PRICER_PROBE("UsOptPut::Rho");
+	return Evaluate(Factors(false, K, sig, rf, b), S).rho; //V*ln(S/S*)*(dy/drf + dy/db)
+}
+
+PerpetualGreeks UsOptPut::Greeks(double S) const {
+	PRICER_PROBE("UsOptPut::Greeks");
+	return Evaluate(Factors(false, K, sig, rf, b), S);
+}
+
+double UsOptPut::ExerciseBoundary() const {
+	return Factors(false, K, sig, rf, b).boundary; //K*y/(y-1)
+}
+
+void UsOptPut::Sweep(int num, double S, double start, double end, SweepParameter param, PerpetualSweep& out) const {
+	PRICER_PROBE("UsOptPut::Sweep");
+	UsOpt::Sweep(false, K, sig, rf, b, num, S, start, end, param, out);
+}
+
+/*Implied parameters implementation*/
+bool UsOptPut::ImpliedVol(double S, double price, double& vol) const {
+	PRICER_PROBE("UsOptPut::ImpliedVol");
+	return Implied(false, S, price, K, sig, rf, b, SWEEP_SIGMA, vol);
+}
+
+bool UsOptPut::ImpliedCarry(double S, double price, double& carry) const {
+	PRICER_PROBE("UsOptPut::ImpliedCarry");
+	return Implied(false, S, price, K, sig, rf, b, SWEEP_CARRY, carry);
+}
+
 /*Print function implementation*/
 std::string UsOptPut::ToString() const {
 	std::string s = UsOpt::ToString();
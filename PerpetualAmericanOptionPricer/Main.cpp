@@ -4,6 +4,10 @@
 
 #include "AmericanOptionCall.hpp"
 #include "AmericanOptionPut.hpp"
+#include "../CallPutOptionPricer/TermCurve.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #define NL cout << endl
 
 int main() {
@@ -33,6 +37,94 @@ int main() {
 		cout << "Value @t" << i << ": " << mesh_put[i] << endl;
 
 	}
+	NL;
+	cout << "Delta and gamma ladders of the put using divided differences on a shared price grid: " << endl;
+	NL;
+	std::vector<double> ladder_delta, ladder_gamma;
+	batch1_put.GreeksLadderDDM(increments, 5, S1, end_S1, ladder_delta, ladder_gamma); //h = 5 equals the mesh size
+	for (int i = 0; i <= increments; i++) {
+		cout << "Delta/Gamma @t" << i << ": " << ladder_delta[i] << " / " << ladder_gamma[i] << endl;
+	}
+	NL;
+	//term structures: a perpetual option uses the long end of the curves
+	double pillars[] = { 1.0, 5.0, 30.0 };
+	double zeros[] = { 0.08, 0.09, 0.1 };
+	TermCurve rates(std::vector<double>(pillars, pillars + 3), std::vector<double>(zeros, zeros + 3));
+	TermCurve carry(0.02);
+	cout << "Call and put values with rate and carry curves (long end rate " << rates.LongRate() << "): "
+		<< batch1_call.Price(S1, rates, carry) << ", " << batch1_put.Price(S1, rates, carry) << endl;
+
+	NL;
+	//closed form Greeks and exercise levels, checked against bumped prices
+	cout << "Closed form Greeks @S = " << S1 << " (bumped prices in brackets): " << endl;
+	NL;
+	for (int c = 0; c < 2; c++) {
+		PerpetualGreeks g = (c == 0) ? batch1_call.Greeks(S1) : batch1_put.Greeks(S1);
+		double h = 1e-4;
+		UsOptCall call_up(batch1_call), call_down(batch1_call);
+		UsOptPut put_up(batch1_put), put_down(batch1_put);
+		call_up.sigma(batch1.sig + h); call_down.sigma(batch1.sig - h); put_up.sigma(batch1.sig + h); put_down.sigma(batch1.sig - h);
+		double vega = (c == 0) ? (call_up.Price(S1) - call_down.Price(S1)) / (2 * h) : (put_up.Price(S1) - put_down.Price(S1)) / (2 * h);
+		call_up = batch1_call; call_down = batch1_call; put_up = batch1_put; put_down = batch1_put;
+		call_up.rate(batch1.rf + h); call_up.CostOfCarry(batch1.b + h); call_down.rate(batch1.rf - h); call_down.CostOfCarry(batch1.b - h);
+		put_up.rate(batch1.rf + h); put_up.CostOfCarry(batch1.b + h); put_down.rate(batch1.rf - h); put_down.CostOfCarry(batch1.b - h);
+		double rho = (c == 0) ? (call_up.Price(S1) - call_down.Price(S1)) / (2 * h) : (put_up.Price(S1) - put_down.Price(S1)) / (2 * h);
+		cout << (c == 0 ? "Call" : "Put") << ": delta " << g.delta << ", gamma " << g.gamma << ", vega " << g.vega << " (" << vega << "), rho " << g.rho << " (" << rho
+			<< "), exercise at S* = " << (c == 0 ? batch1_call.ExerciseBoundary() : batch1_put.ExerciseBoundary()) << endl;
+	}
+	NL;
+	cout << "Volatility sweep of the put @S = " << S1 << ": " << endl;
+	NL;
+	PerpetualSweep sweep;
+	batch1_put.Sweep(4, S1, 0.1, 0.3, SWEEP_SIGMA, sweep);
+	for (size_t i = 0; i < sweep.grid.size(); i++) {
+		cout << "sig " << sweep.grid[i] << ": price " << sweep.price[i] << ", delta " << sweep.delta[i] << ", vega " << sweep.vega[i] << ", S* " << sweep.boundary[i] << endl;
+	}
+
+	NL;
+	//implied parameters: a snapshot of 20000 quotes priced with known sig and b, then inverted
+	cout << "Implied volatility and carry of the batch 1 put @S = " << S1 << ": ";
+	double implied_sig, implied_b;
+	batch1_put.ImpliedVol(S1, 3.03106, implied_sig);
+	batch1_put.ImpliedCarry(S1, 3.03106, implied_b);
+	cout << implied_sig << ", " << implied_b << endl;
+	std::vector<PerpetualQuote> quotes(20000);
+	std::vector<double> true_sig(quotes.size()), true_b(quotes.size());
+	for (size_t i = 0; i < quotes.size(); i++) {
+		bool call = (i % 2 == 0);
+		double K = 80.0 + (i % 41);
+		true_sig[i] = 0.1 + 0.4 * ((i * 7919) % 1000) / 1000.0;
+		true_b[i] = -0.05 + 0.1 * ((i * 104729) % 1000) / 1000.0;
+		OptionData d = { 0.08, true_sig[i], K, true_b[i] };
+		double price = call ? UsOptCall(d).Price(S1) : UsOptPut(d).Price(S1); //intrinsic value in the exercise region
+		d.sig = 0.3; //starting point of the vol solver, the carry is known
+		PerpetualQuote q = { call, S1, price, d };
+		quotes[i] = q;
+	}
+	std::vector<double> vols, carries;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	size_t vol_failures = UsOpt::ImpliedBatch(quotes, SWEEP_SIGMA, vols);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < quotes.size(); i++) { //vol known, carry from 0
+		quotes[i].data.sig = true_sig[i];
+		quotes[i].data.b = 0.0;
+	}
+	size_t carry_failures = UsOpt::ImpliedBatch(quotes, SWEEP_CARRY, carries);
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	double vol_err = 0.0, carry_err = 0.0;
+	size_t exercised = 0;
+	for (size_t i = 0; i < quotes.size(); i++) {
+		double intrinsic = quotes[i].call ? S1 - quotes[i].data.K : quotes[i].data.K - S1;
+		if (quotes[i].price <= intrinsic + 1e-9) { //in the exercise region, no parameter to back out
+			exercised++;
+			continue;
+		}
+		vol_err = std::max(vol_err, fabs(vols[i] - true_sig[i]));
+		carry_err = std::max(carry_err, fabs(carries[i] - true_b[i]));
+	}
+	cout << quotes.size() << " quotes (" << exercised << " at intrinsic value): implied vols in " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()
+		<< " us (" << vol_failures << " failures, max error " << vol_err << "), implied carries in " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count()
+		<< " us (" << carry_failures << " failures, max error " << carry_err << ")" << endl;
 
 	return 0;
 }
\ No newline at end of file